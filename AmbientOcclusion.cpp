@@ -0,0 +1,136 @@
+#include"AmbientOcclusion.h"
+
+#include<algorithm>
+#include<chrono>
+#include<cmath>
+#include<filesystem>
+#include<fstream>
+
+#include"BVH.h"
+#include"Hash.h"
+#include"JobSystem.h"
+
+namespace
+{
+	// bumped whenever the bake changes so stale cache files are not picked up
+	const uint64_t BAKE_VERSION = 1;
+
+	float radicalInverse(uint32_t bits)
+	{
+		bits = (bits << 16) | (bits >> 16);
+		bits = ((bits & 0x55555555u) << 1) | ((bits & 0xAAAAAAAAu) >> 1);
+		bits = ((bits & 0x33333333u) << 2) | ((bits & 0xCCCCCCCCu) >> 2);
+		bits = ((bits & 0x0F0F0F0Fu) << 4) | ((bits & 0xF0F0F0F0u) >> 4);
+		bits = ((bits & 0x00FF00FFu) << 8) | ((bits & 0xFF00FF00u) >> 8);
+		return (float)bits * 2.3283064365386963e-10f;
+	}
+
+	uint32_t scramble(uint32_t x)
+	{
+		x ^= x >> 16;
+		x *= 0x7FEB352Du;
+		x ^= x >> 15;
+		x *= 0x846CA68Bu;
+		x ^= x >> 16;
+		return x;
+	}
+}
+
+// Returns one byte per vertex, 255 is fully open and 0 fully occluded
+std::vector<GLubyte> AmbientOcclusion::Bake(const Mesh& mesh, bool useCache)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	size_t vertexCount = mesh.VertexCount();
+	std::vector<GLubyte> occlusion(vertexCount, 255);
+
+	uint64_t key = hash_bytes(mesh.vertices.data(), mesh.vertices.size() * sizeof(GLfloat));
+	key = hash_bytes(mesh.indices.data(), mesh.indices.size() * sizeof(GLuint), key);
+	uint64_t settings[3] = { BAKE_VERSION, (uint64_t)raysPerVertex, (uint64_t)(radius * 1e6f) };
+	key = hash_bytes(settings, sizeof(settings), key);
+	std::string cacheFile = cacheDirectory + "/" + hash_to_hex(key) + ".ao";
+
+	cacheHit = false;
+	if (useCache)
+	{
+		std::ifstream in(cacheFile, std::ios::binary);
+		if (in && in.read((char*)occlusion.data(), vertexCount) && in.gcount() == (std::streamsize)vertexCount)
+		{
+			cacheHit = true;
+			seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+			raysPerSecond = 0.0;
+			return occlusion;
+		}
+	}
+
+	// area weighted vertex normals, the cross product length is twice the triangle area
+	std::vector<glm::vec3> normals(vertexCount, glm::vec3(0.0f));
+	glm::vec3 lo(1e30f), hi(-1e30f);
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+	{
+		glm::vec3 a = mesh.Position(mesh.indices[i]);
+		glm::vec3 b = mesh.Position(mesh.indices[i + 1]);
+		glm::vec3 c = mesh.Position(mesh.indices[i + 2]);
+		glm::vec3 n = glm::cross(b - a, c - a);
+		for (int k = 0; k < 3; k++)
+			normals[mesh.indices[i + k]] += n;
+	}
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		lo = glm::min(lo, mesh.Position(v));
+		hi = glm::max(hi, mesh.Position(v));
+	}
+	float diagonal = vertexCount ? glm::length(hi - lo) : 0.0f;
+	float maxDistance = radius * diagonal;
+	float bias = 1e-4f * diagonal;
+
+	BVH bvh(mesh);
+
+	// vertices go out in ranges that shrink as the bake nears its end, down to 64 vertices
+	JobSystem::Shared().ParallelFor(vertexCount, 64, [&](size_t first, size_t last)
+	{
+		for (size_t v = first; v < last; v++)
+		{
+			float length = glm::length(normals[v]);
+			if (length <= 0.0f)
+				continue;
+			glm::vec3 n = normals[v] / length;
+
+			// orthonormal basis around the normal (Duff et al. 2017)
+			float sign = std::copysign(1.0f, n.z);
+			float a = -1.0f / (sign + n.z);
+			float b = n.x * n.y * a;
+			glm::vec3 t(1.0f + sign * n.x * n.x * a, sign * b, -sign * n.x);
+			glm::vec3 s(b, sign + n.y * n.y * a, -n.y);
+
+			// cosine weighted Hammersley points with a per vertex rotation so neighbours do not band
+			uint32_t h = scramble((uint32_t)v);
+			float rx = (h & 0xFFFF) / 65536.0f;
+			float ry = (h >> 16) / 65536.0f;
+			glm::vec3 origin = mesh.Position(v) + n * bias;
+			int hits = 0;
+			for (int i = 0; i < raysPerVertex; i++)
+			{
+				float u1 = std::fmod((i + 0.5f) / raysPerVertex + rx, 1.0f);
+				float u2 = std::fmod(radicalInverse((uint32_t)i) + ry, 1.0f);
+				float r = std::sqrt(u1);
+				float phi = 6.2831853f * u2;
+				glm::vec3 dir = t * (r * std::cos(phi)) + s * (r * std::sin(phi)) + n * std::sqrt(1.0f - u1);
+				if (bvh.Occluded(origin, dir, 0.0f, maxDistance))
+					hits++;
+			}
+			occlusion[v] = (GLubyte)std::lround(255.0f * (1.0f - (float)hits / raysPerVertex));
+		}
+	}, threadCount);
+
+	seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	raysPerSecond = seconds > 0.0 ? (double)vertexCount * raysPerVertex / seconds : 0.0;
+
+	if (useCache)
+	{
+		std::error_code error;
+		std::filesystem::create_directories(cacheDirectory, error);
+		std::ofstream out(cacheFile, std::ios::binary);
+		out.write((const char*)occlusion.data(), vertexCount);
+	}
+	return occlusion;
+}
@@ -0,0 +1,33 @@
+#ifndef AMBIENT_OCCLUSION_CLASS_H
+#define AMBIENT_OCCLUSION_CLASS_H
+
+#include<glad/glad.h>
+#include<string>
+#include<vector>
+
+#include"Mesh.h"
+
+// Bakes per vertex ambient occlusion by casting hemisphere rays through a BVH on every core,
+// results are cached on disk by a hash of the mesh so reopening a file does not bake again
+class AmbientOcclusion
+{
+public:
+	// Rays cast from every vertex
+	int raysPerVertex = 64;
+	// Hits further away than this fraction of the bounding box diagonal do not occlude
+	float radius = 0.25f;
+	// Most threads of the shared JobSystem that cast rays, 0 for all of them
+	unsigned threadCount = 0;
+	// Where baked results are stored
+	std::string cacheDirectory = "cache/ao";
+
+	// Stats of the last Bake
+	bool cacheHit = false;
+	double seconds = 0.0;
+	double raysPerSecond = 0.0;
+
+	// Returns one byte per vertex, 255 is fully open and 0 fully occluded
+	std::vector<GLubyte> Bake(const Mesh& mesh, bool useCache = true);
+};
+
+#endif
@@ -0,0 +1,234 @@
+#include"BVH.h"
+
+#include<algorithm>
+#include<numeric>
+
+namespace
+{
+	const int BINS = 12;
+	const uint32_t LEAF_SIZE = 4;
+
+	float surfaceArea(const glm::vec3& lo, const glm::vec3& hi)
+	{
+		glm::vec3 d = glm::max(hi - lo, glm::vec3(0.0f));
+		return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+	}
+
+	// Slab test, returns the entry distance or a value above tMax on a miss
+	float hitBox(const glm::vec3& lo, const glm::vec3& hi, const glm::vec3& origin, const glm::vec3& invDir, float tMin, float tMax)
+	{
+		glm::vec3 t0 = (lo - origin) * invDir;
+		glm::vec3 t1 = (hi - origin) * invDir;
+		glm::vec3 tNear = glm::min(t0, t1);
+		glm::vec3 tFar = glm::max(t0, t1);
+		float enter = glm::max(tMin, glm::max(tNear.x, glm::max(tNear.y, tNear.z)));
+		float exit = glm::min(tMax, glm::min(tFar.x, glm::min(tFar.y, tFar.z)));
+		return enter <= exit ? enter : tMax + 1.0f;
+	}
+}
+
+// Constructor that builds the hierarchy over a copy of the mesh triangles
+BVH::BVH(const Mesh& mesh)
+{
+	size_t triangleCount = mesh.indices.size() / 3;
+	std::vector<glm::vec3> lo(triangleCount), hi(triangleCount), center(triangleCount);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		glm::vec3 a = mesh.Position(mesh.indices[t * 3]);
+		glm::vec3 b = mesh.Position(mesh.indices[t * 3 + 1]);
+		glm::vec3 c = mesh.Position(mesh.indices[t * 3 + 2]);
+		lo[t] = glm::min(a, glm::min(b, c));
+		hi[t] = glm::max(a, glm::max(b, c));
+		center[t] = (lo[t] + hi[t]) * 0.5f;
+	}
+
+	std::vector<uint32_t> order(triangleCount);
+	std::iota(order.begin(), order.end(), 0);
+
+	nodes.reserve(triangleCount * 2 + 1);
+	nodes.push_back({ glm::vec3(0.0f), 0, glm::vec3(0.0f), (uint32_t)triangleCount });
+
+	// explicit stack of nodes still to split
+	std::vector<uint32_t> pending(1, 0);
+	while (!pending.empty())
+	{
+		uint32_t index = pending.back();
+		pending.pop_back();
+		uint32_t start = nodes[index].start;
+		uint32_t count = nodes[index].count;
+
+		glm::vec3 boxLo(1e30f), boxHi(-1e30f), centerLo(1e30f), centerHi(-1e30f);
+		for (uint32_t i = start; i < start + count; i++)
+		{
+			boxLo = glm::min(boxLo, lo[order[i]]);
+			boxHi = glm::max(boxHi, hi[order[i]]);
+			centerLo = glm::min(centerLo, center[order[i]]);
+			centerHi = glm::max(centerHi, center[order[i]]);
+		}
+		nodes[index].lo = boxLo;
+		nodes[index].hi = boxHi;
+		if (count <= LEAF_SIZE)
+			continue;
+
+		// binned SAH over the longest axis of the centroid bounds
+		glm::vec3 extent = centerHi - centerLo;
+		int axis = (extent.x > extent.y && extent.x > extent.z) ? 0 : (extent.y > extent.z ? 1 : 2);
+		if (extent[axis] <= 0.0f)
+			continue;
+		float scale = BINS / extent[axis];
+		auto binOf = [&](uint32_t t) { return std::min(BINS - 1, (int)((center[t][axis] - centerLo[axis]) * scale)); };
+
+		uint32_t binCount[BINS] = {};
+		glm::vec3 binLo[BINS], binHi[BINS];
+		std::fill(binLo, binLo + BINS, glm::vec3(1e30f));
+		std::fill(binHi, binHi + BINS, glm::vec3(-1e30f));
+		for (uint32_t i = start; i < start + count; i++)
+		{
+			int b = binOf(order[i]);
+			binCount[b]++;
+			binLo[b] = glm::min(binLo[b], lo[order[i]]);
+			binHi[b] = glm::max(binHi[b], hi[order[i]]);
+		}
+
+		// sweep from the right to get the cost of every right side, then from the left
+		float rightArea[BINS];
+		uint32_t rightCount[BINS];
+		glm::vec3 accLo(1e30f), accHi(-1e30f);
+		uint32_t accCount = 0;
+		for (int b = BINS - 1; b > 0; b--)
+		{
+			accLo = glm::min(accLo, binLo[b]);
+			accHi = glm::max(accHi, binHi[b]);
+			accCount += binCount[b];
+			rightArea[b] = surfaceArea(accLo, accHi);
+			rightCount[b] = accCount;
+		}
+		float bestCost = 1e30f;
+		int bestSplit = -1;
+		accLo = glm::vec3(1e30f);
+		accHi = glm::vec3(-1e30f);
+		accCount = 0;
+		for (int b = 0; b < BINS - 1; b++)
+		{
+			accLo = glm::min(accLo, binLo[b]);
+			accHi = glm::max(accHi, binHi[b]);
+			accCount += binCount[b];
+			if (accCount == 0 || rightCount[b + 1] == 0)
+				continue;
+			float cost = surfaceArea(accLo, accHi) * accCount + rightArea[b + 1] * rightCount[b + 1];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestSplit = b;
+			}
+		}
+		if (bestSplit < 0 || bestCost >= surfaceArea(boxLo, boxHi) * count)
+			continue;
+
+		uint32_t* mid = std::partition(order.data() + start, order.data() + start + count, [&](uint32_t t) { return binOf(t) <= bestSplit; });
+		uint32_t leftCount = (uint32_t)(mid - (order.data() + start));
+
+		uint32_t left = (uint32_t)nodes.size();
+		nodes.push_back({ glm::vec3(0.0f), start, glm::vec3(0.0f), leftCount });
+		nodes.push_back({ glm::vec3(0.0f), start + leftCount, glm::vec3(0.0f), count - leftCount });
+		nodes[index].start = left;
+		nodes[index].count = 0;
+		pending.push_back(left);
+		pending.push_back(left + 1);
+	}
+
+	v0.resize(triangleCount);
+	e1.resize(triangleCount);
+	e2.resize(triangleCount);
+	for (size_t i = 0; i < triangleCount; i++)
+	{
+		uint32_t t = order[i];
+		v0[i] = mesh.Position(mesh.indices[t * 3]);
+		e1[i] = mesh.Position(mesh.indices[t * 3 + 1]) - v0[i];
+		e2[i] = mesh.Position(mesh.indices[t * 3 + 2]) - v0[i];
+	}
+}
+
+template<bool anyHit>
+float BVH::traverse(glm::vec3 origin, glm::vec3 direction, float tMin, float tMax) const
+{
+	if (v0.empty())
+		return -1.0f;
+
+	glm::vec3 invDir = 1.0f / direction;
+	float closest = tMax;
+	bool hit = false;
+
+	// one entry per level is pushed at most, SAH trees stay far shallower than this
+	uint32_t stack[128];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0)
+	{
+		const Node& node = nodes[stack[--top]];
+		if (hitBox(node.lo, node.hi, origin, invDir, tMin, closest) > closest)
+			continue;
+
+		if (node.count > 0)
+		{
+			// Moller-Trumbore, both sides count as hits
+			for (uint32_t i = node.start; i < node.start + node.count; i++)
+			{
+				glm::vec3 p = glm::cross(direction, e2[i]);
+				float det = glm::dot(e1[i], p);
+				if (det > -1e-12f && det < 1e-12f)
+					continue;
+				float inv = 1.0f / det;
+				glm::vec3 s = origin - v0[i];
+				float u = glm::dot(s, p) * inv;
+				if (u < 0.0f || u > 1.0f)
+					continue;
+				glm::vec3 q = glm::cross(s, e1[i]);
+				float v = glm::dot(direction, q) * inv;
+				if (v < 0.0f || u + v > 1.0f)
+					continue;
+				float t = glm::dot(e2[i], q) * inv;
+				if (t < tMin || t > closest)
+					continue;
+				if (anyHit)
+					return t;
+				closest = t;
+				hit = true;
+			}
+			continue;
+		}
+
+		// push the far child first so the near one is visited first
+		const Node& left = nodes[node.start];
+		const Node& right = nodes[node.start + 1];
+		float dl = hitBox(left.lo, left.hi, origin, invDir, tMin, closest);
+		float dr = hitBox(right.lo, right.hi, origin, invDir, tMin, closest);
+		if (dl <= dr)
+		{
+			if (dr <= closest && top < 128)
+				stack[top++] = node.start + 1;
+			if (dl <= closest && top < 128)
+				stack[top++] = node.start;
+		}
+		else
+		{
+			if (dl <= closest && top < 128)
+				stack[top++] = node.start;
+			if (dr <= closest && top < 128)
+				stack[top++] = node.start + 1;
+		}
+	}
+	return hit ? closest : -1.0f;
+}
+
+// Returns true if anything is hit between tMin and tMax, stops at the first hit found
+bool BVH::Occluded(glm::vec3 origin, glm::vec3 direction, float tMin, float tMax) const
+{
+	return traverse<true>(origin, direction, tMin, tMax) >= 0.0f;
+}
+
+// Returns the distance to the closest hit or a negative value when nothing is hit
+float BVH::Intersect(glm::vec3 origin, glm::vec3 direction, float tMin, float tMax) const
+{
+	return traverse<false>(origin, direction, tMin, tMax);
+}
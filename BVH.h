@@ -0,0 +1,43 @@
+#ifndef BVH_CLASS_H
+#define BVH_CLASS_H
+
+#include<glm/glm.hpp>
+#include<cstdint>
+#include<vector>
+
+#include"Mesh.h"
+
+// Bounding volume hierarchy over the triangles of a mesh for CPU ray queries,
+// built with binned SAH and traversed near child first
+class BVH
+{
+public:
+	struct Node
+	{
+		glm::vec3 lo;
+		// first triangle for a leaf, index of the left child for an inner node (right is left + 1)
+		uint32_t start;
+		glm::vec3 hi;
+		// zero for an inner node
+		uint32_t count;
+	};
+
+	std::vector<Node> nodes;
+
+	// Constructor that builds the hierarchy over a copy of the mesh triangles
+	BVH(const Mesh& mesh);
+
+	// Returns true if anything is hit between tMin and tMax, stops at the first hit found
+	bool Occluded(glm::vec3 origin, glm::vec3 direction, float tMin, float tMax) const;
+	// Returns the distance to the closest hit or a negative value when nothing is hit
+	float Intersect(glm::vec3 origin, glm::vec3 direction, float tMin, float tMax) const;
+
+private:
+	// Triangles in leaf order, stored as a corner and two edges for the intersection test
+	std::vector<glm::vec3> v0, e1, e2;
+
+	template<bool anyHit>
+	float traverse(glm::vec3 origin, glm::vec3 direction, float tMin, float tMax) const;
+};
+
+#endif
@@ -1,87 +1,222 @@
 #include"Camera.h"
 
+#include<cmath>
+
 Camera::Camera(int width, int height, glm::vec3 position)
 {
 	Camera::width = width;
 	Camera::height = height;
 	Position = position;
+	targetPosition = position;
 }
 
-void Camera::Matrix(float FOVdeg, float nearPlane, float farPlane, Shader& shader, const char* uniform)
+glm::mat4 Camera::View()
 {
-	glm::mat4 view = glm::mat4(1.0f);
-	glm::mat4 projection = glm::mat4(1.0f);
+	return glm::lookAt(Position, Position + Orientation, Up);
+}
 
-	view = glm::lookAt(Position, Position + Orientation, Up);
-	projection = glm::perspective(glm::radians(FOVdeg), (float)(width / height), nearPlane, farPlane);
+glm::mat4 Camera::Projection(float FOVdeg, float nearPlane, float farPlane)
+{
+	// the aspect ratio has to be divided as floats, width / height in integers is 0 for portrait windows
+	return glm::perspective(glm::radians(FOVdeg), (float)width / (float)height, nearPlane, farPlane);
+}
 
-	glUniformMatrix4fv(glGetUniformLocation(shader.ID, uniform), 1, GL_FALSE, glm::value_ptr(projection * view));
+// Returns projection * view, what Matrix uploads
+glm::mat4 Camera::ViewProjection(float FOVdeg, float nearPlane, float farPlane)
+{
+	return Projection(FOVdeg, nearPlane, farPlane) * View();
 }
 
-void Camera::Inputs(GLFWwindow* window)
+// Uploads projection * view to a uniform handle resolved with Shader::Uniform
+void Camera::Matrix(float FOVdeg, float nearPlane, float farPlane, Shader& shader, GLint uniform)
 {
-	if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-	{
-		Position += speed * Orientation;
-	}
-	if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-	{
-		Position += speed * -glm::normalize(glm::cross(Orientation, Up));
-	}
-	if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-	{
-		Position += speed * -Orientation;
-	}
-	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-	{
-		Position += speed * glm::normalize(glm::cross(Orientation, Up));
-	}
-	if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)
-	{
-		Position += speed * Up;
-	}
-	if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS)
+	shader.SetMat4(uniform, ViewProjection(FOVdeg, nearPlane, farPlane));
+}
+
+// Applies this frame's events and held keys over deltaSeconds, true while the view is still moving
+bool Camera::Update(InputQueue& input, float deltaSeconds)
+{
+	// cursor events queued before a capture started are in the other coordinates
+	bool captureStarted = false;
+	for (const InputQueue::Event& event : input.Events())
 	{
-		Position += speed * -Up;
+		switch (event.type)
+		{
+		case InputQueue::KEY:
+			if (event.code == GLFW_KEY_O && event.action == GLFW_PRESS)
+				mode = mode == FLY ? ORBIT : FLY;
+			break;
+		case InputQueue::MOUSE_BUTTON:
+			if (event.action == GLFW_PRESS && dragButton < 0)
+			{
+				// orbits turn around what was clicked, or the last pivot when that is empty space
+				glm::vec3 point;
+				if (event.code == GLFW_MOUSE_BUTTON_LEFT && mode == ORBIT && pick(event.position, point))
+					Pivot = point;
+				dragButton = event.code;
+				input.Capture(true);
+				lastCursor = input.Cursor();
+				captureStarted = true;
+			}
+			else if (event.action == GLFW_RELEASE && event.code == dragButton)
+			{
+				dragButton = -1;
+				input.Capture(false);
+			}
+			break;
+		case InputQueue::CURSOR:
+		{
+			if (dragButton < 0 || captureStarted)
+				break;
+			glm::dvec2 delta = event.position - lastCursor;
+			lastCursor = event.position;
+			if (dragButton == GLFW_MOUSE_BUTTON_LEFT)
+			{
+				if (mode == FLY)
+					look(delta);
+				else
+					orbit(delta);
+			}
+			else
+				pan(delta);
+			break;
+		}
+		case InputQueue::SCROLL:
+			zoom(input.Cursor(), event.position.y);
+			break;
+		default:
+			break;
+		}
 	}
-	if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
+
+	// held keys move at a rate, so the distance covered only depends on the time held
+	glm::vec3 right = glm::normalize(glm::cross(targetOrientation, Up));
+	glm::vec3 move(0.0f);
+	if (input.KeyHeld(GLFW_KEY_W))
+		move += targetOrientation;
+	if (input.KeyHeld(GLFW_KEY_S))
+		move -= targetOrientation;
+	if (input.KeyHeld(GLFW_KEY_D))
+		move += right;
+	if (input.KeyHeld(GLFW_KEY_A))
+		move -= right;
+	if (input.KeyHeld(GLFW_KEY_SPACE))
+		move += Up;
+	if (input.KeyHeld(GLFW_KEY_LEFT_CONTROL))
+		move -= Up;
+	bool flying = glm::length(move) > 0.0f;
+	if (flying)
 	{
-		speed = 0.4f;
+		glm::vec3 step = glm::normalize(move) * speed * (input.KeyHeld(GLFW_KEY_LEFT_SHIFT) ? 4.0f : 1.0f) * deltaSeconds;
+		targetPosition += step;
+		// the pivot comes along, an orbit after flying turns around what is in front
+		Pivot += step;
 	}
-	if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_RELEASE)
+
+	// eases towards the target by the same share per second whatever the frame rate
+	float blend = 1.0f - std::exp(-smoothing * deltaSeconds);
+	Position += (targetPosition - Position) * blend;
+	Orientation = glm::normalize(Orientation + (targetOrientation - Orientation) * blend);
+	// close enough to stop, otherwise the easing would ask for frames forever
+	bool settled = glm::length(targetPosition - Position) < 1e-5f && glm::length(targetOrientation - Orientation) < 1e-5f;
+	if (settled)
 	{
-		speed = 0.1f;
+		Position = targetPosition;
+		Orientation = targetOrientation;
 	}
+	return flying || !settled;
+}
 
-	if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS)
-	{
-		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_HIDDEN);
+// Direction through a point of the window from the target view
+glm::vec3 Camera::ray(glm::dvec2 cursor)
+{
+	float x = 2.0f * (float)cursor.x / width - 1.0f;
+	float y = 1.0f - 2.0f * (float)cursor.y / height;
+	float tangent = std::tan(glm::radians(fieldOfView) * 0.5f);
+	glm::vec3 right = glm::normalize(glm::cross(targetOrientation, Up));
+	glm::vec3 up = glm::cross(right, targetOrientation);
+	return glm::normalize(targetOrientation + right * (x * tangent * (float)width / (float)height) + up * (y * tangent));
+}
 
-		if (firstClick)
-		{
-			glfwSetCursorPos(window, (width / 2), (height / 2));
-			firstClick = false;
-		}
+// Point under the cursor, false when Pick hits nothing
+bool Camera::pick(glm::dvec2 cursor, glm::vec3& point)
+{
+	if (!Pick)
+		return false;
+	glm::vec3 direction = ray(cursor);
+	float distance = Pick(targetPosition, direction);
+	if (distance < 0.0f)
+		return false;
+	point = targetPosition + direction * distance;
+	return true;
+}
 
-		double mouseX;
-		double mouseY;
-		glfwGetCursorPos(window, &mouseX, &mouseY);
+// Turns the view in place
+void Camera::look(glm::dvec2 delta)
+{
+	float rotx = sensitivity * (float)delta.y / height;
+	float roty = sensitivity * (float)delta.x / height;
 
-		float rotx = sensitivity * (float)(mouseY - (height / 2)) / height;
-		float roty = sensitivity * (float)(mouseX - (height / 2)) / height;
+	glm::vec3 newOrientation = glm::rotate(targetOrientation, glm::radians(-rotx), glm::normalize(glm::cross(targetOrientation, Up)));
+	if (!(glm::angle(newOrientation, Up) <= glm::radians(5.0f) or glm::angle(newOrientation, -Up) <= glm::radians(5.0f)))
+	{
+		targetOrientation = newOrientation;
+	}
+	targetOrientation = glm::rotate(targetOrientation, glm::radians(-roty), Up);
+}
 
-		glm::vec3 newOrientation = glm::rotate(Orientation, glm::radians(-rotx), glm::normalize(glm::cross(Orientation, Up)));
-		if (!(glm::angle(newOrientation, Up) <= glm::radians(5.0f) or glm::angle(newOrientation, -Up) <= glm::radians(5.0f)))
-		{
-			Orientation = newOrientation;
-		}
-		Orientation = glm::rotate(Orientation, glm::radians(-roty), Up);
+// Turns the view and its position around the pivot, so the pivot stays where it is on screen
+void Camera::orbit(glm::dvec2 delta)
+{
+	float rotx = sensitivity * (float)delta.y / height;
+	float roty = sensitivity * (float)delta.x / height;
 
-		glfwSetCursorPos(window, (width / 2), (height / 2));
+	glm::vec3 right = glm::normalize(glm::cross(targetOrientation, Up));
+	glm::vec3 offset = targetPosition - Pivot;
+	glm::vec3 newOrientation = glm::rotate(targetOrientation, glm::radians(-rotx), right);
+	// same limit as looking, straight up or down the cross product with Up is undefined
+	if (!(glm::angle(newOrientation, Up) <= glm::radians(5.0f) or glm::angle(newOrientation, -Up) <= glm::radians(5.0f)))
+	{
+		targetOrientation = newOrientation;
+		offset = glm::rotate(offset, glm::radians(-rotx), right);
 	}
-	else if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_RELEASE)
+	targetOrientation = glm::rotate(targetOrientation, glm::radians(-roty), Up);
+	offset = glm::rotate(offset, glm::radians(-roty), Up);
+	targetPosition = Pivot + offset;
+}
+
+// Slides the view sideways so the pivot's depth follows the cursor
+void Camera::pan(glm::dvec2 delta)
+{
+	float depth = glm::max(0.01f, glm::dot(Pivot - targetPosition, targetOrientation));
+	float worldPerPixel = 2.0f * depth * std::tan(glm::radians(fieldOfView) * 0.5f) / height;
+	glm::vec3 right = glm::normalize(glm::cross(targetOrientation, Up));
+	glm::vec3 up = glm::cross(right, targetOrientation);
+	glm::vec3 step = (-right * (float)delta.x + up * (float)delta.y) * worldPerPixel;
+	targetPosition += step;
+	Pivot += step;
+}
+
+// Moves towards the point under the cursor by a share of the distance per step, backwards for negative steps
+void Camera::zoom(glm::dvec2 cursor, double steps)
+{
+	glm::vec3 direction = ray(cursor);
+	glm::vec3 point;
+	if (pick(cursor, point))
+		Pivot = point;
+	else
 	{
-		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
-		firstClick = true;
+		// nothing under the cursor, aim at the pivot's depth along the ray
+		float depth = glm::max(0.01f, glm::dot(Pivot - targetPosition, targetOrientation));
+		point = targetPosition + direction * (depth / glm::max(0.1f, glm::dot(direction, targetOrientation)));
 	}
-}
\ No newline at end of file
+	glm::vec3 offset = point - targetPosition;
+	float distance = glm::length(offset);
+	if (distance <= 0.0f)
+		return;
+	// a share of what is left never reaches the point, so zooming in cannot pass through the surface
+	float remaining = distance * std::pow(1.0f - zoomStep, (float)steps);
+	if (steps > 0.0)
+		remaining = glm::max(remaining, glm::min(distance, closest));
+	targetPosition = point - offset / distance * remaining;
+}
@@ -8,28 +8,78 @@
 #include<glm/gtc/type_ptr.hpp>
 #include<glm/gtx/rotate_vector.hpp>
 #include<glm/gtx/vector_angle.hpp>
+#include<functional>
 
+#include"InputQueue.h"
 #include"shaderClass.h"
 
+// Camera for inspecting models. Input arrives as InputQueue events and moves a target view, the
+// shown view follows it with exponential easing, so motion is smooth and the same at any frame rate.
+// W A S D, space and left control fly at speed units per second (shift for four times that). The
+// left drag looks around in fly mode and orbits the pivot in orbit mode (O switches), the right or
+// middle drag pans, and the wheel zooms towards whatever is under the cursor
 class Camera
 {
 public:
+	enum Mode
+	{
+		FLY,
+		ORBIT
+	};
+
+	// The view that is shown
 	glm::vec3 Position;
 	glm::vec3 Orientation = glm::vec3(0.0f, 0.0f, -1.0f);
 	glm::vec3 Up = glm::vec3(0.0f, 1.0f, 0.0f);
+	// What orbits turn around, moved to the point a zoom or an orbit started on
+	glm::vec3 Pivot = glm::vec3(0.0f);
 
 	int width;
 	int height;
 
-	bool firstClick = true;
-
-	float speed = 0.1f;
+	Mode mode = FLY;
+	// units per second
+	float speed = 1.5f;
+	// degrees per window height of drag
 	float sensitivity = 100.0f;
+	float fieldOfView = 45.0f;
+	// how quickly the shown view catches up with the input, per second
+	float smoothing = 20.0f;
+	// share of the distance to the point under the cursor one wheel step covers
+	float zoomStep = 0.2f;
+	// closest a zoom gets to the point, it should stay past the near plane
+	float closest = 0.2f;
+	// distance along a ray in world space to the first surface it hits, negative for none. Without
+	// it zooms and orbits fall back to the pivot
+	std::function<float(glm::vec3 origin, glm::vec3 direction)> Pick;
 
 	Camera(int width, int height, glm::vec3 position);
 
-	void Matrix(float FOVdeg, float nearPlane, float farPlane, Shader& shader, const char* uniform);
-	void Inputs(GLFWwindow* window);
+	glm::mat4 View();
+	glm::mat4 Projection(float FOVdeg, float nearPlane, float farPlane);
+	// Returns projection * view, what Matrix uploads
+	glm::mat4 ViewProjection(float FOVdeg, float nearPlane, float farPlane);
+	// Uploads projection * view to a uniform handle resolved with Shader::Uniform
+	void Matrix(float FOVdeg, float nearPlane, float farPlane, Shader& shader, GLint uniform);
+	// Applies this frame's events and held keys over deltaSeconds. Returns true while the view is
+	// still moving, so the caller keeps drawing frames without new events
+	bool Update(InputQueue& input, float deltaSeconds);
+
+private:
+	glm::vec3 targetPosition;
+	glm::vec3 targetOrientation = glm::vec3(0.0f, 0.0f, -1.0f);
+	// button of the drag in progress, -1 for none
+	int dragButton = -1;
+	glm::dvec2 lastCursor;
+
+	// Direction through a point of the window from the target view
+	glm::vec3 ray(glm::dvec2 cursor);
+	// Point under the cursor, false when Pick hits nothing
+	bool pick(glm::dvec2 cursor, glm::vec3& point);
+	void look(glm::dvec2 delta);
+	void orbit(glm::dvec2 delta);
+	void pan(glm::dvec2 delta);
+	void zoom(glm::dvec2 cursor, double steps);
 };
 
 #endif
\ No newline at end of file
@@ -1,27 +1,63 @@
 #include"EBO.h"
 
+#include"GLResources.h"
+#include"GLState.h"
+
 // Constructor that generates a Elements Buffer Object and links it to indices
 EBO::EBO(GLuint* indices, GLsizeiptr size)
 {
 	glGenBuffers(1, &ID);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ID);
+	GLResources::Track(GLResources::BUFFER, ID, "EBO");
+	GLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, ID);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, indices, GL_STATIC_DRAW);
 }
 
+// Takes over the buffer of another EBO
+EBO::EBO(EBO&& other) noexcept
+	: ID(other.ID)
+{
+	other.ID = 0;
+}
+
+EBO& EBO::operator=(EBO&& other) noexcept
+{
+	if (this != &other)
+	{
+		GLResources::Release(GLResources::BUFFER, ID);
+		ID = other.ID;
+		other.ID = 0;
+	}
+	return *this;
+}
+
+// Queues the buffer for deletion at the end of the frame
+EBO::~EBO()
+{
+	GLResources::Release(GLResources::BUFFER, ID);
+}
+
+// Replaces the indices of the EBO, the VAO using it has to be bound
+void EBO::Update(GLuint* indices, GLsizeiptr size)
+{
+	GLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, ID);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, indices, GL_DYNAMIC_DRAW);
+}
+
 // Binds the EBO
 void EBO::Bind()
 {
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ID);
+	GLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, ID);
 }
 
 // Unbinds the EBO
 void EBO::Unbind()
 {
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	GLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
-// Deletes the EBO
+// Releases the EBO before the destructor would
 void EBO::Delete()
 {
-	glDeleteBuffers(1, &ID);
+	GLResources::Release(GLResources::BUFFER, ID);
+	ID = 0;
 }
\ No newline at end of file
@@ -11,11 +11,20 @@ public:
 	// Constructor that generates a Elements Buffer Object and links it to indices
 	EBO(GLuint* indices, GLsizeiptr size);
 
+	// Move only, the object owns the GL buffer and releases it when destroyed
+	EBO(const EBO&) = delete;
+	EBO& operator=(const EBO&) = delete;
+	EBO(EBO&& other) noexcept;
+	EBO& operator=(EBO&& other) noexcept;
+	~EBO();
+
+	// Replaces the indices of the EBO, the VAO using it has to be bound
+	void Update(GLuint* indices, GLsizeiptr size);
 	// Binds the EBO
 	void Bind();
 	// Unbinds the EBO
 	void Unbind();
-	// Deletes the EBO
+	// Releases the EBO before the destructor would
 	void Delete();
 };
 
@@ -0,0 +1,46 @@
+#include"FrameData.h"
+
+#include"Camera.h"
+#include"GLState.h"
+
+// Constructor that allocates the buffer and binds it to FRAME_DATA_BINDING
+FrameUniforms::FrameUniforms()
+{
+	glGenBuffers(1, &ID);
+	GLState::BindBuffer(GL_UNIFORM_BUFFER, ID);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), NULL, GL_DYNAMIC_DRAW);
+	GLState::BindBufferBase(GL_UNIFORM_BUFFER, FRAME_DATA_BINDING, ID);
+}
+
+// Fills the block from the camera and uploads it
+void FrameUniforms::Update(Camera& camera, float FOVdeg, float nearPlane, float farPlane, float time)
+{
+	Update(Build(camera, FOVdeg, nearPlane, farPlane, time));
+}
+
+// Uploads a block filled elsewhere
+void FrameUniforms::Update(const FrameData& frame)
+{
+	data = frame;
+	GLState::BindBuffer(GL_UNIFORM_BUFFER, ID);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &data);
+}
+
+// Fills a block from the camera without touching GL
+FrameData FrameUniforms::Build(Camera& camera, float FOVdeg, float nearPlane, float farPlane, float time)
+{
+	FrameData frame;
+	frame.view = camera.View();
+	frame.projection = camera.Projection(FOVdeg, nearPlane, farPlane);
+	frame.viewProjection = frame.projection * frame.view;
+	frame.cameraPosition = glm::vec4(camera.Position, 1.0f);
+	frame.viewport = glm::vec4((float)camera.width, (float)camera.height, 1.0f / camera.width, 1.0f / camera.height);
+	frame.time = time;
+	return frame;
+}
+
+// Deletes the buffer
+void FrameUniforms::Delete()
+{
+	GLState::DeleteBuffer(ID);
+}
@@ -0,0 +1,14 @@
+// Per frame values shared by every program, bound once to binding point 0.
+// Must match the FrameData struct in FrameData.h
+layout (std140) uniform FrameData
+{
+   mat4 view;
+   mat4 projection;
+   mat4 viewProjection;
+   // xyz is the camera position in world space
+   vec4 cameraPosition;
+   // width, height, 1 / width, 1 / height in pixels
+   vec4 viewport;
+   // seconds since start
+   float time;
+};
@@ -0,0 +1,45 @@
+#ifndef FRAME_DATA_CLASS_H
+#define FRAME_DATA_CLASS_H
+
+#include<glad/glad.h>
+#include<glm/glm.hpp>
+
+class Camera;
+
+// Binding point of the FrameData block, Shader links every program's block to it
+const GLuint FRAME_DATA_BINDING = 0;
+
+// CPU side of the std140 block in FrameData.glsl, vec4 members keep every offset a multiple of 16
+struct FrameData
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::mat4 viewProjection;
+	glm::vec4 cameraPosition;
+	glm::vec4 viewport;
+	float time;
+	float padding[3];
+};
+static_assert(sizeof(FrameData) == 240, "FrameData must match the std140 layout of the GLSL block");
+
+// Uniform buffer holding FrameData, written once per frame and read by every program
+class FrameUniforms
+{
+public:
+	GLuint ID;
+	FrameData data;
+
+	// Constructor that allocates the buffer and binds it to FRAME_DATA_BINDING
+	FrameUniforms();
+
+	// Fills the block from the camera and uploads it
+	void Update(Camera& camera, float FOVdeg, float nearPlane, float farPlane, float time);
+	// Uploads a block filled elsewhere, like on the thread that read the input
+	void Update(const FrameData& frame);
+	// Fills a block from the camera without touching GL
+	static FrameData Build(Camera& camera, float FOVdeg, float nearPlane, float farPlane, float time);
+	// Deletes the buffer
+	void Delete();
+};
+
+#endif
@@ -0,0 +1,161 @@
+#include"FramePacer.h"
+
+#include<GLFW/glfw3.h>
+#include<algorithm>
+#include<iostream>
+#include<thread>
+#include<vector>
+
+#ifdef _WIN32
+// without it windows.h defines min and max as macros, which breaks std::min and std::max
+#define NOMINMAX
+#include<windows.h>
+#include<timeapi.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
+// Constructor, on Windows it asks for the 1 ms scheduler tick so sleeps overshoot by less
+FramePacer::FramePacer()
+{
+#ifdef _WIN32
+	timeBeginPeriod(1);
+#endif
+}
+
+FramePacer::~FramePacer()
+{
+#ifdef _WIN32
+	timeEndPeriod(1);
+#endif
+}
+
+// Reads off, on or adaptive, false for anything else
+bool FramePacer::ParseSwapMode(const std::string& name)
+{
+	if (name == "off")
+		swapMode = VSYNC_OFF;
+	else if (name == "on")
+		swapMode = VSYNC_ON;
+	else if (name == "adaptive")
+		swapMode = VSYNC_ADAPTIVE;
+	else
+		return false;
+	return true;
+}
+
+// Interval for glfwSwapInterval, call on the thread the context is current on
+int FramePacer::SwapInterval(SwapMode mode)
+{
+	if (mode == VSYNC_OFF)
+		return 0;
+	// a negative interval only means adaptive with the tear control extension, without it drivers treat it as off or fail
+	if (mode == VSYNC_ADAPTIVE && (glfwExtensionSupported("WGL_EXT_swap_control_tear") || glfwExtensionSupported("GLX_EXT_swap_control_tear")))
+		return -1;
+	return 1;
+}
+
+// Holds the calling thread until the next frame is due and records the time of the last one
+void FramePacer::Wait(bool focused, bool minimized)
+{
+	Clock::time_point now = Clock::now();
+	double target = rate(focused, minimized);
+	if (target > 0.0)
+	{
+		Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / target));
+		deadline = started ? deadline + period : now;
+		if (now > deadline)
+		{
+			missedDeadlines++;
+			// more than a frame behind is a hitch, racing to catch up would only bunch the next frames
+			if (now - deadline > period)
+				deadline = now;
+		}
+
+		// sleep while the deadline is safely out of reach of the overshoot
+		double remaining = std::chrono::duration<double>(deadline - now).count();
+		if (remaining > sleepOvershoot)
+		{
+			double request = remaining - sleepOvershoot;
+			std::this_thread::sleep_for(std::chrono::duration<double>(request));
+			Clock::time_point woke = Clock::now();
+			double slept = std::chrono::duration<double>(woke - now).count();
+			// the worst recent overshoot, forgotten slowly so one late wake does not spin for the rest of the run
+			sleepOvershoot = std::min(0.02, std::max(0.00025, std::max(slept - request, sleepOvershoot * 0.95)));
+			sleepMilliseconds += slept * 1000.0;
+			now = woke;
+		}
+		// and spin through what is left
+		Clock::time_point spinStart = now;
+		while (now < deadline)
+		{
+			std::this_thread::yield();
+			now = Clock::now();
+		}
+		spinMilliseconds += std::chrono::duration<double, std::milli>(now - spinStart).count();
+	}
+	else
+		deadline = now;
+
+	if (started)
+	{
+		history[historyNext] = std::chrono::duration<double, std::milli>(now - lastFrame).count();
+		historyNext = (historyNext + 1) % HISTORY;
+		historyCount = std::min(historyCount + 1, HISTORY);
+	}
+	lastFrame = now;
+	started = true;
+	frames++;
+}
+
+// Forgets the last frame after the loop sat idle
+void FramePacer::Resume()
+{
+	started = false;
+}
+
+// Average frame time over the history in milliseconds
+double FramePacer::Average() const
+{
+	if (historyCount == 0)
+		return 0.0;
+	double sum = 0.0;
+	for (int i = 0; i < historyCount; i++)
+		sum += history[i];
+	return sum / historyCount;
+}
+
+// Frame time over the history that the given share of frames stays under, in milliseconds
+double FramePacer::Percentile(double percentile) const
+{
+	if (historyCount == 0)
+		return 0.0;
+	std::vector<double> sorted(history, history + historyCount);
+	size_t rank = std::min(sorted.size() - 1, (size_t)(percentile * sorted.size()));
+	std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+	return sorted[rank];
+}
+
+// Prints the stats
+void FramePacer::Print() const
+{
+	if (frames == 0)
+		return;
+	const char* modes[3] = { "off", "on", "adaptive" };
+	std::cout << "Frame pacing: vsync " << modes[swapMode] << ", ";
+	if (targetFps > 0.0)
+		std::cout << targetFps << " fps target, ";
+	else
+		std::cout << "no limit, ";
+	std::cout << "last " << historyCount << " frames " << Average() << " ms on average, " << Percentile(0.99) << " ms at the 99th percentile, "
+		<< missedDeadlines << " missed deadlines, " << sleepMilliseconds / frames << " ms slept and " << spinMilliseconds / frames << " ms spun per frame" << std::endl;
+}
+
+// Target of the current state of the window, 0 for none
+double FramePacer::rate(bool focused, bool minimized) const
+{
+	if (adaptive && minimized)
+		return minimizedFps;
+	if (adaptive && !focused)
+		return targetFps > 0.0 ? std::min(targetFps, unfocusedFps) : unfocusedFps;
+	return targetFps;
+}
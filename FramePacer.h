@@ -0,0 +1,76 @@
+#ifndef FRAME_PACER_CLASS_H
+#define FRAME_PACER_CLASS_H
+
+#include<chrono>
+#include<string>
+
+// Paces the main loop so the viewer does not build frames nobody sees. The swap mode picks the
+// swap interval of the render thread, and a frame rate limiter holds every frame until its deadline:
+// it sleeps while the deadline is further away than the sleep overshoot it has measured and
+// spins through the rest, which hits the deadline within microseconds without keeping a core busy.
+// In adaptive mode the rate drops while the window is unfocused or minimized. Frame times go into
+// a ring buffer the stats are taken from
+class FramePacer
+{
+public:
+	enum SwapMode
+	{
+		VSYNC_OFF,
+		VSYNC_ON,
+		// tears a late frame instead of waiting a whole refresh for it, plain vsync without the extension
+		VSYNC_ADAPTIVE
+	};
+
+	SwapMode swapMode = VSYNC_ON;
+	// Frames per second the limiter holds to, 0 leaves pacing to vsync or the render thread
+	double targetFps = 0.0;
+	// Rates while the window is unfocused or minimized, used when adaptive is set
+	bool adaptive = true;
+	double unfocusedFps = 15.0;
+	double minimizedFps = 2.0;
+
+	// Stats
+	unsigned long long frames = 0;
+	// frames that reached the limiter after their deadline had passed
+	unsigned long long missedDeadlines = 0;
+	double sleepMilliseconds = 0.0;
+	double spinMilliseconds = 0.0;
+
+	// Number of frame times the history keeps
+	static constexpr int HISTORY = 256;
+
+	FramePacer();
+	~FramePacer();
+
+	// Reads off, on or adaptive, false for anything else
+	bool ParseSwapMode(const std::string& name);
+	// Interval for glfwSwapInterval, call on the thread the context is current on
+	static int SwapInterval(SwapMode mode);
+	// Holds the calling thread until the next frame is due and records the time of the last one
+	void Wait(bool focused, bool minimized);
+	// Forgets the last frame after the loop sat idle, the next one is due right away and the idle
+	// time does not go into the history
+	void Resume();
+
+	// Frame time stats over the history in milliseconds, percentile between 0 and 1
+	double Average() const;
+	double Percentile(double percentile) const;
+	// Prints the stats
+	void Print() const;
+
+private:
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point deadline;
+	Clock::time_point lastFrame;
+	bool started = false;
+	// what sleep_for has been seen to sleep past its request, in seconds
+	double sleepOvershoot = 0.001;
+	double history[HISTORY];
+	int historyCount = 0;
+	int historyNext = 0;
+
+	// Target of the current state of the window, 0 for none
+	double rate(bool focused, bool minimized) const;
+};
+
+#endif
@@ -0,0 +1,76 @@
+#include"FramePipeline.h"
+
+#include<algorithm>
+#include<chrono>
+#include<iostream>
+
+// Main thread: the packet to fill next
+FramePacket& FramePipeline::Back()
+{
+	return packets[back];
+}
+
+// Main thread: makes the back packet the one the render thread gets next
+void FramePipeline::Publish()
+{
+	// counted first, so the render thread never sees a packet newer than the count
+	packets[back].frame = published.fetch_add(1, std::memory_order_relaxed) + 1;
+	// release hands the packet's contents over, acquire makes sure the render thread is done with the one coming back
+	int old = middle.exchange(back | FRESH, std::memory_order_acq_rel);
+	back = old & ~FRESH;
+	if (old & FRESH)
+		dropped++;
+	// taking the lock orders this with a render thread that found nothing and is about to sleep
+	{
+		std::lock_guard<std::mutex> guard(sleepLock);
+	}
+	wake.notify_one();
+}
+
+// True while a published packet waits for the render thread
+bool FramePipeline::Pending() const
+{
+	return (middle.load(std::memory_order_acquire) & FRESH) != 0;
+}
+
+// Render thread: the newest packet when one was published since the last call, NULL otherwise
+const FramePacket* FramePipeline::Acquire()
+{
+	if (!Pending())
+		return NULL;
+	int old = middle.exchange(front, std::memory_order_acq_rel);
+	front = old & ~FRESH;
+	acquired++;
+	return &packets[front];
+}
+
+// Render thread: like Acquire, but sleeps up to seconds for a packet when there is none
+const FramePacket* FramePipeline::Wait(double seconds)
+{
+	if (const FramePacket* packet = Acquire())
+		return packet;
+	{
+		std::unique_lock<std::mutex> guard(sleepLock);
+		wake.wait_for(guard, std::chrono::duration<double>(seconds), [this] { return Pending(); });
+	}
+	return Acquire();
+}
+
+// Render thread: records the latency and depth of a packet once its frame was swapped at time
+void FramePipeline::Presented(const FramePacket& packet, double time)
+{
+	double latency = (time - packet.inputTime) * 1000.0;
+	latencyMilliseconds += latency;
+	maxLatencyMilliseconds = std::max(maxLatencyMilliseconds, latency);
+	depthSum += published.load(std::memory_order_acquire) - packet.frame + 1;
+	presented++;
+}
+
+// Prints the stats
+void FramePipeline::Print() const
+{
+	if (presented == 0)
+		return;
+	std::cout << "Frame pipeline: " << published << " packets built, " << presented << " presented, " << dropped << " dropped, input to swap "
+		<< latencyMilliseconds / presented << " ms on average, " << maxLatencyMilliseconds << " ms at worst, " << (double)depthSum / presented << " frames deep" << std::endl;
+}
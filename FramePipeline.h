@@ -0,0 +1,86 @@
+#ifndef FRAME_PIPELINE_CLASS_H
+#define FRAME_PIPELINE_CLASS_H
+
+#include<glad/glad.h>
+#include<glm/glm.hpp>
+#include<atomic>
+#include<condition_variable>
+#include<memory>
+#include<mutex>
+#include<vector>
+
+#include"FrameData.h"
+
+// Everything the render thread needs to draw one frame, built on the main thread from the input of
+// that frame. Nothing in it changes once it is published
+struct FramePacket
+{
+	unsigned long long frame = 0;
+	// glfwGetTime when the input of this frame was read
+	double inputTime = 0.0;
+	FrameData frameData;
+	// size of the default framebuffer, the viewport follows it
+	int framebufferWidth = 0;
+	int framebufferHeight = 0;
+
+	// instances of every part that passed culling, an empty list skips the part
+	std::vector<std::vector<glm::mat4>> partTransforms;
+	std::vector<float> partDepths;
+	size_t instancesVisible = 0;
+
+	bool colorCode = false;
+	bool sectionView = false;
+	glm::vec4 clipPlane = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	// the caps of the last cut, only replaced when the plane moves
+	std::shared_ptr<const std::vector<GLfloat>> capVertices;
+	std::shared_ptr<const std::vector<GLuint>> capIndices;
+};
+
+// Hands frame packets from the main thread to the render thread through a lock free triple buffer.
+// The main thread fills the back packet and publishes it, which swaps it with the middle one; the
+// render thread acquires the middle one by swapping it with its front packet. Neither side ever waits
+// on the other, a packet published before the last one was acquired is dropped. Packets are reused,
+// so their vectors keep their capacity from frame to frame. A render thread with nothing to draw
+// sleeps in Wait, the lock there is only for sleeping and never guards a packet
+class FramePipeline
+{
+public:
+	// Stats, each written by one side and read once the render thread has stopped. published is read
+	// by the render thread to measure the depth
+	std::atomic<unsigned long long> published{ 0 };
+	unsigned long long dropped = 0;
+	unsigned long long acquired = 0;
+	unsigned long long presented = 0;
+	// from reading the input to the swap that shows it
+	double latencyMilliseconds = 0.0;
+	double maxLatencyMilliseconds = 0.0;
+	// packets published up to the one being shown, the one shown included
+	unsigned long long depthSum = 0;
+
+	// Main thread: the packet to fill next
+	FramePacket& Back();
+	// Main thread: makes the back packet the one the render thread gets next
+	void Publish();
+	// True while a published packet waits for the render thread
+	bool Pending() const;
+	// Render thread: the newest packet when one was published since the last call, NULL otherwise
+	const FramePacket* Acquire();
+	// Render thread: like Acquire, but sleeps up to seconds for a packet when there is none
+	const FramePacket* Wait(double seconds);
+	// Render thread: records the latency and depth of a packet once its frame was swapped at time
+	void Presented(const FramePacket& packet, double time);
+	// Prints the stats
+	void Print() const;
+
+private:
+	static const int FRESH = 4;
+	FramePacket packets[3];
+	// index of the middle packet, with FRESH set while it has not been acquired
+	std::atomic<int> middle{ 1 };
+	int back = 0;
+	int front = 2;
+	std::mutex sleepLock;
+	std::condition_variable wake;
+};
+
+#endif
@@ -0,0 +1,59 @@
+#include"GLExtensions.h"
+
+#include<GLFW/glfw3.h>
+
+bool GLExtensions::bufferStorage = false;
+PFNGLBUFFERSTORAGEPROC GLExtensions::BufferStorage = NULL;
+bool GLExtensions::multiDrawIndirect = false;
+PFNGLMULTIDRAWELEMENTSINDIRECTPROC GLExtensions::MultiDrawElementsIndirect = NULL;
+bool GLExtensions::programBinary = false;
+PFNGLGETPROGRAMBINARYPROC GLExtensions::GetProgramBinary = NULL;
+PFNGLPROGRAMBINARYPROC GLExtensions::ProgramBinary = NULL;
+PFNGLPROGRAMPARAMETERIPROC GLExtensions::ProgramParameteri = NULL;
+bool GLExtensions::parallelShaderCompile = false;
+PFNGLMAXSHADERCOMPILERTHREADSKHRPROC GLExtensions::MaxShaderCompilerThreads = NULL;
+bool GLExtensions::textureCompressionS3TC = false;
+bool GLExtensions::textureCompressionBPTC = false;
+
+// Looks up every entry point and sets the flags of the ones that can be used
+void GLExtensions::Load()
+{
+	BufferStorage = (PFNGLBUFFERSTORAGEPROC)glfwGetProcAddress("glBufferStorage");
+	bufferStorage = BufferStorage != NULL && (Version(4, 4) || glfwExtensionSupported("GL_ARB_buffer_storage"));
+
+	// the commands pick their instances with baseInstance, so base instance support is needed too
+	MultiDrawElementsIndirect = (PFNGLMULTIDRAWELEMENTSINDIRECTPROC)glfwGetProcAddress("glMultiDrawElementsIndirect");
+	multiDrawIndirect = MultiDrawElementsIndirect != NULL && (Version(4, 3)
+		|| (Version(4, 0) && glfwExtensionSupported("GL_ARB_multi_draw_indirect") && glfwExtensionSupported("GL_ARB_base_instance")));
+
+	// some drivers expose the entry points but no binary format, then nothing can be saved
+	GetProgramBinary = (PFNGLGETPROGRAMBINARYPROC)glfwGetProcAddress("glGetProgramBinary");
+	ProgramBinary = (PFNGLPROGRAMBINARYPROC)glfwGetProcAddress("glProgramBinary");
+	ProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)glfwGetProcAddress("glProgramParameteri");
+	programBinary = GetProgramBinary != NULL && ProgramBinary != NULL && ProgramParameteri != NULL
+		&& (Version(4, 1) || glfwExtensionSupported("GL_ARB_get_program_binary"));
+	if (programBinary)
+	{
+		GLint formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		programBinary = formats > 0;
+	}
+
+	if (glfwExtensionSupported("GL_KHR_parallel_shader_compile"))
+		MaxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+	else if (glfwExtensionSupported("GL_ARB_parallel_shader_compile"))
+		MaxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)glfwGetProcAddress("glMaxShaderCompilerThreadsARB");
+	parallelShaderCompile = MaxShaderCompilerThreads != NULL;
+	// let the driver pick how many threads it compiles on
+	if (parallelShaderCompile)
+		MaxShaderCompilerThreads(0xFFFFFFFFu);
+
+	textureCompressionS3TC = glfwExtensionSupported("GL_EXT_texture_compression_s3tc") != 0;
+	textureCompressionBPTC = Version(4, 2) || glfwExtensionSupported("GL_ARB_texture_compression_bptc");
+}
+
+// True when the context is at least the given core version
+bool GLExtensions::Version(int major, int minor)
+{
+	return GLVersion.major > major || (GLVersion.major == major && GLVersion.minor >= minor);
+}
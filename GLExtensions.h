@@ -0,0 +1,73 @@
+#ifndef GL_EXTENSIONS_CLASS_H
+#define GL_EXTENSIONS_CLASS_H
+
+#include<glad/glad.h>
+
+// glad is generated for plain GL 3.3, newer entry points are looked up here when the driver has them
+// either in core or as an extension. Load after gladLoadGL, with the context current
+
+// ARB_buffer_storage, core in 4.4
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#define GL_CLIENT_STORAGE_BIT 0x0200
+#endif
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+// ARB_multi_draw_indirect with ARB_base_instance, core in 4.3
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+typedef void (APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride);
+
+// ARB_get_program_binary, core in 4.1
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+typedef void (APIENTRYP PFNGLGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+typedef void (APIENTRYP PFNGLPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void (APIENTRYP PFNGLPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+
+// KHR_parallel_shader_compile or ARB_parallel_shader_compile, same token and entry point shape
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+// EXT_texture_compression_s3tc (BC1 to BC3) and ARB_texture_compression_bptc (BC7, core in 4.2)
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+
+class GLExtensions
+{
+public:
+	static bool bufferStorage;
+	static PFNGLBUFFERSTORAGEPROC BufferStorage;
+	static bool multiDrawIndirect;
+	static PFNGLMULTIDRAWELEMENTSINDIRECTPROC MultiDrawElementsIndirect;
+	static bool programBinary;
+	static PFNGLGETPROGRAMBINARYPROC GetProgramBinary;
+	static PFNGLPROGRAMBINARYPROC ProgramBinary;
+	static PFNGLPROGRAMPARAMETERIPROC ProgramParameteri;
+	// When set, compiles and links run on driver threads and GL_COMPLETION_STATUS_KHR can be polled
+	static bool parallelShaderCompile;
+	static PFNGLMAXSHADERCOMPILERTHREADSKHRPROC MaxShaderCompilerThreads;
+	// Block compressed texture formats, uploaded with the core glCompressedTexImage2D
+	static bool textureCompressionS3TC;
+	static bool textureCompressionBPTC;
+
+	// Looks up every entry point and sets the flags of the ones that can be used
+	static void Load();
+	// True when the context is at least the given core version
+	static bool Version(int major, int minor);
+};
+
+#endif
@@ -0,0 +1,74 @@
+#include"GLResources.h"
+
+#include<algorithm>
+
+#include"GLState.h"
+
+std::mutex GLResources::mutex;
+std::map<std::pair<GLResources::Type, GLuint>, GLResources::Live> GLResources::live;
+std::vector<std::pair<GLResources::Type, GLuint>> GLResources::pending;
+unsigned long long GLResources::serial = 0;
+
+// Records a new object, label says where it came from in the leak dump
+void GLResources::Track(Type type, GLuint id, const std::string& label)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	live[std::make_pair(type, id)] = Live{ label, serial++ };
+}
+
+// Queues an object for deletion, safe from any thread
+void GLResources::Release(Type type, GLuint id)
+{
+	if (id == 0)
+		return;
+	std::lock_guard<std::mutex> lock(mutex);
+	pending.push_back(std::make_pair(type, id));
+}
+
+// Deletes everything queued, call on the GL thread once per frame
+void GLResources::Collect()
+{
+	std::vector<std::pair<Type, GLuint>> deleting;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		deleting.swap(pending);
+		for (std::pair<Type, GLuint>& object : deleting)
+			live.erase(object);
+	}
+
+	// the deletes go through the state cache so it forgets the bindings
+	for (std::pair<Type, GLuint>& object : deleting)
+	{
+		switch (object.first)
+		{
+		case BUFFER: GLState::DeleteBuffer(object.second); break;
+		case VERTEX_ARRAY: GLState::DeleteVertexArray(object.second); break;
+		case TEXTURE: GLState::DeleteTexture(object.second); break;
+		case PROGRAM: GLState::DeleteProgram(object.second); break;
+		}
+	}
+}
+
+// Number of tracked objects that are not deleted yet
+size_t GLResources::LiveCount()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return live.size();
+}
+
+// Prints every tracked object that is not deleted yet
+void GLResources::Dump(std::ostream& out)
+{
+	static const char* names[] = { "buffer", "vertex array", "texture", "program" };
+	std::vector<std::pair<unsigned long long, std::string>> lines;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (auto& object : live)
+			lines.push_back(std::make_pair(object.second.serial, std::string(names[object.first.first]) + " " + std::to_string(object.first.second) + " " + object.second.label));
+	}
+	// in creation order, the first leak is usually the interesting one
+	std::sort(lines.begin(), lines.end());
+	out << lines.size() << " live GL objects" << std::endl;
+	for (auto& line : lines)
+		out << "  " << line.second << std::endl;
+}
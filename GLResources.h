@@ -0,0 +1,51 @@
+#ifndef GL_RESOURCES_CLASS_H
+#define GL_RESOURCES_CLASS_H
+
+#include<glad/glad.h>
+#include<iostream>
+#include<map>
+#include<mutex>
+#include<string>
+#include<utility>
+#include<vector>
+
+// Registry of every live GL object owned by a wrapper, and the queue their deletes wait in.
+// Wrappers release from any thread at any time, the objects are deleted on the GL thread when
+// Collect runs at the end of the frame, so nothing the current frame still uses goes away
+class GLResources
+{
+public:
+	enum Type
+	{
+		BUFFER,
+		VERTEX_ARRAY,
+		TEXTURE,
+		PROGRAM
+	};
+
+	// Records a new object, label says where it came from in the leak dump
+	static void Track(Type type, GLuint id, const std::string& label);
+	// Queues an object for deletion, safe from any thread
+	static void Release(Type type, GLuint id);
+	// Deletes everything queued, call on the GL thread once per frame
+	static void Collect();
+
+	// Number of tracked objects that are not deleted yet
+	static size_t LiveCount();
+	// Prints every tracked object that is not deleted yet
+	static void Dump(std::ostream& out);
+
+private:
+	struct Live
+	{
+		std::string label;
+		unsigned long long serial;
+	};
+
+	static std::mutex mutex;
+	static std::map<std::pair<Type, GLuint>, Live> live;
+	static std::vector<std::pair<Type, GLuint>> pending;
+	static unsigned long long serial;
+};
+
+#endif
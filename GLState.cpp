@@ -0,0 +1,199 @@
+#include"GLState.h"
+
+#include<cstddef>
+
+GLState::Counters GLState::counters;
+GLuint GLState::program = GLState::UNKNOWN;
+GLuint GLState::vertexArray = GLState::UNKNOWN;
+GLuint GLState::activeUnit = GLState::UNKNOWN;
+std::unordered_map<GLenum, GLuint> GLState::buffers;
+std::unordered_map<GLuint, GLuint> GLState::elementBuffers;
+GLuint GLState::textures[GLState::TEXTURE_UNITS][GLState::TEXTURE_TARGETS];
+std::unordered_map<GLenum, bool> GLState::caps;
+
+namespace
+{
+	// the static table starts zeroed, which would read as "texture 0 is bound" before Invalidate
+	struct InitialState
+	{
+		InitialState() { GLState::Invalidate(); }
+	} initialState;
+}
+
+void GLState::UseProgram(GLuint id)
+{
+	if (program == id)
+	{
+		counters.elided++;
+		return;
+	}
+	program = id;
+	counters.issued++;
+	glUseProgram(id);
+}
+
+void GLState::BindVertexArray(GLuint vao)
+{
+	if (vertexArray == vao)
+	{
+		counters.elided++;
+		return;
+	}
+	vertexArray = vao;
+	counters.issued++;
+	glBindVertexArray(vao);
+}
+
+void GLState::BindBuffer(GLenum target, GLuint buffer)
+{
+	// the element buffer is looked up in the current VAO, an unknown VAO knows nothing
+	GLuint* bound = NULL;
+	if (target == GL_ELEMENT_ARRAY_BUFFER)
+	{
+		if (vertexArray != UNKNOWN)
+			bound = &elementBuffers.emplace(vertexArray, UNKNOWN).first->second;
+	}
+	else
+		bound = &buffers.emplace(target, UNKNOWN).first->second;
+
+	if (bound != NULL && *bound == buffer)
+	{
+		counters.elided++;
+		return;
+	}
+	if (bound != NULL)
+		*bound = buffer;
+	counters.issued++;
+	glBindBuffer(target, buffer);
+}
+
+// Binds to an indexed binding point, which also replaces the generic binding of the target
+void GLState::BindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+	buffers[target] = buffer;
+	counters.issued++;
+	glBindBufferBase(target, index, buffer);
+}
+
+// Binds to the active texture unit
+void GLState::BindTexture(GLenum target, GLuint texture)
+{
+	int index = textureTarget(target);
+	GLuint unit = activeUnit - GL_TEXTURE0;
+	if (index < 0 || activeUnit == UNKNOWN || unit >= (GLuint)TEXTURE_UNITS)
+	{
+		counters.issued++;
+		glBindTexture(target, texture);
+		return;
+	}
+	if (textures[unit][index] == texture)
+	{
+		counters.elided++;
+		return;
+	}
+	textures[unit][index] = texture;
+	counters.issued++;
+	glBindTexture(target, texture);
+}
+
+void GLState::ActiveTexture(GLenum unit)
+{
+	if (activeUnit == unit)
+	{
+		counters.elided++;
+		return;
+	}
+	activeUnit = unit;
+	counters.issued++;
+	glActiveTexture(unit);
+}
+
+void GLState::Enable(GLenum cap)
+{
+	auto found = caps.find(cap);
+	if (found != caps.end() && found->second)
+	{
+		counters.elided++;
+		return;
+	}
+	caps[cap] = true;
+	counters.issued++;
+	glEnable(cap);
+}
+
+void GLState::Disable(GLenum cap)
+{
+	auto found = caps.find(cap);
+	if (found != caps.end() && !found->second)
+	{
+		counters.elided++;
+		return;
+	}
+	caps[cap] = false;
+	counters.issued++;
+	glDisable(cap);
+}
+
+void GLState::DeleteProgram(GLuint id)
+{
+	// a deleted program stays in use until something else is, but its ID can be handed out again
+	if (program == id)
+		program = UNKNOWN;
+	glDeleteProgram(id);
+}
+
+void GLState::DeleteVertexArray(GLuint vao)
+{
+	if (vertexArray == vao)
+		vertexArray = 0;
+	elementBuffers.erase(vao);
+	glDeleteVertexArrays(1, &vao);
+}
+
+void GLState::DeleteBuffer(GLuint buffer)
+{
+	for (auto& bound : buffers)
+		if (bound.second == buffer)
+			bound.second = 0;
+	// only the current VAO drops the binding, others keep a dangling reference, so forget them all
+	for (auto& bound : elementBuffers)
+		if (bound.second == buffer)
+			bound.second = UNKNOWN;
+	glDeleteBuffers(1, &buffer);
+}
+
+void GLState::DeleteTexture(GLuint texture)
+{
+	for (int unit = 0; unit < TEXTURE_UNITS; unit++)
+		for (int index = 0; index < TEXTURE_TARGETS; index++)
+			if (textures[unit][index] == texture)
+				textures[unit][index] = 0;
+	glDeleteTextures(1, &texture);
+}
+
+// Forgets everything, for code that changed state behind the cache's back
+void GLState::Invalidate()
+{
+	program = UNKNOWN;
+	vertexArray = UNKNOWN;
+	activeUnit = UNKNOWN;
+	buffers.clear();
+	elementBuffers.clear();
+	for (int unit = 0; unit < TEXTURE_UNITS; unit++)
+		for (int index = 0; index < TEXTURE_TARGETS; index++)
+			textures[unit][index] = UNKNOWN;
+	caps.clear();
+}
+
+// Index of a texture target in the per unit table, -1 for targets that are not cached
+int GLState::textureTarget(GLenum target)
+{
+	switch (target)
+	{
+	case GL_TEXTURE_2D: return 0;
+	case GL_TEXTURE_2D_ARRAY: return 1;
+	case GL_TEXTURE_CUBE_MAP: return 2;
+	case GL_TEXTURE_3D: return 3;
+	default: return -1;
+	}
+}
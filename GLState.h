@@ -0,0 +1,59 @@
+#ifndef GL_STATE_CLASS_H
+#define GL_STATE_CLASS_H
+
+#include<glad/glad.h>
+#include<unordered_map>
+
+// Shadow copy of the binding state of the one GL context, every wrapper binds through here and
+// calls that would not change anything never reach the driver.
+// The element buffer binding belongs to the VAO, so it is remembered per VAO
+class GLState
+{
+public:
+	// Calls that reached the driver and calls that were skipped because nothing changed
+	struct Counters
+	{
+		unsigned long long issued = 0;
+		unsigned long long elided = 0;
+	};
+	static Counters counters;
+
+	static void UseProgram(GLuint program);
+	static void BindVertexArray(GLuint vao);
+	static void BindBuffer(GLenum target, GLuint buffer);
+	// Binds to an indexed binding point, which also replaces the generic binding of the target
+	static void BindBufferBase(GLenum target, GLuint index, GLuint buffer);
+	// Binds to the active texture unit
+	static void BindTexture(GLenum target, GLuint texture);
+	static void ActiveTexture(GLenum unit);
+	static void Enable(GLenum cap);
+	static void Disable(GLenum cap);
+
+	// Deletes and forgets every binding of the object, GL unbinds deleted objects and a new object
+	// may come back with the same ID
+	static void DeleteProgram(GLuint program);
+	static void DeleteVertexArray(GLuint vao);
+	static void DeleteBuffer(GLuint buffer);
+	static void DeleteTexture(GLuint texture);
+
+	// Forgets everything, for code that changed state behind the cache's back
+	static void Invalidate();
+
+private:
+	static constexpr GLuint UNKNOWN = 0xFFFFFFFFu;
+	static constexpr int TEXTURE_UNITS = 32;
+	static constexpr int TEXTURE_TARGETS = 4;
+
+	static GLuint program;
+	static GLuint vertexArray;
+	static GLuint activeUnit;
+	static std::unordered_map<GLenum, GLuint> buffers;
+	static std::unordered_map<GLuint, GLuint> elementBuffers;
+	static GLuint textures[TEXTURE_UNITS][TEXTURE_TARGETS];
+	static std::unordered_map<GLenum, bool> caps;
+
+	// Index of a texture target in the per unit table, -1 for targets that are not cached
+	static int textureTarget(GLenum target);
+};
+
+#endif
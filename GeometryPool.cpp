@@ -0,0 +1,217 @@
+#include"GeometryPool.h"
+
+#include<algorithm>
+#include<cstring>
+
+#include"GLExtensions.h"
+#include"GLState.h"
+
+// Constructor that allocates the buffers and links the per vertex attributes
+GeometryPool::Page::Page(GLuint vertexCount, GLuint indexCount)
+	: vertices((GLfloat*)NULL, (GLsizeiptr)vertexCount * Mesh::stride * sizeof(GLfloat)),
+	  occlusion((GLubyte*)NULL, vertexCount),
+	  indices(NULL, (GLsizeiptr)indexCount * sizeof(GLuint)),
+	  vertexSpace(vertexCount),
+	  indexSpace(indexCount)
+{
+	// the element buffer binding is part of the VAO state so it is bound again with the VAO active
+	vao.Bind();
+	indices.Bind();
+	vao.LinkAttrib(vertices, 0, 3, GL_FLOAT, Mesh::stride * sizeof(float), (void*)0);
+	vao.LinkAttrib(vertices, 1, 3, GL_FLOAT, Mesh::stride * sizeof(float), (void*)(3 * sizeof(float)));
+	vao.LinkAttrib(vertices, 2, 2, GL_FLOAT, Mesh::stride * sizeof(float), (void*)(6 * sizeof(float)));
+	vao.LinkAttrib(occlusion, 7, 1, GL_UNSIGNED_BYTE, 1, (void*)0, 0, GL_TRUE);
+	vao.Unbind();
+}
+
+// Constructor for an empty pool, pages are added as meshes need them
+GeometryPool::GeometryPool()
+	: instanceStream(GL_ARRAY_BUFFER, 1 << 20), indirectStream(GL_DRAW_INDIRECT_BUFFER, 1 << 16)
+{
+	multiDrawIndirect = GLExtensions::multiDrawIndirect;
+}
+
+// Copies a mesh and its baked occlusion (one byte per vertex, may be empty) into a page
+GeometryHandle GeometryPool::Add(const Mesh& mesh, const std::vector<GLubyte>& occlusion)
+{
+	GeometryHandle handle;
+	GLuint vertexCount = (GLuint)mesh.VertexCount();
+	GLuint indexCount = (GLuint)mesh.indices.size();
+	if (vertexCount == 0 || indexCount == 0)
+		return handle;
+
+	// first page with room for both, otherwise a new page big enough for the mesh
+	for (uint32_t page = 0; page <= pages.size(); page++)
+	{
+		if (page == pages.size())
+		{
+			// no VAO may be bound while the page's EBO is created, it would be attached to that VAO
+			GLState::BindVertexArray(0);
+			pages.emplace_back(new Page(std::max(verticesPerPage, vertexCount), std::max(indicesPerPage, indexCount)));
+		}
+		Page& candidate = *pages[page];
+		OffsetAllocator::Allocation vertices = candidate.vertexSpace.Allocate(vertexCount);
+		if (vertices.offset == OffsetAllocator::NO_SPACE)
+			continue;
+		OffsetAllocator::Allocation indices = candidate.indexSpace.Allocate(indexCount);
+		if (indices.offset == OffsetAllocator::NO_SPACE)
+		{
+			candidate.vertexSpace.Free(vertices);
+			continue;
+		}
+		handle.page = page;
+		handle.vertices = vertices;
+		handle.indices = indices;
+		handle.baseVertex = (GLint)vertices.offset;
+		handle.firstIndex = indices.offset;
+		handle.indexCount = indexCount;
+		break;
+	}
+
+	// the copy target leaves the array buffer and the VAO's element buffer alone
+	Page& page = *pages[handle.page];
+	GLState::BindBuffer(GL_COPY_WRITE_BUFFER, page.vertices.ID);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)handle.baseVertex * Mesh::stride * sizeof(GLfloat), mesh.vertices.size() * sizeof(GLfloat), mesh.vertices.data());
+	GLState::BindBuffer(GL_COPY_WRITE_BUFFER, page.indices.ID);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)handle.firstIndex * sizeof(GLuint), indexCount * sizeof(GLuint), mesh.indices.data());
+	std::vector<GLubyte> open;
+	if (occlusion.size() != vertexCount)
+		open.assign(vertexCount, 255);
+	GLState::BindBuffer(GL_COPY_WRITE_BUFFER, page.occlusion.ID);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, handle.baseVertex, vertexCount, open.empty() ? occlusion.data() : open.data());
+	return handle;
+}
+
+// Frees the space of a mesh
+void GeometryPool::Remove(GeometryHandle& handle)
+{
+	if (handle.page >= pages.size())
+		return;
+	pages[handle.page]->vertexSpace.Free(handle.vertices);
+	pages[handle.page]->indexSpace.Free(handle.indices);
+	handle = GeometryHandle();
+}
+
+// Queues every transform of a mesh for the next Flush, atlasSlot is the TextureAtlas slot every instance reads
+void GeometryPool::Draw(const GeometryHandle& handle, const std::vector<glm::mat4>& transforms, float atlasSlot)
+{
+	if (handle.page >= pages.size() || transforms.empty())
+		return;
+	DrawElementsIndirectCommand command = { handle.indexCount, (GLuint)transforms.size(), handle.firstIndex, handle.baseVertex, (GLuint)queuedTransforms.size() };
+	queued.push_back(QueuedDraw{ handle.page, command });
+	queuedTransforms.insert(queuedTransforms.end(), transforms.begin(), transforms.end());
+	queuedSlots.insert(queuedSlots.end(), transforms.size(), atlasSlot);
+}
+
+// Issues the queued draws with the current program and material, one multi draw per page
+void GeometryPool::Flush()
+{
+	if (queued.empty())
+		return;
+
+	// instance matrices of every draw in one allocation followed by their atlas slots,
+	// the commands index both with baseInstance
+	GLsizeiptr matrixBytes = queuedTransforms.size() * sizeof(glm::mat4);
+	GLsizeiptr instanceBytes = matrixBytes + queuedSlots.size() * sizeof(float);
+	instanceBytesThisFrame += instanceBytes;
+	// the first Flush of a frame grows the streams to what it needs, so a big frame is not dropped.
+	// Later ones can only grow them for the next frame, EndFrame reports that
+	instanceStream.Reserve(instanceBytes + sizeof(glm::mat4));
+	if (multiDrawIndirect)
+		indirectStream.Reserve(queued.size() * sizeof(DrawElementsIndirectCommand) + sizeof(GLuint));
+	StreamBuffer::Allocation instances = instanceStream.Allocate(instanceBytes, sizeof(glm::mat4));
+	if (instances.pointer == NULL)
+		dropped = true;
+	if (instances.pointer != NULL)
+	{
+		std::memcpy(instances.pointer, queuedTransforms.data(), matrixBytes);
+		std::memcpy((char*)instances.pointer + matrixBytes, queuedSlots.data(), instanceBytes - matrixBytes);
+	}
+	instanceStream.Commit(instances);
+	GLintptr slotOffset = instances.offset + matrixBytes;
+
+	std::stable_sort(queued.begin(), queued.end(), [](const QueuedDraw& a, const QueuedDraw& b) { return a.page < b.page; });
+	std::vector<DrawElementsIndirectCommand> pageCommands;
+	for (size_t first = 0; first < queued.size() && instances.pointer != NULL;)
+	{
+		size_t last = first;
+		pageCommands.clear();
+		while (last < queued.size() && queued[last].page == queued[first].page)
+			pageCommands.push_back(queued[last++].command);
+
+		Page& page = *pages[queued[first].page];
+		page.vao.Bind();
+		commands += (unsigned)pageCommands.size();
+
+		if (multiDrawIndirect)
+		{
+			GLsizeiptr commandBytes = pageCommands.size() * sizeof(DrawElementsIndirectCommand);
+			indirectBytesThisFrame += commandBytes;
+			StreamBuffer::Allocation indirect = indirectStream.Allocate(commandBytes, sizeof(GLuint));
+			if (indirect.pointer != NULL)
+			{
+				std::memcpy(indirect.pointer, pageCommands.data(), commandBytes);
+				indirectStream.Commit(indirect);
+				// a mat4 attribute is four vec4 columns on consecutive locations
+				for (GLuint column = 0; column < 4; column++)
+					page.vao.LinkAttrib(instanceStream.ID, 3 + column, 4, GL_FLOAT, sizeof(glm::mat4), (void*)(instances.offset + column * sizeof(glm::vec4)), 1);
+				page.vao.LinkAttrib(instanceStream.ID, 8, 1, GL_FLOAT, sizeof(float), (void*)slotOffset, 1);
+				indirectStream.Bind();
+				GLExtensions::MultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)indirect.offset, (GLsizei)pageCommands.size(), 0);
+				drawCalls++;
+			}
+			else
+				dropped = true;
+		}
+		else
+		{
+			// without base instance the instance attributes are pointed at each draw's matrices
+			for (DrawElementsIndirectCommand& command : pageCommands)
+			{
+				for (GLuint column = 0; column < 4; column++)
+					page.vao.LinkAttrib(instanceStream.ID, 3 + column, 4, GL_FLOAT, sizeof(glm::mat4), (void*)(instances.offset + command.baseInstance * sizeof(glm::mat4) + column * sizeof(glm::vec4)), 1);
+				page.vao.LinkAttrib(instanceStream.ID, 8, 1, GL_FLOAT, sizeof(float), (void*)(slotOffset + command.baseInstance * sizeof(float)), 1);
+				glDrawElementsInstancedBaseVertex(GL_TRIANGLES, command.count, GL_UNSIGNED_INT, (void*)(command.firstIndex * sizeof(GLuint)), command.instanceCount, command.baseVertex);
+				drawCalls++;
+			}
+		}
+		first = last;
+	}
+
+	queued.clear();
+	queuedTransforms.clear();
+	queuedSlots.clear();
+}
+
+// Fences this frame's instance and command data, call once per frame after the last Flush.
+// True when draws did not fit and were skipped, the next frame has room for them
+bool GeometryPool::EndFrame()
+{
+	instanceStream.EndFrame();
+	indirectStream.EndFrame();
+	// a frame that did not fit grows the streams before the next one starts
+	instanceStream.Reserve(instanceBytesThisFrame + sizeof(glm::mat4));
+	indirectStream.Reserve(indirectBytesThisFrame + sizeof(GLuint));
+	instanceBytesThisFrame = 0;
+	indirectBytesThisFrame = 0;
+	drawCalls = 0;
+	commands = 0;
+	bool skipped = dropped;
+	dropped = false;
+	return skipped;
+}
+
+// Deletes every page and stream
+void GeometryPool::Delete()
+{
+	for (std::unique_ptr<Page>& page : pages)
+	{
+		page->vao.Delete();
+		page->vertices.Delete();
+		page->occlusion.Delete();
+		page->indices.Delete();
+	}
+	pages.clear();
+	instanceStream.Delete();
+	indirectStream.Delete();
+}
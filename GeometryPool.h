@@ -0,0 +1,103 @@
+#ifndef GEOMETRY_POOL_CLASS_H
+#define GEOMETRY_POOL_CLASS_H
+
+#include<glad/glad.h>
+#include<glm/glm.hpp>
+#include<memory>
+#include<vector>
+
+#include"Mesh.h"
+#include"OffsetAllocator.h"
+#include"StreamBuffer.h"
+#include"VAO.h"
+#include"VBO.h"
+#include"EBO.h"
+
+// Where a mesh lives inside the pool
+struct GeometryHandle
+{
+	uint32_t page = OffsetAllocator::NO_SPACE;
+	GLint baseVertex = 0;
+	GLuint firstIndex = 0;
+	GLuint indexCount = 0;
+	OffsetAllocator::Allocation vertices;
+	OffsetAllocator::Allocation indices;
+};
+
+// Layout glMultiDrawElementsIndirect reads
+struct DrawElementsIndirectCommand
+{
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+// Keeps many meshes in a few large vertex and index buffers ("pages") instead of a VBO, EBO and VAO each.
+// Space in a page is handed out by an OffsetAllocator, and every frame the queued draws of a page go out
+// as one glMultiDrawElementsIndirect. On GL 3.3 every draw is a glDrawElementsInstancedBaseVertex, which
+// still shares the page's VAO
+class GeometryPool
+{
+public:
+	// Vertex and index buffers of one page with the VAO that reads them, instance matrices and atlas slots come from a stream
+	struct Page
+	{
+		VAO vao;
+		VBO vertices;
+		VBO occlusion;
+		EBO indices;
+		OffsetAllocator vertexSpace;
+		OffsetAllocator indexSpace;
+
+		// Constructor that allocates the buffers and links the per vertex attributes
+		Page(GLuint vertexCount, GLuint indexCount);
+	};
+
+	GLuint verticesPerPage = 1 << 20;
+	GLuint indicesPerPage = 1 << 22;
+	std::vector<std::unique_ptr<Page>> pages;
+	bool multiDrawIndirect;
+
+	// Stats of the frame so far
+	unsigned drawCalls = 0;
+	unsigned commands = 0;
+
+	// Constructor for an empty pool, pages are added as meshes need them
+	GeometryPool();
+
+	// Copies a mesh and its baked occlusion (one byte per vertex, may be empty) into a page
+	GeometryHandle Add(const Mesh& mesh, const std::vector<GLubyte>& occlusion);
+	// Frees the space of a mesh
+	void Remove(GeometryHandle& handle);
+
+	// Queues every transform of a mesh for the next Flush, atlasSlot is the TextureAtlas slot
+	// every instance reads at location 8
+	void Draw(const GeometryHandle& handle, const std::vector<glm::mat4>& transforms, float atlasSlot = 0.0f);
+	// Issues the queued draws with the current program and material, one multi draw per page
+	void Flush();
+	// Fences this frame's instance and command data, call once per frame after the last Flush.
+	// True when draws did not fit the streams and were skipped, the next frame has room for them
+	bool EndFrame();
+	// Deletes every page and stream
+	void Delete();
+
+private:
+	struct QueuedDraw
+	{
+		uint32_t page;
+		DrawElementsIndirectCommand command;
+	};
+	std::vector<QueuedDraw> queued;
+	std::vector<glm::mat4> queuedTransforms;
+	std::vector<float> queuedSlots;
+	StreamBuffer instanceStream;
+	StreamBuffer indirectStream;
+	GLsizeiptr instanceBytesThisFrame = 0;
+	GLsizeiptr indirectBytesThisFrame = 0;
+	// a Flush this frame skipped draws
+	bool dropped = false;
+};
+
+#endif
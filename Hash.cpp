@@ -0,0 +1,51 @@
+#include"Hash.h"
+
+#include<cstring>
+
+namespace
+{
+	uint64_t mix(uint64_t h)
+	{
+		h ^= h >> 33;
+		h *= 0xFF51AFD7ED558CCDull;
+		h ^= h >> 33;
+		h *= 0xC4CEB9FE1A85EC53ull;
+		h ^= h >> 33;
+		return h;
+	}
+}
+
+// Fast non-cryptographic 64 bit hash used to key on-disk caches by content,
+// chain calls by passing the previous result as the seed
+uint64_t hash_bytes(const void* data, size_t size, uint64_t seed)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	uint64_t h = seed ^ (size * 0x9E3779B97F4A7C15ull);
+
+	// whole words first, multiply-rotate per word keeps it at memory speed
+	size_t words = size / 8;
+	for (size_t i = 0; i < words; i++)
+	{
+		uint64_t w;
+		std::memcpy(&w, bytes + i * 8, 8);
+		w *= 0x87C37B91114253D5ull;
+		w = (w << 31) | (w >> 33);
+		h ^= w;
+		h = ((h << 27) | (h >> 37)) * 5 + 0x52DCE729;
+	}
+
+	uint64_t tail = 0;
+	std::memcpy(&tail, bytes + words * 8, size - words * 8);
+	h ^= tail * 0x4CF5AD432745937Full;
+	return mix(h);
+}
+
+// Hash as 16 hex digits, for cache file names
+std::string hash_to_hex(uint64_t hash)
+{
+	const char* digits = "0123456789abcdef";
+	std::string hex(16, '0');
+	for (int i = 15; i >= 0; i--, hash >>= 4)
+		hex[i] = digits[hash & 0xF];
+	return hex;
+}
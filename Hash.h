@@ -0,0 +1,21 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include<cstddef>
+#include<cstdint>
+#include<string>
+
+// Fast non-cryptographic 64 bit hash used to key on-disk caches by content,
+// chain calls by passing the previous result as the seed
+uint64_t hash_bytes(const void* data, size_t size, uint64_t seed = 0x9E3779B97F4A7C15ull);
+
+// FNV-1a of a zero terminated string, constexpr so names known at compile time cost nothing at run time
+constexpr uint64_t hash_string(const char* text, uint64_t hash = 0xCBF29CE484222325ull)
+{
+	return *text ? hash_string(text + 1, (hash ^ (uint8_t)*text) * 0x100000001B3ull) : hash;
+}
+
+// Hash as 16 hex digits, for cache file names
+std::string hash_to_hex(uint64_t hash);
+
+#endif
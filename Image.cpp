@@ -0,0 +1,130 @@
+#include"Image.h"
+
+#include<stb/stb_image.h>
+#include<algorithm>
+#include<array>
+#include<cerrno>
+#include<cstdint>
+#include<cstring>
+#include<fstream>
+
+namespace
+{
+	uint32_t crc32(const unsigned char* data, size_t size, uint32_t crc = 0)
+	{
+		// thumbnail workers write PNGs at the same time, a function local static is built exactly once
+		static const std::array<uint32_t, 256> table = []()
+		{
+			std::array<uint32_t, 256> entries;
+			for (uint32_t i = 0; i < 256; i++)
+			{
+				uint32_t c = i;
+				for (int k = 0; k < 8; k++)
+					c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				entries[i] = c;
+			}
+			return entries;
+		}();
+		crc = ~crc;
+		for (size_t i = 0; i < size; i++)
+			crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		return ~crc;
+	}
+
+	void putBigEndian(std::vector<unsigned char>& out, uint32_t value)
+	{
+		out.push_back((unsigned char)(value >> 24));
+		out.push_back((unsigned char)(value >> 16));
+		out.push_back((unsigned char)(value >> 8));
+		out.push_back((unsigned char)value);
+	}
+
+	void writeChunk(std::ofstream& file, const char* type, const std::vector<unsigned char>& data)
+	{
+		std::vector<unsigned char> chunk;
+		putBigEndian(chunk, (uint32_t)data.size());
+		chunk.insert(chunk.end(), type, type + 4);
+		chunk.insert(chunk.end(), data.begin(), data.end());
+		putBigEndian(chunk, crc32(chunk.data() + 4, chunk.size() - 4));
+		file.write((const char*)chunk.data(), chunk.size());
+	}
+}
+
+// Constructor for an empty image
+Image::Image()
+{
+}
+
+// Constructor for a black image of the given size
+Image::Image(int width, int height, int channels)
+	: width(width), height(height), channels(channels), pixels((size_t)width * height * channels, 0)
+{
+}
+
+// Constructor that decodes a file with stb_image, flipped so the first row is the bottom one
+Image::Image(const char* filename)
+{
+	// the thread local flag leaves the global one alone and is safe to call from worker threads
+	stbi_set_flip_vertically_on_load_thread(true);
+	unsigned char* bytes = stbi_load(filename, &width, &height, &channels, 0);
+	if (bytes == NULL)
+		throw(errno);
+	pixels.assign(bytes, bytes + (size_t)width * height * channels);
+	stbi_image_free(bytes);
+}
+
+// Writes the image as a PNG with the top row first
+bool Image::WritePNG(const char* filename) const
+{
+	std::ofstream file(filename, std::ios::binary);
+	if (!file)
+		return false;
+
+	const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	file.write((const char*)signature, 8);
+
+	const unsigned char colorTypes[5] = { 0, 0, 4, 2, 6 };
+	std::vector<unsigned char> header;
+	putBigEndian(header, (uint32_t)width);
+	putBigEndian(header, (uint32_t)height);
+	header.insert(header.end(), { 8, colorTypes[channels], 0, 0, 0 });
+	writeChunk(file, "IHDR", header);
+
+	// filter byte 0 (none) in front of every row, top row first
+	size_t rowSize = (size_t)width * channels;
+	std::vector<unsigned char> raw;
+	raw.reserve((rowSize + 1) * height);
+	for (int y = height - 1; y >= 0; y--)
+	{
+		raw.push_back(0);
+		raw.insert(raw.end(), pixels.begin() + y * rowSize, pixels.begin() + (y + 1) * rowSize);
+	}
+
+	// zlib stream made of stored deflate blocks, thumbnails are small enough that skipping
+	// compression beats pulling in a deflate implementation
+	std::vector<unsigned char> zlib = { 0x78, 0x01 };
+	size_t offset = 0;
+	do
+	{
+		size_t block = std::min<size_t>(65535, raw.size() - offset);
+		bool last = offset + block == raw.size();
+		zlib.push_back(last ? 1 : 0);
+		zlib.push_back((unsigned char)(block & 0xFF));
+		zlib.push_back((unsigned char)(block >> 8));
+		zlib.push_back((unsigned char)(~block & 0xFF));
+		zlib.push_back((unsigned char)((~block >> 8) & 0xFF));
+		zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + block);
+		offset += block;
+	} while (offset < raw.size());
+
+	uint32_t a = 1, b = 0;
+	for (unsigned char byte : raw)
+	{
+		a = (a + byte) % 65521;
+		b = (b + a) % 65521;
+	}
+	putBigEndian(zlib, (b << 16) | a);
+	writeChunk(file, "IDAT", zlib);
+	writeChunk(file, "IEND", std::vector<unsigned char>());
+	return (bool)file;
+}
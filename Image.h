@@ -0,0 +1,27 @@
+#ifndef IMAGE_CLASS_H
+#define IMAGE_CLASS_H
+
+#include<vector>
+
+// 8 bit image kept on the CPU, for the software rasterizer and anything else that needs the
+// pixels after the upload. Rows are stored bottom up like OpenGL textures and framebuffers
+class Image
+{
+public:
+	int width = 0;
+	int height = 0;
+	int channels = 0;
+	std::vector<unsigned char> pixels;
+
+	// Constructor for an empty image
+	Image();
+	// Constructor for a black image of the given size
+	Image(int width, int height, int channels);
+	// Constructor that decodes a file with stb_image, flipped so the first row is the bottom one
+	Image(const char* filename);
+
+	// Writes the image as a PNG with the top row first
+	bool WritePNG(const char* filename) const;
+};
+
+#endif
@@ -0,0 +1,101 @@
+#include"InputQueue.h"
+
+// Installs the callbacks, the queue becomes the window's user pointer
+void InputQueue::Install(GLFWwindow* window)
+{
+	InputQueue::window = window;
+	glfwGetCursorPos(window, &cursor.x, &cursor.y);
+	glfwSetWindowUserPointer(window, this);
+
+	glfwSetKeyCallback(window, [](GLFWwindow* window, int key, int, int action, int mods)
+	{
+		InputQueue& input = of(window);
+		// unknown keys come in as GLFW_KEY_UNKNOWN, which is negative
+		if (key >= 0 && key <= GLFW_KEY_LAST)
+			input.keys[key] = action != GLFW_RELEASE;
+		input.push(KEY, key, action, mods, input.cursor);
+	});
+	glfwSetMouseButtonCallback(window, [](GLFWwindow* window, int button, int action, int mods)
+	{
+		InputQueue& input = of(window);
+		if (button >= 0 && button <= GLFW_MOUSE_BUTTON_LAST)
+			input.buttons[button] = action == GLFW_PRESS;
+		input.push(MOUSE_BUTTON, button, action, mods, input.cursor);
+	});
+	glfwSetCursorPosCallback(window, [](GLFWwindow* window, double x, double y)
+	{
+		InputQueue& input = of(window);
+		input.cursor = glm::dvec2(x, y);
+		input.push(CURSOR, 0, 0, 0, input.cursor);
+	});
+	glfwSetScrollCallback(window, [](GLFWwindow* window, double x, double y)
+	{
+		of(window).push(SCROLL, 0, 0, 0, glm::dvec2(x, y));
+	});
+	glfwSetFramebufferSizeCallback(window, [](GLFWwindow* window, int width, int height)
+	{
+		of(window).push(WINDOW, 0, 0, 0, glm::dvec2(width, height));
+	});
+	glfwSetWindowRefreshCallback(window, [](GLFWwindow* window)
+	{
+		of(window).push(WINDOW, 0, 0, 0, glm::dvec2(0.0));
+	});
+	glfwSetWindowFocusCallback(window, [](GLFWwindow* window, int)
+	{
+		of(window).push(WINDOW, 0, 0, 0, glm::dvec2(0.0));
+	});
+	glfwSetWindowIconifyCallback(window, [](GLFWwindow* window, int)
+	{
+		of(window).push(WINDOW, 0, 0, 0, glm::dvec2(0.0));
+	});
+}
+
+// Moves the events queued since the last call to Events
+void InputQueue::BeginFrame()
+{
+	current.clear();
+	current.swap(queued);
+}
+
+// This frame's events in the order they came in
+const std::vector<InputQueue::Event>& InputQueue::Events() const
+{
+	return current;
+}
+
+bool InputQueue::KeyHeld(int key) const
+{
+	return key >= 0 && key <= GLFW_KEY_LAST && keys[key];
+}
+
+bool InputQueue::ButtonHeld(int button) const
+{
+	return button >= 0 && button <= GLFW_MOUSE_BUTTON_LAST && buttons[button];
+}
+
+glm::dvec2 InputQueue::Cursor() const
+{
+	return cursor;
+}
+
+// Hides the cursor and reports unbounded motion while captured
+void InputQueue::Capture(bool captured)
+{
+	if (window == NULL || captured == InputQueue::captured)
+		return;
+	InputQueue::captured = captured;
+	glfwSetInputMode(window, GLFW_CURSOR, captured ? GLFW_CURSOR_DISABLED : GLFW_CURSOR_NORMAL);
+	// switching modes moves the cursor without a callback, so the next delta would jump
+	glfwGetCursorPos(window, &cursor.x, &cursor.y);
+}
+
+void InputQueue::push(Type type, int code, int action, int mods, glm::dvec2 position)
+{
+	queued.push_back(Event{ type, code, action, mods, position });
+	eventsQueued++;
+}
+
+InputQueue& InputQueue::of(GLFWwindow* window)
+{
+	return *(InputQueue*)glfwGetWindowUserPointer(window);
+}
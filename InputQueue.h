@@ -0,0 +1,67 @@
+#ifndef INPUT_QUEUE_CLASS_H
+#define INPUT_QUEUE_CLASS_H
+
+#include<GLFW/glfw3.h>
+#include<glm/glm.hpp>
+#include<vector>
+
+// Collects the window's input through GLFW callbacks instead of polling every key each frame. The
+// callbacks queue events and keep the state of keys, buttons and the cursor; BeginFrame hands the
+// events queued since the last frame to whoever reads them. Callbacks run inside glfwPollEvents and
+// glfwWaitEvents, so everything here belongs to the main thread
+class InputQueue
+{
+public:
+	enum Type
+	{
+		// code is the key, action GLFW_PRESS, GLFW_REPEAT or GLFW_RELEASE
+		KEY,
+		// code is the button, position the cursor when it was pressed or released
+		MOUSE_BUTTON,
+		// position is the cursor in window coordinates, unbounded while captured
+		CURSOR,
+		// position holds the x and y offset
+		SCROLL,
+		// resized, needs repainting, or changed focus or minimized state
+		WINDOW
+	};
+	struct Event
+	{
+		Type type;
+		int code;
+		int action;
+		int mods;
+		glm::dvec2 position;
+	};
+
+	// Stats
+	unsigned long long eventsQueued = 0;
+
+	// Installs the callbacks, the queue becomes the window's user pointer
+	void Install(GLFWwindow* window);
+	// Moves the events queued since the last call to Events, call once per frame after polling
+	void BeginFrame();
+	// This frame's events in the order they came in
+	const std::vector<Event>& Events() const;
+
+	// State after this frame's events
+	bool KeyHeld(int key) const;
+	bool ButtonHeld(int button) const;
+	glm::dvec2 Cursor() const;
+	// Hides the cursor and reports unbounded motion while captured, for drags
+	void Capture(bool captured);
+
+private:
+	GLFWwindow* window = NULL;
+	std::vector<Event> queued;
+	std::vector<Event> current;
+	bool keys[GLFW_KEY_LAST + 1] = {};
+	bool buttons[GLFW_MOUSE_BUTTON_LAST + 1] = {};
+	glm::dvec2 cursor = glm::dvec2(0.0);
+	bool captured = false;
+
+	void push(Type type, int code, int action, int mods, glm::dvec2 position);
+	static InputQueue& of(GLFWwindow* window);
+};
+
+#endif
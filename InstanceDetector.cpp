@@ -0,0 +1,261 @@
+#include"InstanceDetector.h"
+
+#include<glm/gtc/quaternion.hpp>
+#include<algorithm>
+#include<cmath>
+
+namespace
+{
+	// Cyclic Jacobi rotations for a small symmetric matrix, the eigenvectors end up in the columns of v
+	template<int N>
+	void jacobiEigen(double a[N][N], double v[N][N], double d[N])
+	{
+		for (int i = 0; i < N; i++)
+			for (int j = 0; j < N; j++)
+				v[i][j] = (i == j) ? 1.0 : 0.0;
+
+		for (int sweep = 0; sweep < 50; sweep++)
+		{
+			double off = 0.0;
+			for (int p = 0; p < N; p++)
+				for (int q = p + 1; q < N; q++)
+					off += a[p][q] * a[p][q];
+			if (off < 1e-30)
+				break;
+
+			for (int p = 0; p < N; p++)
+				for (int q = p + 1; q < N; q++)
+				{
+					if (std::fabs(a[p][q]) < 1e-300)
+						continue;
+					double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+					double t = (theta >= 0.0 ? 1.0 : -1.0) / (std::fabs(theta) + std::sqrt(theta * theta + 1.0));
+					double c = 1.0 / std::sqrt(t * t + 1.0);
+					double s = t * c;
+					for (int k = 0; k < N; k++)
+					{
+						double akp = a[k][p], akq = a[k][q];
+						a[k][p] = c * akp - s * akq;
+						a[k][q] = s * akp + c * akq;
+					}
+					for (int k = 0; k < N; k++)
+					{
+						double apk = a[p][k], aqk = a[q][k];
+						a[p][k] = c * apk - s * aqk;
+						a[q][k] = s * apk + c * aqk;
+					}
+					for (int k = 0; k < N; k++)
+					{
+						double vkp = v[k][p], vkq = v[k][q];
+						v[k][p] = c * vkp - s * vkq;
+						v[k][q] = s * vkp + c * vkq;
+					}
+				}
+		}
+		for (int i = 0; i < N; i++)
+			d[i] = a[i][i];
+	}
+
+	uint64_t bucketKey(size_t vertexCount, size_t indexCount, int64_t areaBucket)
+	{
+		uint64_t h = 1469598103934665603ull;
+		for (uint64_t x : { (uint64_t)vertexCount, (uint64_t)indexCount, (uint64_t)areaBucket })
+		{
+			h ^= x;
+			h *= 1099511628211ull;
+			h ^= h >> 29;
+		}
+		return h;
+	}
+
+	uint64_t cellKey(const glm::ivec3& c)
+	{
+		const int64_t bias = 1 << 20;
+		return ((uint64_t)(c.x + bias) << 42) | ((uint64_t)(c.y + bias) << 21) | (uint64_t)(c.z + bias);
+	}
+
+	glm::mat4 rigid(const glm::dmat3& rotation, const glm::dvec3& from, const glm::dvec3& to)
+	{
+		// maps "from" onto "to" after rotating about "from"
+		glm::dmat4 m(rotation);
+		m[3] = glm::dvec4(to - rotation * from, 1.0);
+		return glm::mat4(m);
+	}
+}
+
+InstanceDetector::Signature InstanceDetector::describe(const Mesh& part)
+{
+	Signature sig;
+	size_t vertexCount = part.VertexCount();
+
+	sig.vertexCentroid = glm::dvec3(0.0);
+	for (size_t v = 0; v < vertexCount; v++)
+		sig.vertexCentroid += glm::dvec3(part.Position(v));
+	sig.vertexCentroid /= (double)std::max<size_t>(vertexCount, 1);
+
+	sig.radius = 0.0;
+	for (size_t v = 0; v < vertexCount; v++)
+		sig.radius = std::max(sig.radius, glm::length(glm::dvec3(part.Position(v)) - sig.vertexCentroid));
+
+	// surface moments rather than vertex moments so the frame does not depend on how densely
+	// each area was tessellated
+	double area = 0.0;
+	glm::dvec3 first(0.0);
+	glm::dmat3 second(0.0);
+	for (size_t i = 0; i + 2 < part.indices.size(); i += 3)
+	{
+		glm::dvec3 a = glm::dvec3(part.Position(part.indices[i])) - sig.vertexCentroid;
+		glm::dvec3 b = glm::dvec3(part.Position(part.indices[i + 1])) - sig.vertexCentroid;
+		glm::dvec3 c = glm::dvec3(part.Position(part.indices[i + 2])) - sig.vertexCentroid;
+		double A = 0.5 * glm::length(glm::cross(b - a, c - a));
+		glm::dvec3 sum = a + b + c;
+		area += A;
+		first += A * sum / 3.0;
+		second += A / 12.0 * (glm::outerProduct(a, a) + glm::outerProduct(b, b) + glm::outerProduct(c, c) + glm::outerProduct(sum, sum));
+	}
+	sig.area = area;
+	glm::dvec3 mean = area > 0.0 ? first / area : glm::dvec3(0.0);
+	sig.centroid = sig.vertexCentroid + mean;
+	glm::dmat3 covariance = area > 0.0 ? second / area - glm::outerProduct(mean, mean) : glm::dmat3(0.0);
+
+	double a[3][3], v[3][3], d[3];
+	for (int i = 0; i < 3; i++)
+		for (int j = 0; j < 3; j++)
+			a[i][j] = covariance[j][i];
+	jacobiEigen<3>(a, v, d);
+
+	int order[3] = { 0, 1, 2 };
+	std::sort(order, order + 3, [&d](int l, int r) { return d[l] > d[r]; });
+	glm::dvec3 e1(v[0][order[0]], v[1][order[0]], v[2][order[0]]);
+	glm::dvec3 e2(v[0][order[1]], v[1][order[1]], v[2][order[1]]);
+	sig.frame = glm::dmat3(e1, e2, glm::cross(e1, e2));
+	sig.moments = glm::dvec3(d[order[0]], d[order[1]], d[order[2]]);
+
+	// 0.1% steps of log area, neighbours are searched too so values near a step boundary still meet
+	sig.areaBucket = area > 0.0 ? (int64_t)std::llround(std::log(area) * 1000.0) : 0;
+	return sig;
+}
+
+// Exported copies of a part usually keep the vertex order, then the rotation follows directly from the
+// vertex pairs (Horn's closed form quaternion) and symmetric parts like bolts are handled too
+bool InstanceDetector::matchInOrder(const Mesh& part, const Signature& partSig, size_t candidate, glm::mat4& transform)
+{
+	const Mesh& ref = parts[candidate].geometry;
+	const Signature& refSig = signatures[candidate];
+	size_t vertexCount = part.VertexCount();
+	double tol = tolerance * std::max(refSig.radius, 1e-12);
+
+	// a few distances to the centroid rule most mismatches out before the full solve
+	for (size_t v = 0; v < vertexCount; v += std::max<size_t>(1, vertexCount / 8))
+	{
+		double dr = glm::length(glm::dvec3(ref.Position(v)) - refSig.vertexCentroid);
+		double dp = glm::length(glm::dvec3(part.Position(v)) - partSig.vertexCentroid);
+		if (std::fabs(dr - dp) > tol)
+			return false;
+	}
+
+	glm::dmat3 S(0.0);
+	for (size_t v = 0; v < vertexCount; v++)
+		S += glm::outerProduct(glm::dvec3(part.Position(v)) - partSig.vertexCentroid, glm::dvec3(ref.Position(v)) - refSig.vertexCentroid);
+	// S[a][b] is the sum of ref.a * part.b
+	double sxx = S[0][0], sxy = S[0][1], sxz = S[0][2];
+	double syx = S[1][0], syy = S[1][1], syz = S[1][2];
+	double szx = S[2][0], szy = S[2][1], szz = S[2][2];
+	double n[4][4] = {
+		{ sxx + syy + szz, syz - szy, szx - sxz, sxy - syx },
+		{ syz - szy, sxx - syy - szz, sxy + syx, szx + sxz },
+		{ szx - sxz, sxy + syx, -sxx + syy - szz, syz + szy },
+		{ sxy - syx, szx + sxz, syz + szy, -sxx - syy + szz } };
+	double ev[4][4], d[4];
+	jacobiEigen<4>(n, ev, d);
+	int best = (int)(std::max_element(d, d + 4) - d);
+	glm::dquat q(ev[0][best], ev[1][best], ev[2][best], ev[3][best]);
+	glm::dmat3 R = glm::mat3_cast(glm::normalize(q));
+
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		glm::dvec3 mapped = R * (glm::dvec3(ref.Position(v)) - refSig.vertexCentroid) + partSig.vertexCentroid;
+		if (glm::length(mapped - glm::dvec3(part.Position(v))) > tol)
+			return false;
+	}
+	transform = rigid(R, refSig.vertexCentroid, partSig.vertexCentroid);
+	return true;
+}
+
+// Reordered copies are aligned through their principal axes, the axes are only defined up to sign so
+// the four proper rotations among the sign flips are tried. Parts with two equal principal moments
+// have no stable frame and fall through to being stored as their own geometry
+bool InstanceDetector::matchByFrame(const Mesh& part, const Signature& partSig, size_t candidate, glm::mat4& transform)
+{
+	const Mesh& ref = parts[candidate].geometry;
+	Signature& refSig = signatures[candidate];
+	double tol = tolerance * std::max(refSig.radius, 1e-12);
+
+	if (glm::length(partSig.moments - refSig.moments) > 1e-3 * glm::length(refSig.moments))
+		return false;
+
+	double cell = 2.0 * tol;
+	auto cellOf = [&](const glm::dvec3& p) { return glm::ivec3(glm::floor((p - refSig.centroid) / cell)); };
+	if (refSig.cells.empty())
+	{
+		for (size_t v = 0; v < ref.VertexCount(); v++)
+			refSig.cells.emplace_back(cellKey(cellOf(glm::dvec3(ref.Position(v)))), (GLuint)v);
+		std::sort(refSig.cells.begin(), refSig.cells.end());
+	}
+
+	const glm::dvec3 flips[4] = { { 1, 1, 1 }, { -1, -1, 1 }, { -1, 1, -1 }, { 1, -1, -1 } };
+	for (const glm::dvec3& flip : flips)
+	{
+		glm::dmat3 R = partSig.frame * glm::dmat3(glm::dvec3(flip.x, 0, 0), glm::dvec3(0, flip.y, 0), glm::dvec3(0, 0, flip.z)) * glm::transpose(refSig.frame);
+
+		bool matched = true;
+		for (size_t v = 0; v < part.VertexCount() && matched; v++)
+		{
+			// back into the reference part and look for a vertex within tolerance in the neighbouring cells
+			glm::dvec3 p = glm::transpose(R) * (glm::dvec3(part.Position(v)) - partSig.centroid) + refSig.centroid;
+			glm::ivec3 c = cellOf(p);
+			bool found = false;
+			for (int z = -1; z <= 1 && !found; z++)
+				for (int y = -1; y <= 1 && !found; y++)
+					for (int x = -1; x <= 1 && !found; x++)
+					{
+						uint64_t key = cellKey(c + glm::ivec3(x, y, z));
+						auto it = std::lower_bound(refSig.cells.begin(), refSig.cells.end(), std::make_pair(key, (GLuint)0));
+						for (; it != refSig.cells.end() && it->first == key && !found; ++it)
+							found = glm::length(glm::dvec3(ref.Position(it->second)) - p) <= tol;
+					}
+			matched = found;
+		}
+		if (matched)
+		{
+			transform = rigid(R, refSig.centroid, partSig.centroid);
+			return true;
+		}
+	}
+	return false;
+}
+
+// Adds a part, either as a new geometry or as another transform of a matching one
+void InstanceDetector::Add(const Mesh& part)
+{
+	partsAdded++;
+	Signature sig = describe(part);
+
+	for (int64_t bucket = sig.areaBucket - 1; bucket <= sig.areaBucket + 1; bucket++)
+	{
+		auto range = buckets.equal_range(bucketKey(part.VertexCount(), part.indices.size(), bucket));
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			glm::mat4 transform;
+			if (matchInOrder(part, sig, it->second, transform) || matchByFrame(part, sig, it->second, transform))
+			{
+				parts[it->second].transforms.push_back(transform);
+				return;
+			}
+		}
+	}
+
+	buckets.emplace(bucketKey(part.VertexCount(), part.indices.size(), sig.areaBucket), parts.size());
+	parts.push_back({ part, { glm::mat4(1.0f) } });
+	signatures.push_back(sig);
+}
@@ -0,0 +1,59 @@
+#ifndef INSTANCE_DETECTOR_CLASS_H
+#define INSTANCE_DETECTOR_CLASS_H
+
+#include<glm/glm.hpp>
+#include<cstdint>
+#include<unordered_map>
+#include<utility>
+#include<vector>
+
+#include"Mesh.h"
+
+// One geometry that is stored once and drawn at every transform
+struct InstancedPart
+{
+	Mesh geometry;
+	std::vector<glm::mat4> transforms;
+};
+
+// Finds parts that are the same geometry up to a rigid transform so each is stored and uploaded once.
+// Parts are bucketed by a hash of values that do not change under rotation or translation, candidates
+// from the same bucket are then aligned (vertex order first, PCA frame second) and verified vertex by vertex
+class InstanceDetector
+{
+public:
+	std::vector<InstancedPart> parts;
+	// Number of parts that went through Add
+	size_t partsAdded = 0;
+	// How far a vertex may be from its match, as a fraction of the part radius
+	float tolerance = 1e-4f;
+
+	// Adds a part, either as a new geometry or as another transform of a matching one
+	void Add(const Mesh& part);
+
+private:
+	// Rigid transform invariant description of a part, kept for every unique geometry
+	struct Signature
+	{
+		// Centroid of the vertices, used when vertex order matches
+		glm::dvec3 vertexCentroid;
+		// Area weighted centroid and principal axes of the surface, used when it does not
+		glm::dvec3 centroid;
+		glm::dmat3 frame;
+		glm::dvec3 moments;
+		double area;
+		double radius;
+		int64_t areaBucket;
+		// Lazily built lookup from a quantized position to the vertices in that cell
+		std::vector<std::pair<uint64_t, GLuint>> cells;
+	};
+
+	std::vector<Signature> signatures;
+	std::unordered_multimap<uint64_t, size_t> buckets;
+
+	Signature describe(const Mesh& part);
+	bool matchInOrder(const Mesh& part, const Signature& partSig, size_t candidate, glm::mat4& transform);
+	bool matchByFrame(const Mesh& part, const Signature& partSig, size_t candidate, glm::mat4& transform);
+};
+
+#endif
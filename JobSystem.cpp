@@ -0,0 +1,343 @@
+#include"JobSystem.h"
+
+#include<algorithm>
+
+struct JobSystem::Job
+{
+	std::function<void()> work;
+	Counter* counter;
+};
+
+namespace
+{
+	// which system's deque the current thread owns, and its index there
+	thread_local const JobSystem* currentSystem = NULL;
+	thread_local int currentIndex = -1;
+
+	uint32_t xorshift(uint32_t& state)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+}
+
+JobSystem::Deque::Deque()
+	: buffer(new std::atomic<Job*>[CAPACITY])
+{
+}
+
+// Owner only, false when the deque is full
+bool JobSystem::Deque::Push(Job* job)
+{
+	int64_t b = bottom.load(std::memory_order_relaxed);
+	int64_t t = top.load(std::memory_order_acquire);
+	if (b - t >= CAPACITY)
+		return false;
+	buffer[b & (CAPACITY - 1)].store(job, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	bottom.store(b + 1, std::memory_order_relaxed);
+	return true;
+}
+
+// Owner only, newest job first
+JobSystem::Job* JobSystem::Deque::Pop()
+{
+	int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+	bottom.store(b, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t t = top.load(std::memory_order_relaxed);
+	if (t > b)
+	{
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return NULL;
+	}
+	Job* job = buffer[b & (CAPACITY - 1)].load(std::memory_order_relaxed);
+	if (t == b)
+	{
+		// the last job, a thief may be taking it at the same time
+		if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			job = NULL;
+		bottom.store(b + 1, std::memory_order_relaxed);
+	}
+	return job;
+}
+
+// Any thread, oldest job first
+JobSystem::Job* JobSystem::Deque::Steal()
+{
+	int64_t t = top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t b = bottom.load(std::memory_order_acquire);
+	if (t >= b)
+		return NULL;
+	Job* job = buffer[t & (CAPACITY - 1)].load(std::memory_order_relaxed);
+	if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		return NULL;
+	return job;
+}
+
+// Constructor that starts the workers, 0 starts one per core besides the calling thread
+JobSystem::JobSystem(unsigned workerCount)
+{
+	if (workerCount == 0)
+	{
+		unsigned cores = std::thread::hardware_concurrency();
+		workerCount = cores > 1 ? cores - 1 : 0;
+	}
+	// deque 0 belongs to the creating thread
+	for (unsigned i = 0; i <= workerCount; i++)
+		deques.emplace_back(new Deque());
+	// a system made for a while, like a benchmark's, hands the thread back to the one before it
+	previousSystem = currentSystem;
+	previousIndex = currentIndex;
+	currentSystem = this;
+	currentIndex = 0;
+	for (unsigned i = 1; i <= workerCount; i++)
+		workers.emplace_back(&JobSystem::workerLoop, this, (int)i);
+}
+
+// Finishes the queued jobs and stops the workers
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> guard(sleepLock);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::thread& worker : workers)
+		worker.join();
+	// whatever is left runs here, nobody else is around to take it
+	uint32_t seed = 1;
+	while (Job* job = find(0, seed))
+		execute(job);
+	if (currentSystem == this)
+	{
+		currentSystem = previousSystem;
+		currentIndex = previousIndex;
+	}
+}
+
+// The system every subsystem shares
+JobSystem& JobSystem::Shared()
+{
+	static JobSystem shared;
+	return shared;
+}
+
+// Threads that run jobs besides the one that created the system
+unsigned JobSystem::WorkerCount() const
+{
+	return (unsigned)workers.size();
+}
+
+// Queues work, counter counts it until it has run and it starts only once after is zero
+void JobSystem::Run(std::function<void()> work, Counter* counter, Counter* after)
+{
+	Job* job = new Job{ std::move(work), counter };
+	if (counter != NULL)
+		counter->pending++;
+	if (after != NULL)
+	{
+		// the last finishing job of after takes the same lock before it schedules the dependents
+		std::lock_guard<std::mutex> guard(after->lock);
+		if (after->pending > 0)
+		{
+			after->dependents.push_back(job);
+			return;
+		}
+	}
+	schedule(job);
+}
+
+// Runs other jobs until counter is zero
+void JobSystem::Wait(Counter& counter)
+{
+	int index = threadIndex();
+	uint32_t seed = (uint32_t)(uintptr_t)&counter | 1;
+	int idle = 0;
+	while (counter.pending.load(std::memory_order_acquire) > 0)
+	{
+		if (Job* job = find(index, seed))
+		{
+			execute(job);
+			idle = 0;
+		}
+		// what is left runs on other threads, back off instead of spinning on the deques
+		else if (++idle > 64)
+			std::this_thread::yield();
+	}
+	// the job that brought pending to zero may still hold the lock, counters often live on the stack of the waiter
+	std::lock_guard<std::mutex> guard(counter.lock);
+}
+
+// Calls body(first, last) over ranges covering [0, count), large ranges first
+void JobSystem::ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body, unsigned maxThreads)
+{
+	if (count == 0)
+		return;
+	grain = std::max<size_t>(1, grain);
+	size_t helpers = WorkerCount();
+	if (maxThreads > 0)
+		helpers = std::min<size_t>(helpers, maxThreads - 1);
+	helpers = std::min(helpers, (count + grain - 1) / grain - 1);
+	if (helpers == 0)
+	{
+		body(0, count);
+		return;
+	}
+
+	// guided chunks: each take is a share of what is left, never below grain
+	std::atomic<size_t> next(0);
+	size_t threads = helpers + 1;
+	auto take = [&]()
+	{
+		while (true)
+		{
+			size_t done = std::min(next.load(std::memory_order_relaxed), count);
+			size_t chunk = std::max(grain, (count - done) / (threads * 2));
+			size_t first = next.fetch_add(chunk);
+			if (first >= count)
+				return;
+			body(first, std::min(first + chunk, count));
+		}
+	};
+	Counter counter;
+	for (size_t i = 0; i < helpers; i++)
+		Run(take, &counter);
+	take();
+	Wait(counter);
+}
+
+// Calls body(index) once for every index in [0, count) in parallel
+void JobSystem::Parallel(unsigned count, const std::function<void(unsigned)>& body)
+{
+	if (count == 0)
+		return;
+	Counter counter;
+	for (unsigned i = 1; i < count; i++)
+		Run([&body, i]() { body(i); }, &counter);
+	body(0);
+	Wait(counter);
+}
+
+// Pushes a job whose dependency is done
+void JobSystem::schedule(Job* job)
+{
+	int index = threadIndex();
+	queued++;
+	if (index >= 0)
+	{
+		if (!deques[index]->Push(job))
+		{
+			// full, running it here keeps the deque bounded and the caller busy
+			execute(job);
+			return;
+		}
+	}
+	else
+	{
+		std::lock_guard<std::mutex> guard(injectedLock);
+		injected.push_back(job);
+		injectedCount++;
+	}
+	// a worker counts itself as sleeping before it looks at queued, so one that missed this job is
+	// counted by now. Taking the lock orders the notify after its look, as in FramePipeline::Publish
+	if (sleeping.load() > 0)
+	{
+		{
+			std::lock_guard<std::mutex> guard(sleepLock);
+		}
+		wake.notify_one();
+	}
+}
+
+// A job from this thread's deque, the injected queue or another deque
+JobSystem::Job* JobSystem::find(int index, uint32_t& seed)
+{
+	if (index >= 0)
+		if (Job* job = deques[index]->Pop())
+			return job;
+	if (injectedCount.load(std::memory_order_relaxed) > 0)
+	{
+		std::lock_guard<std::mutex> guard(injectedLock);
+		if (!injected.empty())
+		{
+			Job* job = injected.front();
+			injected.pop_front();
+			injectedCount--;
+			return job;
+		}
+	}
+	// one pass over the other deques from a random start
+	size_t count = deques.size();
+	size_t start = xorshift(seed) % count;
+	for (size_t i = 0; i < count; i++)
+	{
+		size_t victim = (start + i) % count;
+		if ((int)victim == index)
+			continue;
+		if (Job* job = deques[victim]->Steal())
+		{
+			steals++;
+			return job;
+		}
+	}
+	return NULL;
+}
+
+void JobSystem::execute(Job* job)
+{
+	queued--;
+	job->work();
+	Counter* counter = job->counter;
+	delete job;
+	jobsRun++;
+	if (counter != NULL)
+		finish(counter);
+}
+
+void JobSystem::finish(Counter* counter)
+{
+	std::vector<Job*> ready;
+	{
+		// taken before the decrement reaches zero, so Run never parks a dependent after the release
+		std::lock_guard<std::mutex> guard(counter->lock);
+		if (--counter->pending > 0)
+			return;
+		ready.swap(counter->dependents);
+	}
+	for (Job* job : ready)
+		schedule(job);
+}
+
+void JobSystem::workerLoop(int index)
+{
+	currentSystem = this;
+	currentIndex = index;
+	uint32_t seed = 2463534242u * (uint32_t)index | 1;
+	while (true)
+	{
+		if (Job* job = find(index, seed))
+		{
+			execute(job);
+			continue;
+		}
+		std::unique_lock<std::mutex> guard(sleepLock);
+		if (stopping)
+			return;
+		// no timeout, an idle viewer should not wake every core over and over
+		sleeping++;
+		wake.wait(guard, [this] { return stopping || queued.load() > 0; });
+		sleeping--;
+		if (stopping && queued.load() <= 0)
+			return;
+	}
+}
+
+// Deque of the calling thread, -1 when it has none
+int JobSystem::threadIndex() const
+{
+	return currentSystem == this ? currentIndex : -1;
+}
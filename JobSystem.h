@@ -0,0 +1,111 @@
+#ifndef JOB_SYSTEM_CLASS_H
+#define JOB_SYSTEM_CLASS_H
+
+#include<atomic>
+#include<condition_variable>
+#include<cstdint>
+#include<deque>
+#include<functional>
+#include<memory>
+#include<mutex>
+#include<thread>
+#include<vector>
+
+// Work stealing scheduler shared by everything that runs in parallel. Every worker owns a Chase-Lev
+// deque: it pushes and pops jobs at the bottom without locking while idle workers steal from the top
+// of the others. The thread that creates the system owns a deque too and helps out whenever it waits,
+// other threads hand their jobs in through a locked queue. Waiting never blocks a thread that could
+// be running jobs, so parallel loops may nest
+class JobSystem
+{
+public:
+	struct Job;
+
+	// Counts unfinished jobs. Wait returns once it is zero, and jobs started with it as their
+	// dependency run only then. Reusable once it is back at zero
+	class Counter
+	{
+	public:
+		std::atomic<int> pending{ 0 };
+
+	private:
+		friend class JobSystem;
+		std::mutex lock;
+		// jobs waiting for pending to reach zero
+		std::vector<Job*> dependents;
+	};
+
+	// Stats
+	std::atomic<unsigned long long> jobsRun{ 0 };
+	std::atomic<unsigned long long> steals{ 0 };
+
+	// Constructor that starts the workers, 0 starts one per core besides the calling thread
+	JobSystem(unsigned workerCount = 0);
+	// Finishes the queued jobs and stops the workers
+	~JobSystem();
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	// The system every subsystem shares, created by the first call which should come from the main thread
+	static JobSystem& Shared();
+
+	// Threads that run jobs besides the one that created the system
+	unsigned WorkerCount() const;
+	// Queues work, counter (when given) counts it until it has run and it starts only once after is zero
+	void Run(std::function<void()> work, Counter* counter = NULL, Counter* after = NULL);
+	// Runs other jobs until counter is zero
+	void Wait(Counter& counter);
+	// Calls body(first, last) over ranges covering [0, count). Ranges start large and shrink towards
+	// grain as the work runs out, so uneven items still finish together. At most maxThreads threads
+	// take part, the calling one included, 0 for all of them
+	void ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body, unsigned maxThreads = 0);
+	// Calls body(index) once for every index in [0, count) in parallel, the calling thread takes index 0
+	void Parallel(unsigned count, const std::function<void(unsigned)>& body);
+
+private:
+	// Chase-Lev deque (Le, Pop, Cohen and Zappa Nardelli 2013) of fixed size, a full one runs the job inline
+	class Deque
+	{
+	public:
+		Deque();
+		// Owner only
+		bool Push(Job* job);
+		Job* Pop();
+		// Any thread
+		Job* Steal();
+
+	private:
+		static const int64_t CAPACITY = 4096;
+		std::atomic<int64_t> top{ 0 };
+		std::atomic<int64_t> bottom{ 0 };
+		std::unique_ptr<std::atomic<Job*>[]> buffer;
+	};
+
+	std::vector<std::unique_ptr<Deque>> deques;
+	std::vector<std::thread> workers;
+	// jobs from threads without a deque
+	std::mutex injectedLock;
+	std::deque<Job*> injected;
+	std::atomic<size_t> injectedCount{ 0 };
+	// idle workers sleep until something is queued
+	std::mutex sleepLock;
+	std::condition_variable wake;
+	std::atomic<int> queued{ 0 };
+	std::atomic<int> sleeping{ 0 };
+	std::atomic<bool> stopping{ false };
+	// what the creating thread owned before, given back on destruction
+	const JobSystem* previousSystem = NULL;
+	int previousIndex = -1;
+
+	// Pushes a job whose dependency is done
+	void schedule(Job* job);
+	// A job from this thread's deque, the injected queue or another deque, NULL when there is none
+	Job* find(int index, uint32_t& seed);
+	void execute(Job* job);
+	void finish(Counter* counter);
+	void workerLoop(int index);
+	// Deque of the calling thread, -1 when it has none
+	int threadIndex() const;
+};
+
+#endif
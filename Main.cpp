@@ -1,4 +1,14 @@
+#include<algorithm>
+#include<atomic>
+#include<chrono>
+#include<cmath>
+#include<cstdlib>
+#include<cstring>
 #include<iostream>
+#include<memory>
+#include<random>
+#include<string>
+#include<thread>
 #include<glad/glad.h>
 #include<GLFW/glfw3.h>
 #include<stb/stb_image.h>	
@@ -13,6 +23,31 @@
 #include"EBO.h"
 #include"Texture.h"
 #include"Camera.h"
+#include"SectionPlane.h"
+#include"Mesh.h"
+#include"InstanceDetector.h"
+#include"AmbientOcclusion.h"
+#include"SoftwareRasterizer.h"
+#include"ThumbnailRenderer.h"
+#include"GLState.h"
+#include"FrameData.h"
+#include"GLExtensions.h"
+#include"StreamBuffer.h"
+#include"GeometryPool.h"
+#include"GLResources.h"
+#include"RenderQueue.h"
+#include"ProgramCache.h"
+#include"ShaderLibrary.h"
+#include"TextureCompressor.h"
+#include"TextureLoader.h"
+#include"TextureAtlas.h"
+#include"ResidencyManager.h"
+#include"JobSystem.h"
+#include"FramePipeline.h"
+#include"FramePacer.h"
+#include"RedrawTracker.h"
+#include"InputQueue.h"
+#include"BVH.h"
 
 const unsigned int width = 800;
 const unsigned int height = 800;
@@ -38,38 +73,283 @@ GLuint indices[] =
 	3, 0, 4
 };
 
-int main()
+// Moves and scales every instance so the whole assembly fits a unit box around the origin,
+// STL files come in whatever units the CAD tool used and the camera expects the pyramid's scale
+void fitToView(std::vector<InstancedPart>& parts)
 {
-	glfwInit();
+	glm::vec3 lo(1e30f), hi(-1e30f);
+	for (InstancedPart& part : parts)
+		for (glm::mat4& transform : part.transforms)
+			for (size_t v = 0; v < part.geometry.VertexCount(); v++)
+			{
+				glm::vec3 p = glm::vec3(transform * glm::vec4(part.geometry.Position(v), 1.0f));
+				lo = glm::min(lo, p);
+				hi = glm::max(hi, p);
+			}
+	float extent = glm::max(hi.x - lo.x, glm::max(hi.y - lo.y, hi.z - lo.z));
+	if (extent <= 0.0f)
+		return;
+	glm::mat4 fit = glm::scale(glm::mat4(1.0f), glm::vec3(1.0f / extent)) * glm::translate(glm::mat4(1.0f), -(lo + hi) * 0.5f);
+	for (InstancedPart& part : parts)
+		for (glm::mat4& transform : part.transforms)
+			transform = fit * transform;
+}
 
-	// tell GLFW the version and profile we are using of OPENGL
-	// we use CORE because that has the modern functions
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+// Reads STL files into the detector, every shell is a part and parts that are the same geometry
+// are stored once, then fits the assembly to the view
+void loadAssembly(InstanceDetector& detector, int fileCount, char** files)
+{
+	for (int i = 0; i < fileCount; i++)
+	{
+		Mesh file(files[i], glm::vec3(0.80f, 0.80f, 0.82f));
+		for (Mesh& shell : file.Shells())
+			detector.Add(shell);
+	}
+	fitToView(detector.parts);
+}
 
-	// create a GLFW window object to put our stuffs on
-	GLFWwindow* window = glfwCreateWindow(width, height, "OpenGL", NULL, NULL);
+// Renders the startup view without a window or GL context and writes it as a PNG
+int renderSoftware(const char* output, InstanceDetector& detector)
+{
+	Camera camera(width, height, glm::vec3(0.0f, 0.0f, 2.0f));
+	glm::mat4 camMatrix = camera.ViewProjection(45.0f, 0.1f, 100.0f);
 
-	// error check to cleanly remove GLFW in case window fails to create
-	if (window == NULL)
+	SoftwareRasterizer rasterizer(width, height);
+	rasterizer.Clear(glm::vec4(0.07f, 0.13f, 0.17f, 1.0f));
+	double milliseconds = 0.0;
+	size_t triangles = 0;
+	if (detector.parts.empty())
 	{
-		std::cout << "Failed to create GLFW window" << std::endl;
-		glfwTerminate();
+		Image penguin("penguin.png");
+		Mesh pyramid(vertices, sizeof(vertices), indices, sizeof(indices));
+		rasterizer.Draw(pyramid, std::vector<glm::mat4>(1, glm::mat4(1.0f)), std::vector<GLubyte>(), camMatrix, &penguin, false);
+		milliseconds += rasterizer.milliseconds;
+		triangles += rasterizer.trianglesBinned;
+	}
+	else
+	{
+		AmbientOcclusion ambientOcclusion;
+		for (InstancedPart& part : detector.parts)
+		{
+			rasterizer.Draw(part.geometry, part.transforms, ambientOcclusion.Bake(part.geometry), camMatrix, NULL, true);
+			milliseconds += rasterizer.milliseconds;
+			triangles += rasterizer.trianglesBinned;
+		}
+	}
+	std::cout << "Rasterized " << triangles << " triangles in " << milliseconds << " ms on " << rasterizer.threadCount << " threads" << std::endl;
+
+	if (!rasterizer.color.WritePNG(output))
+	{
+		std::cout << "Failed to write " << output << std::endl;
 		return -1;
 	}
+	return 0;
+}
 
-	// introduce window into the current context (make it visible)
+// Runs the residency manager against a simulated assembly, a quarter of which fits the budget, with a
+// view that drifts along it and sometimes jumps. Evict and restore only do the bookkeeping a GPU
+// would, so this needs no window. Fails when the simulated GPU disagrees with the manager, loading
+// overshoots the budget by more than one resource, or a frame ends over the budget
+int residencyStress(int resourceCount, int frameCount)
+{
+	std::mt19937 random(12345);
+	ResidencyManager residency;
+	std::vector<size_t> sizes(resourceCount);
+	std::vector<bool> onGPU(resourceCount, true);
+	std::vector<ResidencyManager::Handle> handles(resourceCount);
+	// odd resources restore over a frame like textures, even ones right away like meshes
+	std::vector<int> uploading;
+	std::vector<int> uploaded;
+	size_t gpuBytes = 0;
+	size_t totalBytes = 0;
+	bool consistent = true;
+	for (int i = 0; i < resourceCount; i++)
+	{
+		// 16 KB to 16 MB, mostly small like the parts of a plant
+		sizes[i] = ((size_t)16384 << (random() % 11)) + random() % 16384;
+		totalBytes += sizes[i];
+	}
+	residency.budget = totalBytes / 4;
+	residency.bytesPerFrame = residency.budget / 16;
+	// loading goes through the budget too, each resource is on the GPU once it is tracked
+	for (int i = 0; i < resourceCount; i++)
+	{
+		gpuBytes += sizes[i];
+		bool async = i % 2 == 1;
+		handles[i] = residency.Track("resource " + std::to_string(i), sizes[i],
+			[&, i]()
+			{
+				consistent = consistent && onGPU[i];
+				onGPU[i] = false;
+				gpuBytes -= sizes[i];
+			},
+			[&, i, async]()
+			{
+				consistent = consistent && !onGPU[i];
+				onGPU[i] = true;
+				gpuBytes += sizes[i];
+				if (async)
+					uploading.push_back(i);
+				return !async;
+			});
+	}
+	size_t largest = *std::max_element(sizes.begin(), sizes.end());
+	bool loadedInBudget = residency.peakResidentBytes <= residency.budget + largest;
+
+	unsigned long long drawn = 0, skipped = 0;
+	size_t worstOver = 0;
+	double updateMilliseconds = 0.0;
+	int visible = std::max(1, resourceCount / 10);
+	int center = 0;
+	for (int frame = 0; frame < frameCount; frame++)
+	{
+		// uploads started last frame are done now
+		for (int i : uploaded)
+			residency.Restored(handles[i]);
+		uploaded.swap(uploading);
+		uploading.clear();
+
+		if (random() % 100 == 0)
+			center = random() % resourceCount;
+		else
+			center = (center + 1 + random() % 3) % resourceCount;
+		for (int k = 0; k < visible; k++)
+		{
+			int i = (center + k) % resourceCount;
+			if (residency.Use(handles[i]))
+			{
+				consistent = consistent && onGPU[i];
+				drawn++;
+			}
+			else
+				skipped++;
+		}
+
+		auto start = std::chrono::high_resolution_clock::now();
+		residency.Update();
+		updateMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		consistent = consistent && gpuBytes == residency.residentBytes;
+		if (gpuBytes > residency.budget)
+			worstOver = std::max(worstOver, gpuBytes - residency.budget);
+	}
+
+	std::cout << resourceCount << " resources, " << totalBytes / 1048576.0 << " MB, " << frameCount << " frames: " << drawn << " draws, " << skipped << " skipped while restoring, " << updateMilliseconds / frameCount << " ms per Update" << std::endl;
+	residency.Print();
+	if (!consistent || worstOver > 0 || !loadedInBudget)
+	{
+		std::cout << "FAILED:" << (consistent ? "" : " GPU and manager disagree") << (worstOver > 0 ? " ended frames over the budget" : "") << (loadedInBudget ? "" : " loading went past the budget") << std::endl;
+		return 1;
+	}
+	std::cout << "ok" << std::endl;
+	return 0;
+}
+
+// Sphere around a mesh in its own coordinates, center in xyz and radius in w
+glm::vec4 boundingSphere(const Mesh& mesh)
+{
+	glm::vec3 lo(1e30f), hi(-1e30f);
+	for (size_t v = 0; v < mesh.VertexCount(); v++)
+	{
+		lo = glm::min(lo, mesh.Position(v));
+		hi = glm::max(hi, mesh.Position(v));
+	}
+	glm::vec3 center = (lo + hi) * 0.5f;
+	float radius = 0.0f;
+	for (size_t v = 0; v < mesh.VertexCount(); v++)
+		radius = glm::max(radius, glm::length(mesh.Position(v) - center));
+	return glm::vec4(center, radius);
+}
+
+// Fills the packet with the instances whose bounding sphere reaches into the view frustum, and with
+// the distance the render queue sorts each part by
+void cullParts(InstanceDetector& detector, const std::vector<glm::vec4>& bounds, FramePacket& packet)
+{
+	// the frustum planes come straight from the rows of projection * view
+	const glm::mat4& matrix = packet.frameData.viewProjection;
+	glm::vec4 w(matrix[0][3], matrix[1][3], matrix[2][3], matrix[3][3]);
+	glm::vec4 planes[6];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		glm::vec4 row(matrix[0][axis], matrix[1][axis], matrix[2][axis], matrix[3][axis]);
+		planes[axis * 2] = w + row;
+		planes[axis * 2 + 1] = w - row;
+	}
+	for (glm::vec4& plane : planes)
+		plane /= glm::length(glm::vec3(plane));
+
+	glm::vec3 eye(packet.frameData.cameraPosition);
+	packet.partTransforms.resize(detector.parts.size());
+	packet.partDepths.resize(detector.parts.size());
+	packet.instancesVisible = 0;
+	for (size_t part = 0; part < detector.parts.size(); part++)
+	{
+		std::vector<glm::mat4>& visible = packet.partTransforms[part];
+		visible.clear();
+		for (const glm::mat4& transform : detector.parts[part].transforms)
+		{
+			glm::vec3 center = glm::vec3(transform * glm::vec4(glm::vec3(bounds[part]), 1.0f));
+			float scale = glm::max(glm::length(glm::vec3(transform[0])), glm::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+			float radius = bounds[part].w * scale;
+			bool inside = true;
+			for (const glm::vec4& plane : planes)
+				if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+				{
+					inside = false;
+					break;
+				}
+			if (inside)
+				visible.push_back(transform);
+		}
+		packet.instancesVisible += visible.size();
+		packet.partDepths[part] = visible.empty() ? 0.0f : glm::length(glm::vec3(visible[0][3]) - eye);
+	}
+}
+
+// Owns the GL context on its own thread: uploads the scene, then draws every frame packet the main
+// thread publishes until stop is set. Everything that touches GL lives here, the main thread only
+// handles the window
+void render(GLFWwindow* window, FramePipeline& pipeline, std::atomic<bool>& stop, InstanceDetector& detector, std::vector<std::vector<GLubyte>>& partOcclusion, ResidencyManager& residency, FramePacer::SwapMode swapMode, RedrawTracker& redraw)
+{
 	glfwMakeContextCurrent(window);
+	// the swap interval belongs to the context, so it is set here
+	glfwSwapInterval(FramePacer::SwapInterval(swapMode));
 
-	// load GLAD to configure OpenGL
-	gladLoadGL();
+	// load in the shaders, from the binary cache when an earlier launch saved one. The general
+	// program is built now, variants for each kind of draw compile in the background on first use
+	double shaderStart = glfwGetTime();
+	ShaderLibrary shaders("default.vert", "default.frag");
+	Shader& shaderProgram = shaders.fallback;
+	std::cout << "Shaders ready in " << (glfwGetTime() - shaderStart) * 1000.0 << " ms" << (shaderProgram.fromCache ? " from the binary cache" : ", compiled") << std::endl;
 
-	// specify viewport of OpenGL in window
-	glViewport(0, 0, width, height);
+	// draws without an instance buffer read the current value of the instance matrix attribute,
+	// make that the identity
+	for (GLuint column = 0; column < 4; column++)
+		glVertexAttrib4f(3 + column, column == 0, column == 1, column == 2, column == 3);
+	// and unbaked meshes are fully open
+	glVertexAttrib1f(7, 1.0f);
+	// and read the first atlas slot
+	glVertexAttrib1f(8, 0.0f);
 
-	// load in the shaders
-	Shader shaderProgram("default.vert", "default.frag");
+	// every geometry goes into the shared pool instead of buffers of its own
+	GeometryPool geometryPool;
+	std::vector<GeometryHandle> partGeometry;
+	for (size_t part = 0; part < detector.parts.size(); part++)
+		partGeometry.push_back(geometryPool.Add(detector.parts[part].geometry, partOcclusion[part]));
+	// the detector keeps every mesh and partOcclusion its bake, so an evicted part comes back from those.
+	// The pool only adds pages when the live meshes outgrow it, so the budget bounds the pages too
+	std::vector<ResidencyManager::Handle> partResidency;
+	for (size_t part = 0; part < partGeometry.size(); part++)
+	{
+		const Mesh& geometry = detector.parts[part].geometry;
+		size_t bytes = geometry.vertices.size() * sizeof(GLfloat) + geometry.indices.size() * sizeof(GLuint) + partOcclusion[part].size();
+		partResidency.push_back(residency.Track("part " + std::to_string(part), bytes,
+			[&, part]() { geometryPool.Remove(partGeometry[part]); },
+			[&, part]()
+			{
+				partGeometry[part] = geometryPool.Add(detector.parts[part].geometry, partOcclusion[part]);
+				return true;
+			}));
+	}
 
 	// create the Vertex Array Object and bind it
 	VAO VAO1;
@@ -92,67 +372,677 @@ int main()
 	VBO1.Unbind();
 	EBO1.Unbind();
 
-	// texture parammeters
-	int widthImg, heightImg, numColCh;
+	// images decode on worker threads and upload over the next frames, a checkerboard shows until then
+	TextureLoader textureLoader;
+	textureLoader.residency = &residency;
+	textureLoader.redraw = &redraw;
+	std::shared_ptr<Texture> penguinTex = textureLoader.Load("penguin.png");
+	penguinTex->texUnit(shaderProgram, "tex0", 0);
 
-	// stbi and opengl are reversed vertically so we must flip to right side up
-	stbi_set_flip_vertically_on_load(true);
+	// the caps use the same vertex layout as the mesh but change whenever the plane moves, they are
+	// streamed every frame through ring buffers and the VAO is pointed at wherever they landed
+	VAO capVAO;
+	StreamBuffer capVertexStream(GL_ARRAY_BUFFER, 1 << 20);
+	StreamBuffer capIndexStream(GL_ELEMENT_ARRAY_BUFFER, 1 << 19);
+	// the cut the streams were last sized for
+	std::shared_ptr<const std::vector<GLfloat>> reservedCaps;
+
+	// every draw is queued with its material and the queue sorts them so shared state is set once
+	RenderQueue renderQueue;
+	RenderMaterial pyramidMaterial;
+	pyramidMaterial.id = 0;
+	pyramidMaterial.texture = penguinTex.get();
+	RenderMaterial partMaterial;
+	partMaterial.id = 1;
+	partMaterial.flatColor = true;
+	// the caps sit exactly on the plane so they are drawn without clipping
+	RenderMaterial capMaterial;
+	capMaterial.id = 2;
+	capMaterial.flatColor = true;
+
+	// T color codes the parts. Every part gets a solid swatch in one atlas and passes only its slot,
+	// so the parts still share one texture bind and one multi draw
+	TextureAtlas partAtlas(TextureFile::RGBA8);
+	std::vector<float> partSlots;
+	for (size_t part = 0; part < partGeometry.size(); part++)
+	{
+		// hues a golden ratio apart, so parts next in the list never look alike
+		float hue = std::fmod(part * 0.618034f, 1.0f);
+		glm::vec3 rgb = glm::clamp(glm::abs(glm::mod(hue * 6.0f + glm::vec3(0.0f, 4.0f, 2.0f), 6.0f) - 3.0f) - 1.0f, 0.0f, 1.0f);
+		TextureFile swatch;
+		for (int size = 4; size >= 1; size /= 2)
+		{
+			TextureFile::Level level = { size, size, std::vector<unsigned char>() };
+			for (int texel = 0; texel < size * size; texel++)
+				level.data.insert(level.data.end(), { (unsigned char)(rgb.r * 255.0f), (unsigned char)(rgb.g * 255.0f), (unsigned char)(rgb.b * 255.0f), 255 });
+			swatch.levels.push_back(level);
+		}
+		// past the last slot parts share the first swatch
+		int slot = partAtlas.Add(swatch);
+		partSlots.push_back(slot < 0 ? 0.0f : (float)slot);
+	}
+	RenderMaterial colorCodeMaterial;
+	colorCodeMaterial.id = 3;
+	colorCodeMaterial.atlas = &partAtlas;
+	// vertex colors while the atlas variant compiles
+	colorCodeMaterial.flatColor = true;
 
-	Texture penguinTex("penguin.png", GL_TEXTURE_2D, GL_TEXTURE0, GL_RGBA, GL_UNSIGNED_BYTE);
-	penguinTex.texUnit(shaderProgram, "tex0", 0);
+	unsigned long long submittedStateChanges = 0;
+	unsigned long long sortedStateChanges = 0;
 
 	// test for depth to avoid depth glitches
-	glEnable(GL_DEPTH_TEST);
+	GLState::Enable(GL_DEPTH_TEST);
 
-	Camera camera(width, height, glm::vec3(0.0f, 0.0f, 2.0f));
+	FrameUniforms frameUniforms;
+
+	// binding calls that reached the driver and that the state cache skipped
+	unsigned long long frames = 0;
+	GLState::Counters startCounters = GLState::counters;
+	int viewportWidth = width, viewportHeight = height;
 
-	while (!glfwWindowShouldClose(window)) 
+	while (!stop)
 	{
+		// sleeps while the main thread builds the next frame, or while nothing needs drawing
+		const FramePacket* packet = pipeline.Wait(0.05);
+		if (packet == NULL)
+			continue;
+		// wakes the main thread, it can build the frame after this one now
+		glfwPostEmptyEvent();
+
+		// a minimized window has a framebuffer of size 0
+		if (packet->framebufferWidth > 0 && packet->framebufferHeight > 0 && (packet->framebufferWidth != viewportWidth || packet->framebufferHeight != viewportHeight))
+		{
+			viewportWidth = packet->framebufferWidth;
+			viewportHeight = packet->framebufferHeight;
+			glViewport(0, 0, viewportWidth, viewportHeight);
+		}
+
 		// get our color
 		glClearColor(0.07f, 0.13f, 0.17f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		// activate shader program
-		shaderProgram.Activate();
+		// swap in variants that finished compiling and textures that finished uploading
+		shaders.Update();
+		textureLoader.Update();
+
+		frameUniforms.Update(packet->frameData);
+
+		// the streams grow once per cut, not once per frame
+		if (packet->sectionView && packet->capVertices != reservedCaps)
+		{
+			capVertexStream.Reserve(packet->capVertices->size() * sizeof(GLfloat));
+			capIndexStream.Reserve(packet->capIndices->size() * sizeof(GLuint));
+			reservedCaps = packet->capVertices;
+		}
 
-		camera.Inputs(window);
-		camera.Matrix(45.0f, 0.1f, 100.0f, shaderProgram, "camMatrix");
+		pyramidMaterial.clipPlane = packet->clipPlane;
+		partMaterial.clipPlane = packet->clipPlane;
+		colorCodeMaterial.clipPlane = packet->clipPlane;
 
-		// local coordinates: origin same as origin of object
-		// world coordinate: origin at center of world, contains objects
-		// view coordinates: origin same origin as camera/viewport
-		// clip coordinates: origin same as view, but clip(delete) coordinates
-		// screen coordinates: everything is flattened to view on screen
+		if (partGeometry.empty())
+		{
+			// specify primitive, starting index of vertices, and vertex count
+			// skipped for the frames an evicted texture takes to come back
+			if (residency.Use(penguinTex->residency))
+				renderQueue.Submit(RenderQueue::OPAQUE_PASS, shaders.Get(ShaderLibrary::TEXTURED | ShaderLibrary::CLIPPED), pyramidMaterial, VAO1, sizeof(indices) / sizeof(int), 0, glm::length(glm::vec3(packet->frameData.cameraPosition)));
+		}
+		else
+		{
+			// parts share one material, so sorted next to each other they become one multi draw per pool page
+			for (size_t part = 0; part < partGeometry.size(); part++)
+			{
+				// culled parts are not drawn, and do not count as used for the budget
+				const std::vector<glm::mat4>& transforms = packet->partTransforms[part];
+				if (transforms.empty())
+					continue;
+				// an evicted part is asked back and skipped until it is
+				if (!residency.Use(partResidency[part]))
+					continue;
+				float depth = packet->partDepths[part];
+				if (packet->colorCode)
+					renderQueue.Submit(RenderQueue::OPAQUE_PASS, shaders.Get(ShaderLibrary::INSTANCED | ShaderLibrary::CLIPPED | ShaderLibrary::ATLAS), colorCodeMaterial, geometryPool, partGeometry[part], transforms, depth, partSlots[part]);
+				else
+					renderQueue.Submit(RenderQueue::OPAQUE_PASS, shaders.Get(ShaderLibrary::INSTANCED | ShaderLibrary::CLIPPED), partMaterial, geometryPool, partGeometry[part], transforms, depth);
+			}
+		}
 
-		// initializing the matrix so it would have values, these are used to move
-		// coordinate systems
-	
+		if (packet->sectionView && packet->capIndices != NULL && !packet->capIndices->empty())
+		{
+			const std::vector<GLfloat>& caps = *packet->capVertices;
+			const std::vector<GLuint>& capIndexList = *packet->capIndices;
+			GLsizeiptr vertexBytes = caps.size() * sizeof(GLfloat);
+			GLsizeiptr indexBytes = capIndexList.size() * sizeof(GLuint);
+			StreamBuffer::Allocation capVertices = capVertexStream.Allocate(vertexBytes, 8 * sizeof(float));
+			StreamBuffer::Allocation capIndices = capIndexStream.Allocate(indexBytes, sizeof(GLuint));
+			if (capVertices.pointer != NULL)
+				std::memcpy(capVertices.pointer, caps.data(), vertexBytes);
+			if (capIndices.pointer != NULL)
+				std::memcpy(capIndices.pointer, capIndexList.data(), indexBytes);
+			capVertexStream.Commit(capVertices);
+			capIndexStream.Commit(capIndices);
 
-		// bind texture so it appears
-		penguinTex.Bind();
+			if (capVertices.pointer != NULL && capIndices.pointer != NULL)
+			{
+				// the VAO is pointed at this frame's data now, the queue only binds it
+				capVAO.Bind();
+				capVAO.LinkAttrib(capVertexStream.ID, 0, 3, GL_FLOAT, 8 * sizeof(float), (void*)(capVertices.offset));
+				capVAO.LinkAttrib(capVertexStream.ID, 1, 3, GL_FLOAT, 8 * sizeof(float), (void*)(capVertices.offset + 3 * sizeof(float)));
+				capVAO.LinkAttrib(capVertexStream.ID, 2, 2, GL_FLOAT, 8 * sizeof(float), (void*)(capVertices.offset + 6 * sizeof(float)));
+				capIndexStream.Bind();
+				renderQueue.Submit(RenderQueue::OVERLAY_PASS, shaders.Get(0), capMaterial, capVAO, (GLsizei)capIndexList.size(), (GLintptr)capIndices.offset, 0.0f);
+			}
+		}
 
-		// bind the VAO to use this specifically
-		VAO1.Bind();
+		renderQueue.Execute();
+		submittedStateChanges += renderQueue.stateChangesSubmitted;
+		sortedStateChanges += renderQueue.stateChangesSorted;
 
-		// specify primitive, starting index of vertices, and vertex count
-		glDrawElements(GL_TRIANGLES, sizeof(indices) / sizeof(int), GL_UNSIGNED_INT, 0);
+		capVertexStream.EndFrame();
+		capIndexStream.EndFrame();
+		// draws that did not fit the instance streams need another frame, nothing else would ask for it
+		bool dropped = geometryPool.EndFrame();
+		// evicts what was drawn least recently down to the budget and restores what was missed
+		residency.Update();
+
+		// GL objects released during the frame are deleted now that nothing in it uses them
+		GLResources::Collect();
 
 		// swap to show changes
 		glfwSwapBuffers(window);
+		pipeline.Presented(*packet, glfwGetTime());
+		frames++;
 
-		// handles all GLFW events
-		glfwPollEvents();
+		// uploads, variant compiles and restores only move on frames that are drawn
+		if (dropped || textureLoader.Uploading() || shaders.Pending() || residency.Restoring())
+			redraw.Invalidate(RedrawTracker::LOADING);
+	}
+
+	if (frames > 0)
+	{
+		std::cout << "State changes per frame: " << (double)(GLState::counters.issued - startCounters.issued) / frames << " issued, " << (double)(GLState::counters.elided - startCounters.elided) / frames << " elided" << std::endl;
+		std::cout << "Render queue state changes per frame: " << (double)submittedStateChanges / frames << " in submission order, " << (double)sortedStateChanges / frames << " sorted" << std::endl;
+		if (residency.Count() > 0)
+			residency.Print();
+		std::cout << textureLoader.texturesLoaded << " textures loaded, " << textureLoader.registry.hits << " loads shared an existing texture, " << textureLoader.registry.decodes << " decodes, " << textureLoader.registry.decodesShared << " shared" << std::endl;
+		std::cout << shaders.variantsReady << " shader variants built, " << shaders.variantsFromCache << " from the binary cache" << (GLExtensions::parallelShaderCompile ? ", compiled in parallel" : "") << std::endl;
+		std::cout << "Streamed " << (capVertexStream.totalBytesStreamed + capIndexStream.totalBytesStreamed) / 1024.0 / frames << " KB per frame, stalled " << capVertexStream.totalStallMilliseconds + capIndexStream.totalStallMilliseconds << " ms in total, " << (capVertexStream.persistent ? "persistent mapping" : "orphaning") << std::endl;
 	}
 
 	// clean up objects we created
 	VAO1.Delete();
 	VBO1.Delete();
 	EBO1.Delete();
-	penguinTex.Delete();
-	shaderProgram.Delete();
+	capVAO.Delete();
+	capVertexStream.Delete();
+	capIndexStream.Delete();
+	geometryPool.Delete();
+	partAtlas.Delete();
+	penguinTex->Delete();
+	textureLoader.Delete();
+	frameUniforms.Delete();
+	shaders.Delete();
+
+	// anything still alive here was never released
+	GLResources::Collect();
+	if (GLResources::LiveCount() > 0)
+		GLResources::Dump(std::cout);
+
+	// the window is destroyed on the main thread, which needs the context let go of first
+	glfwMakeContextCurrent(NULL);
+}
+
+// Measures the job system: the cost of one job, of a dependency chain and of a parallel loop over
+// tiny items, then how a math kernel scales from one thread to every core
+int benchJobs()
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	auto milliseconds = [](Clock::time_point start) { return std::chrono::duration<double, std::milli>(Clock::now() - start).count(); };
+	JobSystem& jobs = JobSystem::Shared();
+	bool correct = true;
+
+	const int emptyCount = 200000;
+	JobSystem::Counter counter;
+	auto start = Clock::now();
+	for (int i = 0; i < emptyCount; i++)
+		jobs.Run([]() {}, &counter);
+	jobs.Wait(counter);
+	std::cout << "Empty jobs: " << milliseconds(start) * 1e6 / emptyCount << " ns per job" << std::endl;
+
+	// every link waits on the one before, so the chain runs one job at a time whichever thread takes it
+	const int chainCount = 10000;
+	std::vector<JobSystem::Counter> links(chainCount);
+	int next = 0;
+	start = Clock::now();
+	for (int i = 0; i < chainCount; i++)
+		jobs.Run([&next, &correct, i]() { correct = correct && next == i; next++; }, &links[i], i > 0 ? &links[i - 1] : NULL);
+	jobs.Wait(links.back());
+	correct = correct && next == chainCount;
+	std::cout << "Dependency chain: " << milliseconds(start) * 1e6 / chainCount << " ns per link" << std::endl;
+
+	// the loop overhead shows on items that cost next to nothing
+	const size_t itemCount = 1 << 22;
+	std::vector<float> items(itemCount, 1.0f);
+	start = Clock::now();
+	for (float& item : items)
+		item = item * 1.0001f + 0.5f;
+	double serial = milliseconds(start);
+	start = Clock::now();
+	jobs.ParallelFor(itemCount, 4096, [&](size_t first, size_t last)
+	{
+		for (size_t i = first; i < last; i++)
+			items[i] = items[i] * 1.0001f + 0.5f;
+	});
+	std::cout << "ParallelFor over " << itemCount << " trivial items: " << milliseconds(start) << " ms, serial " << serial << " ms" << std::endl;
+	correct = correct && std::abs(items[itemCount - 1] - ((1.0f * 1.0001f + 0.5f) * 1.0001f + 0.5f)) < 1e-5f;
+
+	// a kernel heavy enough to hide the scheduling, items take longer towards the end like uneven parts
+	const size_t kernelCount = 1 << 16;
+	auto kernel = [](size_t i)
+	{
+		float x = (float)i * 0.001f;
+		int rounds = 64 + (int)(i * 256 / kernelCount);
+		for (int k = 0; k < rounds; k++)
+			x = std::sin(x) * 0.9f + std::sqrt(x * x + 1.0f) * 0.1f;
+		return x;
+	};
+	std::vector<float> expected(kernelCount);
+	for (size_t i = 0; i < kernelCount; i++)
+		expected[i] = kernel(i);
+	unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+	double single = 0.0;
+	for (unsigned workers = 0; workers < cores; workers++)
+	{
+		JobSystem scaling(workers == 0 ? 1 : workers);
+		std::vector<float> results(kernelCount);
+		start = Clock::now();
+		scaling.ParallelFor(kernelCount, 64, [&](size_t first, size_t last)
+		{
+			for (size_t i = first; i < last; i++)
+				results[i] = kernel(i);
+		}, workers + 1);
+		double time = milliseconds(start);
+		if (workers == 0)
+			single = time;
+		correct = correct && results == expected;
+		std::cout << workers + 1 << " threads: " << time << " ms, " << single / time << "x, " << scaling.steals << " steals" << std::endl;
+	}
+
+	std::cout << jobs.jobsRun << " jobs run, " << jobs.steals << " stolen" << std::endl;
+	if (!correct)
+	{
+		std::cout << "FAILED: jobs ran out of order or computed the wrong results" << std::endl;
+		return 1;
+	}
+	std::cout << "ok" << std::endl;
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	// the first call starts the workers and gives this thread the deque that helps while it waits
+	JobSystem::Shared();
+
+	// --bench-jobs measures job overhead and how parallel loops scale with the worker count
+	if (argc > 1 && std::string(argv[1]) == "--bench-jobs")
+		return benchJobs();
+	// --residency-stress [resources] [frames] exercises the GPU memory budget with simulated resources
+	if (argc > 1 && std::string(argv[1]) == "--residency-stress")
+		return residencyStress(argc > 2 ? std::max(1, std::atoi(argv[2])) : 5000, argc > 3 ? std::max(1, std::atoi(argv[3])) : 2000);
+
+	// --bench-ao <file.stl> bakes occlusion for every shell without the cache and reports ray throughput
+	if (argc > 2 && std::string(argv[1]) == "--bench-ao")
+	{
+		AmbientOcclusion bench;
+		double rays = 0.0, seconds = 0.0;
+		for (Mesh& shell : Mesh(argv[2], glm::vec3(1.0f)).Shells())
+		{
+			bench.Bake(shell, false);
+			rays += bench.raysPerSecond * bench.seconds;
+			seconds += bench.seconds;
+		}
+		std::cout << rays << " rays in " << seconds << " s, " << rays / seconds / 1e6 << " Mrays/s" << std::endl;
+		return 0;
+	}
+
+	// --render-sw <out.png> [file.stl ...] draws the startup view with the software rasterizer,
+	// for machines without a GPU
+	if (argc > 2 && std::string(argv[1]) == "--render-sw")
+	{
+		InstanceDetector detector;
+		loadAssembly(detector, argc - 3, argv + 3);
+		return renderSoftware(argv[2], detector);
+	}
+
+	// --thumbnails <list.txt|directory> <outdir> [size] renders a PNG preview of every STL without a window,
+	// run it again after an interruption and finished files are skipped
+	if (argc > 3 && std::string(argv[1]) == "--thumbnails")
+	{
+		ThumbnailRenderer thumbnails;
+		if (argc > 4)
+			thumbnails.size = std::max(16, std::atoi(argv[4]));
+		if (!thumbnails.Run(argv[2], argv[3]))
+		{
+			std::cout << "Failed to read " << argv[2] << std::endl;
+			return -1;
+		}
+		std::cout << thumbnails.rendered << " rendered, " << thumbnails.skipped << " already done, " << thumbnails.failed << " failed in " << thumbnails.seconds << " s, " << thumbnails.rendered / thumbnails.seconds << " files/s" << std::endl;
+		return thumbnails.failed ? 1 : 0;
+	}
+
+	// --compress-textures [rgba8|bc1|bc3|bc7] <image ...> builds the mip chain and block compresses images
+	// into the texture cache ahead of time and reports encode speed and memory saved, BC7 unless another
+	// format is given
+	if (argc > 2 && std::string(argv[1]) == "--compress-textures")
+	{
+		int first = 2;
+		bool chosen = false;
+		TextureFile::Format format = TextureFile::BC7;
+		std::string name = argv[2];
+		if (name == "rgba8" || name == "bc1" || name == "bc3" || name == "bc7")
+		{
+			format = name == "rgba8" ? TextureFile::RGBA8 : name == "bc1" ? TextureFile::BC1 : name == "bc3" ? TextureFile::BC3 : TextureFile::BC7;
+			chosen = true;
+			first = 3;
+		}
+		TextureCompressor compressor;
+		int failed = 0;
+		for (int i = first; i < argc; i++)
+		{
+			try
+			{
+				Image image(argv[i]);
+				TextureFile::Format used = chosen ? format : TextureCompressor::Choose(image, true);
+				compressor.Compress(image, used);
+				std::cout << argv[i] << ": " << TextureFile::Name(used) << " " << image.width << "x" << image.height << (compressor.cacheHit ? " cached" : "") << " in " << compressor.seconds * 1000.0 << " ms, "
+					<< compressor.megapixelsPerSecond << " Mpixels/s, " << compressor.uncompressedBytes / 1024 << " KB -> " << compressor.compressedBytes / 1024 << " KB" << std::endl;
+			}
+			catch (int)
+			{
+				std::cout << "Failed to read " << argv[i] << std::endl;
+				failed++;
+			}
+		}
+		return failed ? 1 : 0;
+	}
+
+	// options in front of the files, in any order:
+	// --gpu-budget <MB> keeps meshes and textures within that much GPU memory, the least recently
+	// drawn are evicted and uploaded again when they come back into view
+	// --vsync <off|on|adaptive> picks the swap interval, on unless given
+	// --fps <N> limits the frame rate, --no-adaptive keeps it while the window is unfocused or minimized
+	// --continuous draws every frame instead of only when something changed
+	// --no-program-cache compiles every shader program instead of loading stored driver binaries
+	ResidencyManager residency;
+	FramePacer pacer;
+	bool onDemand = true;
+	while (argc > 1)
+	{
+		std::string option = argv[1];
+		if (option == "--no-adaptive" || option == "--continuous" || option == "--no-program-cache")
+		{
+			if (option == "--no-adaptive")
+				pacer.adaptive = false;
+			else if (option == "--continuous")
+				onDemand = false;
+			else
+				ProgramCache::enabled = false;
+			argc -= 1;
+			argv += 1;
+			continue;
+		}
+		if (argc > 2 && option == "--gpu-budget")
+			residency.budget = (size_t)std::max(1, std::atoi(argv[2])) << 20;
+		else if (argc > 2 && option == "--vsync")
+		{
+			if (!pacer.ParseSwapMode(argv[2]))
+			{
+				std::cout << "Unknown vsync mode " << argv[2] << ", use off, on or adaptive" << std::endl;
+				return -1;
+			}
+		}
+		else if (argc > 2 && option == "--fps")
+			pacer.targetFps = std::max(0.0, std::atof(argv[2]));
+		else
+			break;
+		argc -= 2;
+		argv += 2;
+	}
+
+	glfwInit();
+
+	// tell GLFW the version and profile we are using of OPENGL
+	// we use CORE because that has the modern functions
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+	// create a GLFW window object to put our stuffs on
+	GLFWwindow* window = glfwCreateWindow(width, height, "OpenGL", NULL, NULL);
+
+	// error check to cleanly remove GLFW in case window fails to create
+	if (window == NULL)
+	{
+		std::cout << "Failed to create GLFW window" << std::endl;
+		glfwTerminate();
+		return -1;
+	}
+
+	// introduce window into the current context (make it visible)
+	glfwMakeContextCurrent(window);
+
+	// load GLAD to configure OpenGL
+	gladLoadGL();
+	// entry points newer than GL 3.3, used when the driver has them
+	GLExtensions::Load();
+
+	// specify viewport of OpenGL in window
+	glViewport(0, 0, width, height);
+
+	// --bench-shaders builds the program with an empty binary cache and again with the binary it saved
+	if (argc > 1 && std::string(argv[1]) == "--bench-shaders")
+	{
+		if (!GLExtensions::programBinary)
+			std::cout << "Driver has no program binary support, both runs compile" << std::endl;
+		ProgramCache::Clear();
+		const char* runs[2] = { "cold", "warm" };
+		for (const char* run : runs)
+		{
+			double start = glfwGetTime();
+			Shader program("default.vert", "default.frag");
+			glFinish();
+			std::cout << run << " cache: " << (glfwGetTime() - start) * 1000.0 << " ms" << (program.fromCache ? " from binary" : " compiled") << std::endl;
+		}
+		GLResources::Collect();
+		glfwDestroyWindow(window);
+		glfwTerminate();
+		return 0;
+	}
+
+	// STL files on the command line replace the pyramid and are drawn instanced
+	InstanceDetector detector;
+	loadAssembly(detector, argc - 1, argv + 1);
+
+	// occlusion is baked once per unique geometry, so every copy shares it
+	AmbientOcclusion ambientOcclusion;
+	std::vector<std::vector<GLubyte>> partOcclusion;
+	std::vector<glm::vec4> partBounds;
+	size_t instanceCount = 0;
+	for (InstancedPart& part : detector.parts)
+	{
+		std::vector<GLubyte> occlusion = ambientOcclusion.Bake(part.geometry);
+		if (!ambientOcclusion.cacheHit)
+			std::cout << "Baked occlusion for " << part.geometry.VertexCount() << " vertices in " << ambientOcclusion.seconds << " s, " << ambientOcclusion.raysPerSecond / 1e6 << " Mrays/s" << std::endl;
+		partOcclusion.push_back(std::move(occlusion));
+		partBounds.push_back(boundingSphere(part.geometry));
+		instanceCount += part.transforms.size();
+	}
+	if (argc > 1)
+		std::cout << detector.partsAdded << " parts, " << detector.parts.size() << " unique geometries, " << instanceCount << " instances" << std::endl;
+
+	// stbi and opengl are reversed vertically so we must flip to right side up
+	stbi_set_flip_vertically_on_load(true);
+
+	// section view cuts the mesh with a plane and closes the cut with cap polygons
+	// C toggles it, the up and down arrows move the plane
+	// the cut works on the whole scene in world space, so instanced parts are expanded for it on the CPU
+	Mesh scene(vertices, sizeof(vertices), indices, sizeof(indices));
+	if (!detector.parts.empty())
+	{
+		scene = Mesh();
+		for (InstancedPart& part : detector.parts)
+			for (glm::mat4& transform : part.transforms)
+				scene.Append(part.geometry, transform);
+	}
+	SectionPlane section(scene.vertices.data(), scene.VertexCount(), Mesh::stride, scene.indices.data(), scene.indices.size(), glm::vec3(0.0f, 0.0f, -1.0f));
+	bool sectionView = false;
+	bool sectionDirty = true;
+	// the caps of the last cut, every packet shares them until the plane moves again
+	std::shared_ptr<const std::vector<GLfloat>> capVertices;
+	std::shared_ptr<const std::vector<GLuint>> capIndices;
+
+	// T color codes the parts
+	bool colorCode = false;
+
+	// the wheel zooms to and orbits turn around the surface under the cursor, found in a tree over the
+	// same world space triangles the section cuts
+	BVH pickTree(scene);
+	Camera camera(width, height, glm::vec3(0.0f, 0.0f, 2.0f));
+	camera.Pick = [&](glm::vec3 origin, glm::vec3 direction) { return pickTree.Intersect(origin, direction, 0.0f, 1e30f); };
+	// input comes in through callbacks, so nothing is polled while the viewer sits idle
+	InputQueue input;
+	input.Install(window);
+
+	// the render thread owns the context from here on. This thread reads the input, moves the camera
+	// and the plane and culls the next frame while the render thread submits the one before
+	FramePipeline pipeline;
+	std::atomic<bool> stopRendering(false);
+	// frames are only built when something changed, the first one because nothing is on screen yet
+	RedrawTracker redraw;
+	redraw.Invalidate(RedrawTracker::WINDOW);
+	glfwMakeContextCurrent(NULL);
+	std::thread renderThread(render, window, std::ref(pipeline), std::ref(stopRendering), std::ref(detector), std::ref(partOcclusion), std::ref(residency), pacer.swapMode, std::ref(redraw));
+
+	unsigned long long packets = 0;
+	unsigned long long instancesVisible = 0;
+	// the camera or plane moved last frame, held keys and easing keep doing so without new events
+	bool moving = false;
+	double lastTime = glfwGetTime();
+	while (!glfwWindowShouldClose(window))
+	{
+		// nothing moved and nothing asked for a frame, sleep until something happens
+		if (onDemand && !moving && !redraw.Requested())
+		{
+			redraw.WaitIdle();
+			pacer.Resume();
+			// nothing moved while idle, the time spent waiting is not motion
+			lastTime = glfwGetTime();
+		}
+
+		// holds the frame until it is due, so the input below is read as late as it can be
+		pacer.Wait(glfwGetWindowAttrib(window, GLFW_FOCUSED) != 0, glfwGetWindowAttrib(window, GLFW_ICONIFIED) != 0);
+
+		// handles all GLFW events, which only this thread may do, and queues them
+		glfwPollEvents();
+		input.BeginFrame();
+		// motion is integrated over the time that passed, so it keeps its speed at any frame rate.
+		// Only a real stall, like a window drag or a hitch, is capped so the view does not jump
+		double now = glfwGetTime();
+		float deltaSeconds = (float)glm::min(now - lastTime, 0.25);
+		lastTime = now;
+
+		glm::vec3 position = camera.Position;
+		glm::vec3 orientation = camera.Orientation;
+		moving = camera.Update(input, deltaSeconds);
+		if (moving || camera.Position != position || camera.Orientation != orientation)
+			redraw.Invalidate(RedrawTracker::CAMERA);
+
+		for (const InputQueue::Event& event : input.Events())
+		{
+			if (event.type == InputQueue::WINDOW)
+				redraw.Invalidate(RedrawTracker::WINDOW);
+			if (event.type != InputQueue::KEY || event.action != GLFW_PRESS)
+				continue;
+			if (event.code == GLFW_KEY_C)
+			{
+				sectionView = !sectionView;
+				sectionDirty = true;
+			}
+			if (event.code == GLFW_KEY_T)
+			{
+				colorCode = !colorCode;
+				redraw.Invalidate(RedrawTracker::INPUT);
+			}
+		}
+		// the plane moves at a rate too, across the whole model in a little under two seconds
+		if (sectionView && input.KeyHeld(GLFW_KEY_UP) && section.Offset < section.maxOffset)
+		{
+			section.Offset = glm::min(section.Offset + 0.6f * deltaSeconds, section.maxOffset);
+			sectionDirty = true;
+		}
+		if (sectionView && input.KeyHeld(GLFW_KEY_DOWN) && section.Offset > section.minOffset)
+		{
+			section.Offset = glm::max(section.Offset - 0.6f * deltaSeconds, section.minOffset);
+			sectionDirty = true;
+		}
+
+		// only recut when the plane actually moved
+		if (sectionView && sectionDirty)
+		{
+			section.Cut(section.Offset);
+			capVertices = std::make_shared<const std::vector<GLfloat>>(section.capVertices);
+			capIndices = std::make_shared<const std::vector<GLuint>>(section.capIndices);
+		}
+		// turning the section off changes the picture too
+		if (sectionDirty)
+		{
+			redraw.Invalidate(RedrawTracker::INPUT);
+			moving = true;
+		}
+		sectionDirty = false;
+
+		// the same frame again, back to waiting. Continuous mode draws it anyway
+		if (redraw.Take() == 0 && onDemand)
+			continue;
+
+		FramePacket& packet = pipeline.Back();
+		packet.inputTime = glfwGetTime();
+		glfwGetFramebufferSize(window, &packet.framebufferWidth, &packet.framebufferHeight);
+		// the camera keeps the window size for its aspect and for centering the cursor, not while minimized
+		int windowWidth, windowHeight;
+		glfwGetWindowSize(window, &windowWidth, &windowHeight);
+		if (windowWidth > 0 && windowHeight > 0)
+		{
+			camera.width = windowWidth;
+			camera.height = windowHeight;
+		}
+		// camera and global values go to every program through one uniform buffer
+		packet.frameData = FrameUniforms::Build(camera, camera.fieldOfView, 0.1f, 100.0f, (float)packet.inputTime);
+		packet.colorCode = colorCode;
+		packet.sectionView = sectionView;
+		packet.clipPlane = sectionView ? section.Equation() : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		packet.capVertices = capVertices;
+		packet.capIndices = capIndices;
+		cullParts(detector, partBounds, packet);
+		instancesVisible += packet.instancesVisible;
+		pipeline.Publish();
+		packets++;
+
+		// the render thread takes the packet once it has submitted the one before, events are
+		// handled while this thread waits for that
+		while (pipeline.Pending() && !glfwWindowShouldClose(window))
+			glfwWaitEvents();
+	}
+
+	stopRendering = true;
+	renderThread.join();
+	if (packets > 0 && instanceCount > 0)
+		std::cout << "Culling kept " << (double)instancesVisible / packets << " of " << instanceCount << " instances per frame" << std::endl;
+	pipeline.Print();
+	pacer.Print();
+	redraw.Print();
 
 	// clean up once done
 	glfwDestroyWindow(window);
 	glfwTerminate();
 	return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,165 @@
+#include"Mesh.h"
+
+#include<algorithm>
+#include<cerrno>
+#include<cstdint>
+#include<cstring>
+#include<fstream>
+#include<numeric>
+#include<sstream>
+#include<string>
+
+// Constructor for an empty mesh
+Mesh::Mesh()
+{
+}
+
+// Constructor that copies interleaved vertices and indices, sizes are in bytes like VBO and EBO
+Mesh::Mesh(const GLfloat* vertices, GLsizeiptr verticesSize, const GLuint* indices, GLsizeiptr indicesSize)
+{
+	Mesh::vertices.assign(vertices, vertices + verticesSize / sizeof(GLfloat));
+	Mesh::indices.assign(indices, indices + indicesSize / sizeof(GLuint));
+}
+
+// Constructor that reads a binary or ASCII STL file and welds the vertices the triangles share
+Mesh::Mesh(const char* filename, glm::vec3 color)
+{
+	std::ifstream in(filename, std::ios::binary);
+	if (!in)
+		throw(errno);
+	std::string contents((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+	// corners of every triangle, three per triangle
+	std::vector<glm::vec3> corners;
+
+	// binary STL is an 80 byte header, a triangle count and 50 bytes per triangle, ASCII files
+	// also start with "solid" so the size is the reliable test
+	uint32_t triangleCount = 0;
+	if (contents.size() >= 84)
+		std::memcpy(&triangleCount, contents.data() + 80, sizeof(uint32_t));
+	if (contents.size() >= 84 && contents.size() == 84 + (size_t)triangleCount * 50)
+	{
+		corners.resize((size_t)triangleCount * 3);
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			// skip the 12 byte facet normal, it is recomputed from the winding when needed
+			const char* facet = contents.data() + 84 + t * 50 + 12;
+			std::memcpy(&corners[t * 3], facet, 3 * sizeof(glm::vec3));
+		}
+	}
+	else
+	{
+		std::istringstream text(contents);
+		std::string word;
+		while (text >> word)
+		{
+			if (word == "vertex")
+			{
+				glm::vec3 p;
+				text >> p.x >> p.y >> p.z;
+				corners.push_back(p);
+			}
+		}
+		corners.resize(corners.size() - corners.size() % 3);
+	}
+
+	// weld by sorting the corners so equal positions end up next to each other
+	std::vector<GLuint> order(corners.size());
+	std::iota(order.begin(), order.end(), 0);
+	auto less = [&corners](GLuint l, GLuint r)
+	{
+		const glm::vec3& a = corners[l];
+		const glm::vec3& b = corners[r];
+		if (a.x != b.x)
+			return a.x < b.x;
+		if (a.y != b.y)
+			return a.y < b.y;
+		return a.z < b.z;
+	};
+	std::sort(order.begin(), order.end(), less);
+
+	indices.resize(corners.size());
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		if (i == 0 || corners[order[i]] != corners[order[i - 1]])
+		{
+			const glm::vec3& p = corners[order[i]];
+			vertices.insert(vertices.end(), { p.x, p.y, p.z, color.r, color.g, color.b, 0.0f, 0.0f });
+		}
+		indices[order[i]] = (GLuint)(VertexCount() - 1);
+	}
+}
+
+size_t Mesh::VertexCount() const
+{
+	return vertices.size() / stride;
+}
+
+glm::vec3 Mesh::Position(size_t vertex) const
+{
+	return glm::vec3(vertices[vertex * stride], vertices[vertex * stride + 1], vertices[vertex * stride + 2]);
+}
+
+// Splits the mesh into its connected shells, an assembly exported as one file usually has one shell per part
+std::vector<Mesh> Mesh::Shells() const
+{
+	// union find over the vertices, every triangle joins its three corners
+	std::vector<GLuint> parent(VertexCount());
+	std::iota(parent.begin(), parent.end(), 0);
+	auto find = [&parent](GLuint v)
+	{
+		while (parent[v] != v)
+		{
+			parent[v] = parent[parent[v]];
+			v = parent[v];
+		}
+		return v;
+	};
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		GLuint a = find(indices[i]);
+		parent[find(indices[i + 1])] = a;
+		parent[find(indices[i + 2])] = a;
+	}
+
+	// number the shells in order of their first vertex so the output is stable
+	std::vector<GLuint> shellOf(VertexCount(), 0xFFFFFFFFu);
+	std::vector<GLuint> newIndex(VertexCount());
+	std::vector<Mesh> shells;
+	for (size_t v = 0; v < VertexCount(); v++)
+	{
+		GLuint root = find((GLuint)v);
+		if (shellOf[root] == 0xFFFFFFFFu)
+		{
+			shellOf[root] = (GLuint)shells.size();
+			shells.emplace_back();
+		}
+		Mesh& shell = shells[shellOf[root]];
+		newIndex[v] = (GLuint)shell.VertexCount();
+		shell.vertices.insert(shell.vertices.end(), vertices.begin() + v * stride, vertices.begin() + (v + 1) * stride);
+	}
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		Mesh& shell = shells[shellOf[find(indices[i])]];
+		for (int k = 0; k < 3; k++)
+			shell.indices.push_back(newIndex[indices[i + k]]);
+	}
+
+	// vertices no triangle uses end up as shells of their own, drop them
+	shells.erase(std::remove_if(shells.begin(), shells.end(), [](const Mesh& m) { return m.indices.empty(); }), shells.end());
+	return shells;
+}
+
+// Appends the vertices of another mesh moved by a transform
+void Mesh::Append(const Mesh& other, const glm::mat4& transform)
+{
+	GLuint base = (GLuint)VertexCount();
+	for (size_t v = 0; v < other.VertexCount(); v++)
+	{
+		glm::vec3 p = glm::vec3(transform * glm::vec4(other.Position(v), 1.0f));
+		vertices.insert(vertices.end(), { p.x, p.y, p.z });
+		vertices.insert(vertices.end(), other.vertices.begin() + v * stride + 3, other.vertices.begin() + (v + 1) * stride);
+	}
+	for (GLuint i : other.indices)
+		indices.push_back(base + i);
+}
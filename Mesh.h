@@ -0,0 +1,35 @@
+#ifndef MESH_CLASS_H
+#define MESH_CLASS_H
+
+#include<glad/glad.h>
+#include<glm/glm.hpp>
+#include<vector>
+
+// Indexed triangle mesh in the vertex layout of the default shader:
+// position (3), color (3), texture coordinate (2)
+class Mesh
+{
+public:
+	// Number of floats per vertex
+	static const size_t stride = 8;
+
+	std::vector<GLfloat> vertices;
+	std::vector<GLuint> indices;
+
+	// Constructor for an empty mesh
+	Mesh();
+	// Constructor that copies interleaved vertices and indices, sizes are in bytes like VBO and EBO
+	Mesh(const GLfloat* vertices, GLsizeiptr verticesSize, const GLuint* indices, GLsizeiptr indicesSize);
+	// Constructor that reads a binary or ASCII STL file and welds the vertices the triangles share
+	Mesh(const char* filename, glm::vec3 color);
+
+	size_t VertexCount() const;
+	glm::vec3 Position(size_t vertex) const;
+
+	// Splits the mesh into its connected shells, an assembly exported as one file usually has one shell per part
+	std::vector<Mesh> Shells() const;
+	// Appends the vertices of another mesh moved by a transform
+	void Append(const Mesh& other, const glm::mat4& transform);
+};
+
+#endif
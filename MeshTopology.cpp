@@ -0,0 +1,41 @@
+#include"MeshTopology.h"
+
+#include<algorithm>
+#include<cstdint>
+
+// Constructor that welds the half edges of the triangles into unique edges
+MeshTopology::MeshTopology(const GLuint* indices, size_t indexCount)
+{
+	triangleCount = indexCount / 3;
+	size_t halfEdgeCount = triangleCount * 3;
+
+	// key every half edge by its sorted vertex pair so both sides of an edge sort next to each other
+	std::vector<uint64_t> keys(halfEdgeCount);
+	std::vector<GLuint> order(halfEdgeCount);
+	for (size_t i = 0; i < halfEdgeCount; i++)
+	{
+		GLuint a = indices[i];
+		GLuint b = indices[(i % 3 == 2) ? i - 2 : i + 1];
+		if (a > b)
+			std::swap(a, b);
+		keys[i] = ((uint64_t)a << 32) | b;
+		order[i] = (GLuint)i;
+	}
+	std::sort(order.begin(), order.end(), [&keys](GLuint l, GLuint r) { return keys[l] < keys[r]; });
+
+	// every run of equal keys becomes one edge
+	triangleEdges.resize(halfEdgeCount);
+	edgeVertices.clear();
+	edgeVertices.reserve(halfEdgeCount);
+	edgeCount = 0;
+	for (size_t i = 0; i < halfEdgeCount; i++)
+	{
+		if (i == 0 || keys[order[i]] != keys[order[i - 1]])
+		{
+			edgeVertices.push_back((GLuint)(keys[order[i]] >> 32));
+			edgeVertices.push_back((GLuint)(keys[order[i]] & 0xFFFFFFFFu));
+			edgeCount++;
+		}
+		triangleEdges[order[i]] = (GLuint)(edgeCount - 1);
+	}
+}
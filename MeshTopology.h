@@ -0,0 +1,25 @@
+#ifndef MESH_TOPOLOGY_CLASS_H
+#define MESH_TOPOLOGY_CLASS_H
+
+#include<glad/glad.h>
+#include<cstddef>
+#include<vector>
+
+// Edge/triangle adjacency for an indexed triangle mesh, built once per mesh so
+// per-frame algorithms (like section cuts) can refer to edges by a stable ID
+class MeshTopology
+{
+public:
+	// Number of triangles and unique undirected edges
+	size_t triangleCount;
+	size_t edgeCount;
+	// Two vertex indices per edge, smaller index first
+	std::vector<GLuint> edgeVertices;
+	// Three edge IDs per triangle, edge k runs from corner k to corner k + 1
+	std::vector<GLuint> triangleEdges;
+
+	// Constructor that welds the half edges of the triangles into unique edges
+	MeshTopology(const GLuint* indices, size_t indexCount);
+};
+
+#endif
@@ -0,0 +1,204 @@
+#include"MipGenerator.h"
+
+#include<algorithm>
+#include<chrono>
+#include<cmath>
+
+#include"JobSystem.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include<emmintrin.h>
+#define MIP_GENERATOR_SSE2
+#endif
+
+namespace
+{
+	const float PI = 3.14159265358979f;
+	// Kaiser window reach in texels of the smaller level, and its shape
+	const float KAISER_RADIUS = 1.5f;
+	const float KAISER_ALPHA = 4.0f;
+	// entries of the linear to sRGB table, enough that no byte is skipped
+	const int ENCODE_STEPS = 4096;
+
+	// Source texels that make up one destination texel and how much each counts
+	struct Taps
+	{
+		int first;
+		std::vector<float> weights;
+	};
+
+	float besselI0(float x)
+	{
+		float sum = 1.0f, term = 1.0f;
+		for (int k = 1; k < 16; k++)
+		{
+			term *= (x / (2.0f * k)) * (x / (2.0f * k));
+			sum += term;
+		}
+		return sum;
+	}
+
+	float sinc(float x)
+	{
+		return std::fabs(x) < 1e-5f ? 1.0f : std::sin(PI * x) / (PI * x);
+	}
+
+	// Weights for shrinking a row of source texels to destination texels
+	std::vector<Taps> makeTaps(int source, int destination, MipGenerator::Filter filter)
+	{
+		std::vector<Taps> taps(destination);
+		float scale = (float)source / destination;
+		for (int x = 0; x < destination; x++)
+		{
+			Taps& tap = taps[x];
+			if (filter == MipGenerator::BOX || scale < 1.0f + 1e-3f)
+			{
+				// exact overlap of [x, x + 1) in destination texels with every source texel,
+				// a 5 wide row going to 2 gives weights 1, 1, 0.5 and 0.5, 1, 1
+				float start = x * scale, end = (x + 1) * scale;
+				tap.first = (int)std::floor(start);
+				for (int i = tap.first; i < end && i < source; i++)
+					tap.weights.push_back(std::min(end, (float)i + 1.0f) - std::max(start, (float)i));
+			}
+			else
+			{
+				float center = (x + 0.5f) * scale;
+				float reach = KAISER_RADIUS * scale;
+				tap.first = (int)std::floor(center - reach);
+				int last = (int)std::ceil(center + reach);
+				float window = besselI0(KAISER_ALPHA);
+				for (int i = tap.first; i <= last; i++)
+				{
+					float distance = (i + 0.5f - center) / scale;
+					float r = distance / KAISER_RADIUS;
+					float weight = r * r < 1.0f ? sinc(distance) * besselI0(KAISER_ALPHA * std::sqrt(1.0f - r * r)) / window : 0.0f;
+					tap.weights.push_back(weight);
+				}
+			}
+			float sum = 0.0f;
+			for (float weight : tap.weights)
+				sum += weight;
+			for (float& weight : tap.weights)
+				weight /= sum;
+		}
+		return taps;
+	}
+
+	// Runs work(row) for every row on the shared job system with at most threads threads, 0 for all
+	template<typename Work>
+	void forRows(unsigned threads, int rows, Work work)
+	{
+		JobSystem::Shared().ParallelFor((size_t)rows, 1, [&](size_t first, size_t last)
+		{
+			for (size_t row = first; row < last; row++)
+				work((int)row);
+		}, threads);
+	}
+
+	// Sum of weighted RGBA texels, source index clamped to the edge. stride is in texels
+	void accumulate(const float* source, int count, int stride, const Taps& tap, float* out)
+	{
+#ifdef MIP_GENERATOR_SSE2
+		__m128 sum = _mm_setzero_ps();
+		for (size_t k = 0; k < tap.weights.size(); k++)
+		{
+			int i = std::min(std::max(tap.first + (int)k, 0), count - 1);
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(source + (size_t)i * stride * 4), _mm_set1_ps(tap.weights[k])));
+		}
+		_mm_storeu_ps(out, sum);
+#else
+		float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		for (size_t k = 0; k < tap.weights.size(); k++)
+		{
+			int i = std::min(std::max(tap.first + (int)k, 0), count - 1);
+			for (int c = 0; c < 4; c++)
+				sum[c] += source[(size_t)i * stride * 4 + c] * tap.weights[k];
+		}
+		for (int c = 0; c < 4; c++)
+			out[c] = sum[c];
+#endif
+	}
+}
+
+// Every level from the image down to 1x1, all RGBA. Level 0 is the image itself
+std::vector<Image> MipGenerator::Build(const Image& image)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	float decode[256];
+	for (int v = 0; v < 256; v++)
+	{
+		float c = v / 255.0f;
+		decode[v] = srgb ? (c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f)) : c;
+	}
+	std::vector<unsigned char> encode(ENCODE_STEPS + 1);
+	for (int step = 0; step <= ENCODE_STEPS; step++)
+	{
+		float c = (float)step / ENCODE_STEPS;
+		if (srgb)
+			c = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+		encode[step] = (unsigned char)std::lround(std::min(std::max(c, 0.0f), 1.0f) * 255.0f);
+	}
+
+	// level 0 widened to RGBA, and in linear floats as the source of level 1
+	std::vector<Image> levels;
+	levels.emplace_back(image.width, image.height, 4);
+	int width = image.width, height = image.height;
+	std::vector<float> current((size_t)width * height * 4);
+	for (size_t i = 0; i < (size_t)width * height; i++)
+	{
+		const unsigned char* in = &image.pixels[i * image.channels];
+		unsigned char rgba[4];
+		switch (image.channels)
+		{
+		case 1: rgba[0] = rgba[1] = rgba[2] = in[0]; rgba[3] = 255; break;
+		case 2: rgba[0] = rgba[1] = rgba[2] = in[0]; rgba[3] = in[1]; break;
+		case 3: rgba[0] = in[0]; rgba[1] = in[1]; rgba[2] = in[2]; rgba[3] = 255; break;
+		default: rgba[0] = in[0]; rgba[1] = in[1]; rgba[2] = in[2]; rgba[3] = in[3]; break;
+		}
+		for (int c = 0; c < 4; c++)
+		{
+			levels[0].pixels[i * 4 + c] = rgba[c];
+			current[i * 4 + c] = c < 3 ? decode[rgba[c]] : rgba[c] / 255.0f;
+		}
+	}
+
+	while (width > 1 || height > 1)
+	{
+		int nextWidth = std::max(1, width / 2), nextHeight = std::max(1, height / 2);
+		std::vector<Taps> columns = makeTaps(width, nextWidth, filter);
+		std::vector<Taps> rows = makeTaps(height, nextHeight, filter);
+
+		// horizontal pass into a buffer nextWidth wide and height tall, then the vertical pass
+		std::vector<float> narrow((size_t)nextWidth * height * 4);
+		forRows(threadCount, height, [&](int y)
+		{
+			for (int x = 0; x < nextWidth; x++)
+				accumulate(&current[(size_t)y * width * 4], width, 1, columns[x], &narrow[((size_t)y * nextWidth + x) * 4]);
+		});
+		std::vector<float> next((size_t)nextWidth * nextHeight * 4);
+		levels.emplace_back(nextWidth, nextHeight, 4);
+		Image& level = levels.back();
+		forRows(threadCount, nextHeight, [&](int y)
+		{
+			for (int x = 0; x < nextWidth; x++)
+			{
+				float* texel = &next[((size_t)y * nextWidth + x) * 4];
+				accumulate(&narrow[(size_t)x * 4], height, nextWidth, rows[y], texel);
+				// the sinc lobes can overshoot
+				for (int c = 0; c < 4; c++)
+				{
+					texel[c] = std::min(std::max(texel[c], 0.0f), 1.0f);
+					level.pixels[((size_t)y * nextWidth + x) * 4 + c] = c < 3 ? encode[(int)(texel[c] * ENCODE_STEPS + 0.5f)] : (unsigned char)std::lround(texel[c] * 255.0f);
+				}
+			}
+		});
+
+		current.swap(next);
+		width = nextWidth;
+		height = nextHeight;
+	}
+
+	seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	return levels;
+}
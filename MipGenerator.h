@@ -0,0 +1,36 @@
+#ifndef MIP_GENERATOR_CLASS_H
+#define MIP_GENERATOR_CLASS_H
+
+#include<vector>
+
+#include"Image.h"
+
+// Builds a full mip chain on the CPU so textures never depend on the driver's glGenerateMipmap.
+// Color is filtered in linear light when it is sRGB encoded, alpha is always linear. Each level is
+// resampled separably from the one above with SSE2, rows are spread over every core, and sizes
+// that are not powers of two shrink by exact area weights instead of dropping texels
+class MipGenerator
+{
+public:
+	enum Filter
+	{
+		// average of the texels under each new texel
+		BOX,
+		// Kaiser windowed sinc, sharper and with less aliasing than the box
+		KAISER
+	};
+
+	Filter filter = KAISER;
+	// Color channels hold sRGB encoded values, which is what image files usually contain
+	bool srgb = true;
+	// Most threads of the shared JobSystem that filter rows, 0 for all of them
+	unsigned threadCount = 0;
+
+	// Time the last Build took
+	double seconds = 0.0;
+
+	// Every level from the image down to 1x1, all RGBA. Level 0 is the image itself
+	std::vector<Image> Build(const Image& image);
+};
+
+#endif
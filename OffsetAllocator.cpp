@@ -0,0 +1,194 @@
+#include"OffsetAllocator.h"
+
+#include<algorithm>
+
+namespace
+{
+	uint32_t highestBit(uint32_t value)
+	{
+		uint32_t bit = 0;
+		while (value >>= 1)
+			bit++;
+		return bit;
+	}
+
+	uint32_t lowestBit(uint32_t value)
+	{
+		uint32_t bit = 0;
+		while (!(value & 1))
+		{
+			value >>= 1;
+			bit++;
+		}
+		return bit;
+	}
+}
+
+// Constructor for a space of capacity units
+OffsetAllocator::OffsetAllocator(uint32_t capacity)
+	: capacity(capacity), freeSpace(0)
+{
+	std::fill(bins, bins + FIRST_LEVELS * SECOND_LEVELS, NONE);
+	if (capacity > 0)
+	{
+		insertFree(newNode(0, capacity, NONE, NONE));
+		freeSpace = capacity;
+	}
+}
+
+// Returns a range of size units, offset is NO_SPACE when no free range is big enough
+OffsetAllocator::Allocation OffsetAllocator::Allocate(uint32_t size)
+{
+	Allocation allocation;
+	if (size == 0 || size > freeSpace)
+		return allocation;
+
+	// the first non empty bin at or above the rounded up size, any range in it fits
+	uint32_t bin = binAtLeast(size);
+	uint32_t firstLevel = bin / SECOND_LEVELS;
+	if (firstLevel >= FIRST_LEVELS)
+		return allocation;
+	uint32_t secondLevelMap = secondLevelMaps[firstLevel] & (~0u << (bin % SECOND_LEVELS));
+	if (secondLevelMap == 0)
+	{
+		uint32_t firstLevelMapAbove = firstLevel + 1 < FIRST_LEVELS ? firstLevelMap & (~0u << (firstLevel + 1)) : 0;
+		if (firstLevelMapAbove == 0)
+			return allocation;
+		firstLevel = lowestBit(firstLevelMapAbove);
+		secondLevelMap = secondLevelMaps[firstLevel];
+	}
+	uint32_t node = bins[firstLevel * SECOND_LEVELS + lowestBit(secondLevelMap)];
+	removeFree(node);
+
+	// the rest of the range goes back as its own free node
+	if (nodes[node].size > size)
+	{
+		uint32_t rest = newNode(nodes[node].offset + size, nodes[node].size - size, node, nodes[node].next);
+		if (nodes[node].next != NONE)
+			nodes[nodes[node].next].previous = rest;
+		nodes[node].next = rest;
+		nodes[node].size = size;
+		insertFree(rest);
+	}
+	nodes[node].used = true;
+	freeSpace -= size;
+
+	allocation.offset = nodes[node].offset;
+	allocation.node = node;
+	return allocation;
+}
+
+// Gives a range back
+void OffsetAllocator::Free(Allocation allocation)
+{
+	uint32_t node = allocation.node;
+	if (node == NO_SPACE || node >= nodes.size() || !nodes[node].used)
+		return;
+	freeSpace += nodes[node].size;
+	nodes[node].used = false;
+
+	// merge with the free neighbours, the merged node keeps the lowest offset
+	uint32_t previous = nodes[node].previous;
+	if (previous != NONE && !nodes[previous].used)
+	{
+		removeFree(previous);
+		nodes[previous].size += nodes[node].size;
+		nodes[previous].next = nodes[node].next;
+		if (nodes[node].next != NONE)
+			nodes[nodes[node].next].previous = previous;
+		unusedNodes.push_back(node);
+		node = previous;
+	}
+	uint32_t next = nodes[node].next;
+	if (next != NONE && !nodes[next].used)
+	{
+		removeFree(next);
+		nodes[node].size += nodes[next].size;
+		nodes[node].next = nodes[next].next;
+		if (nodes[next].next != NONE)
+			nodes[nodes[next].next].previous = node;
+		unusedNodes.push_back(next);
+	}
+	insertFree(node);
+}
+
+// Size of the biggest range Allocate could return right now
+uint32_t OffsetAllocator::LargestFree() const
+{
+	if (firstLevelMap == 0)
+		return 0;
+	uint32_t firstLevel = highestBit(firstLevelMap);
+	uint32_t bin = firstLevel * SECOND_LEVELS + highestBit(secondLevelMaps[firstLevel]);
+	uint32_t largest = 0;
+	for (uint32_t node = bins[bin]; node != NONE; node = nodes[node].nextFree)
+		largest = std::max(largest, nodes[node].size);
+	return largest;
+}
+
+// Bin of a free range, rounded down so every range in it is at least the bin size
+uint32_t OffsetAllocator::binOf(uint32_t size)
+{
+	// small sizes get one bin each
+	if (size < SECOND_LEVELS)
+		return size;
+	uint32_t high = highestBit(size);
+	uint32_t secondLevel = (size >> (high - SECOND_LEVEL_BITS)) & (SECOND_LEVELS - 1);
+	return (high - SECOND_LEVEL_BITS + 1) * SECOND_LEVELS + secondLevel;
+}
+
+// First bin whose every range is at least size, rounded up
+uint32_t OffsetAllocator::binAtLeast(uint32_t size)
+{
+	if (size < SECOND_LEVELS)
+		return size;
+	uint32_t high = highestBit(size);
+	uint32_t step = (1u << (high - SECOND_LEVEL_BITS)) - 1;
+	// sizes near the top of the range would overflow, they land past the last bin and fail
+	if (size > 0xFFFFFFFFu - step)
+		return FIRST_LEVELS * SECOND_LEVELS;
+	return binOf(size + step);
+}
+
+uint32_t OffsetAllocator::newNode(uint32_t offset, uint32_t size, uint32_t previous, uint32_t next)
+{
+	Node value = { offset, size, previous, next, NONE, NONE, false };
+	if (!unusedNodes.empty())
+	{
+		uint32_t node = unusedNodes.back();
+		unusedNodes.pop_back();
+		nodes[node] = value;
+		return node;
+	}
+	nodes.push_back(value);
+	return (uint32_t)nodes.size() - 1;
+}
+
+void OffsetAllocator::insertFree(uint32_t node)
+{
+	uint32_t bin = binOf(nodes[node].size);
+	nodes[node].previousFree = NONE;
+	nodes[node].nextFree = bins[bin];
+	if (bins[bin] != NONE)
+		nodes[bins[bin]].previousFree = node;
+	bins[bin] = node;
+	firstLevelMap |= 1u << (bin / SECOND_LEVELS);
+	secondLevelMaps[bin / SECOND_LEVELS] |= 1u << (bin % SECOND_LEVELS);
+}
+
+void OffsetAllocator::removeFree(uint32_t node)
+{
+	uint32_t bin = binOf(nodes[node].size);
+	if (nodes[node].previousFree != NONE)
+		nodes[nodes[node].previousFree].nextFree = nodes[node].nextFree;
+	else
+		bins[bin] = nodes[node].nextFree;
+	if (nodes[node].nextFree != NONE)
+		nodes[nodes[node].nextFree].previousFree = nodes[node].previousFree;
+
+	if (bins[bin] == NONE)
+	{
+		secondLevelMaps[bin / SECOND_LEVELS] &= ~(1u << (bin % SECOND_LEVELS));
+		if (secondLevelMaps[bin / SECOND_LEVELS] == 0)
+			firstLevelMap &= ~(1u << (bin / SECOND_LEVELS));
+	}
+}
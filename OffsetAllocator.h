@@ -0,0 +1,69 @@
+#ifndef OFFSET_ALLOCATOR_CLASS_H
+#define OFFSET_ALLOCATOR_CLASS_H
+
+#include<cstdint>
+#include<vector>
+
+// Hands out ranges of a fixed size space, like vertices in a shared buffer, without touching the
+// memory itself. Free ranges sit in two level segregated fit bins (TLSF): the first level is the
+// power of two of the size and the second splits it into 8 linear steps, with a bitmap per level so
+// finding a big enough range is a couple of bit scans. Freed ranges merge with free neighbours
+class OffsetAllocator
+{
+public:
+	static constexpr uint32_t NO_SPACE = 0xFFFFFFFFu;
+
+	struct Allocation
+	{
+		uint32_t offset = NO_SPACE;
+		uint32_t node = NO_SPACE;
+	};
+
+	uint32_t capacity;
+	uint32_t freeSpace;
+
+	// Constructor for a space of capacity units
+	OffsetAllocator(uint32_t capacity);
+
+	// Returns a range of size units, offset is NO_SPACE when no free range is big enough
+	Allocation Allocate(uint32_t size);
+	// Gives a range back
+	void Free(Allocation allocation);
+	// Size of the biggest range Allocate could return right now
+	uint32_t LargestFree() const;
+
+private:
+	static const uint32_t SECOND_LEVEL_BITS = 3;
+	static const uint32_t SECOND_LEVELS = 1 << SECOND_LEVEL_BITS;
+	static const uint32_t FIRST_LEVELS = 32;
+	static constexpr uint32_t NONE = 0xFFFFFFFFu;
+
+	struct Node
+	{
+		uint32_t offset;
+		uint32_t size;
+		// neighbours in address order, for merging
+		uint32_t previous;
+		uint32_t next;
+		// neighbours in the same bin
+		uint32_t previousFree;
+		uint32_t nextFree;
+		bool used;
+	};
+
+	std::vector<Node> nodes;
+	std::vector<uint32_t> unusedNodes;
+	uint32_t firstLevelMap = 0;
+	uint32_t secondLevelMaps[FIRST_LEVELS] = {};
+	uint32_t bins[FIRST_LEVELS * SECOND_LEVELS];
+
+	// Bin of a free range, rounded down so every range in it is at least the bin size
+	static uint32_t binOf(uint32_t size);
+	// First bin whose every range is at least size, rounded up
+	static uint32_t binAtLeast(uint32_t size);
+	uint32_t newNode(uint32_t offset, uint32_t size, uint32_t previous, uint32_t next);
+	void insertFree(uint32_t node);
+	void removeFree(uint32_t node);
+};
+
+#endif
@@ -0,0 +1,131 @@
+#include"ProgramCache.h"
+
+#include<cstdio>
+#include<filesystem>
+#include<fstream>
+#include<iostream>
+#include<vector>
+
+#include"GLExtensions.h"
+#include"Hash.h"
+
+namespace
+{
+	// bumped whenever the file layout changes
+	const uint64_t CACHE_VERSION = 1;
+}
+
+bool ProgramCache::enabled = true;
+std::string ProgramCache::directory = "cache/shaders";
+unsigned ProgramCache::hits = 0;
+unsigned ProgramCache::misses = 0;
+unsigned ProgramCache::rejected = 0;
+
+// Key of a program built from these expanded sources and defines on the current driver
+uint64_t ProgramCache::Key(const std::string& vertexCode, const std::string& fragmentCode, const std::string& defines)
+{
+	uint64_t key = hash_bytes(&CACHE_VERSION, sizeof(CACHE_VERSION));
+	// the sizes go in too so moving text from one stage to the other changes the key
+	const std::string* parts[3] = { &vertexCode, &fragmentCode, &defines };
+	for (const std::string* part : parts)
+	{
+		uint64_t size = part->size();
+		key = hash_bytes(&size, sizeof(size), key);
+		key = hash_bytes(part->data(), part->size(), key);
+	}
+	// binaries are only valid for the driver that made them
+	GLenum driverStrings[3] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+	for (GLenum name : driverStrings)
+	{
+		const char* text = (const char*)glGetString(name);
+		if (text != NULL)
+			key = hash_bytes(text, std::char_traits<char>::length(text), key);
+	}
+	return key;
+}
+
+// Loads the stored binary into program, false when there is none or the driver refused it
+bool ProgramCache::Load(GLuint program, uint64_t key)
+{
+	if (!enabled || !GLExtensions::programBinary)
+		return false;
+
+	std::ifstream in(path(key), std::ios::binary);
+	GLenum format = 0;
+	std::vector<char> binary;
+	if (in && in.read((char*)&format, sizeof(format)))
+		binary.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	in.close();
+	if (binary.empty())
+	{
+		misses++;
+		return false;
+	}
+
+	GLExtensions::ProgramBinary(program, format, binary.data(), (GLsizei)binary.size());
+	GLint linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (linked == GL_FALSE)
+	{
+		// a different driver build can refuse it even with the same strings, compile and overwrite it
+		rejected++;
+		std::remove(path(key).c_str());
+		return false;
+	}
+	hits++;
+	return true;
+}
+
+// Call before linking so the driver keeps the binary around for Store
+void ProgramCache::PrepareLink(GLuint program)
+{
+	if (enabled && GLExtensions::programBinary)
+		GLExtensions::ProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+// Writes the binary of a successfully linked program
+void ProgramCache::Store(GLuint program, uint64_t key)
+{
+	if (!enabled || !GLExtensions::programBinary)
+		return;
+
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	GLsizei written = 0;
+	GLExtensions::GetProgramBinary(program, length, &written, &format, binary.data());
+	if (written <= 0)
+		return;
+
+	// written next to the final name and renamed, a crash never leaves half a binary behind
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+	std::string file = path(key);
+	std::string temporary = file + ".tmp";
+	{
+		std::ofstream out(temporary, std::ios::binary);
+		out.write((const char*)&format, sizeof(format));
+		out.write(binary.data(), written);
+		if (!out)
+		{
+			std::cout << "Failed to write " << temporary << std::endl;
+			return;
+		}
+	}
+	std::filesystem::rename(temporary, file, error);
+}
+
+// Removes every stored binary
+void ProgramCache::Clear()
+{
+	std::error_code error;
+	std::filesystem::remove_all(directory, error);
+}
+
+std::string ProgramCache::path(uint64_t key)
+{
+	return directory + "/" + hash_to_hex(key) + ".bin";
+}
@@ -0,0 +1,40 @@
+#ifndef PROGRAM_CACHE_CLASS_H
+#define PROGRAM_CACHE_CLASS_H
+
+#include<glad/glad.h>
+#include<cstdint>
+#include<string>
+
+// Keeps linked programs on disk as driver binaries so later launches skip compiling and linking.
+// Files are keyed by the shader sources, the defines and the driver strings, a driver update
+// changes the key and old files are simply never read again
+class ProgramCache
+{
+public:
+	// Switched off by --no-program-cache, for ruling out a driver that loads bad binaries. Drivers
+	// that cannot return binaries at all skip the cache whatever this says
+	static bool enabled;
+	// Where binaries are stored
+	static std::string directory;
+
+	// Programs loaded from disk, compiled because nothing was stored, and stored binaries the driver refused
+	static unsigned hits;
+	static unsigned misses;
+	static unsigned rejected;
+
+	// Key of a program built from these expanded sources and defines on the current driver
+	static uint64_t Key(const std::string& vertexCode, const std::string& fragmentCode, const std::string& defines);
+	// Loads the stored binary into program, false when there is none or the driver refused it
+	static bool Load(GLuint program, uint64_t key);
+	// Call before linking so the driver keeps the binary around for Store
+	static void PrepareLink(GLuint program);
+	// Writes the binary of a successfully linked program
+	static void Store(GLuint program, uint64_t key);
+	// Removes every stored binary
+	static void Clear();
+
+private:
+	static std::string path(uint64_t key);
+};
+
+#endif
@@ -0,0 +1,48 @@
+#include"RedrawTracker.h"
+
+#include<iostream>
+
+// Asks for a frame for the given reasons, from any thread
+void RedrawTracker::Invalidate(unsigned reasons)
+{
+	unsigned before = requested.fetch_or(reasons, std::memory_order_acq_rel);
+	// the first request wakes a main thread sleeping in WaitIdle, later ones find it awake
+	if (before == 0)
+		glfwPostEmptyEvent();
+}
+
+// Main thread: the reasons a frame was asked for since the last call
+unsigned RedrawTracker::Take()
+{
+	unsigned reasons = requested.exchange(0, std::memory_order_acq_rel);
+	if (reasons != 0)
+	{
+		framesRequested++;
+		for (int reason = 0; reason < REASON_COUNT; reason++)
+			if (reasons & (1u << reason))
+				framesFor[reason]++;
+	}
+	return reasons;
+}
+
+// Main thread: true when a frame was asked for and not taken yet
+bool RedrawTracker::Requested() const
+{
+	return requested.load(std::memory_order_acquire) != 0;
+}
+
+// Main thread: handles events until one arrives, Invalidate is called or idleTimeout passes
+void RedrawTracker::WaitIdle()
+{
+	double start = glfwGetTime();
+	glfwWaitEventsTimeout(idleTimeout);
+	idleSeconds += glfwGetTime() - start;
+	idleWaits++;
+}
+
+// Prints the stats
+void RedrawTracker::Print() const
+{
+	std::cout << "On demand: " << framesRequested << " frames asked for, " << framesFor[1] << " by the camera, " << framesFor[0] << " by input, "
+		<< framesFor[2] << " by the window, " << framesFor[3] << " by loading, idle " << idleSeconds << " s over " << idleWaits << " waits" << std::endl;
+}
@@ -0,0 +1,52 @@
+#ifndef REDRAW_TRACKER_CLASS_H
+#define REDRAW_TRACKER_CLASS_H
+
+#include<GLFW/glfw3.h>
+#include<atomic>
+
+// Decides whether the viewer draws at all. A model that nobody moves looks the same every frame, so
+// frames are only built when something asked for one: the camera or the section plane moved, the
+// window was resized, exposed, focused or restored (InputQueue reports those), or the render thread
+// still has textures, shader variants or evicted meshes coming in and needs more frames to finish
+// them. With nothing asked for, the main thread sleeps in glfwWaitEventsTimeout and the render thread
+// waits for a packet, so an idle viewer uses next to no CPU or GPU
+class RedrawTracker
+{
+public:
+	enum Reason
+	{
+		// a key toggled a view option or moved the section plane
+		INPUT = 1 << 0,
+		CAMERA = 1 << 1,
+		// the window was resized, needs repainting or changed focus or minimized state
+		WINDOW = 1 << 2,
+		// uploads, compiles or restores that finish over several frames
+		LOADING = 1 << 3,
+		REASON_COUNT = 4
+	};
+
+	// Longest idle wait, a safety net for a change nothing reported
+	double idleTimeout = 0.5;
+
+	// Stats
+	unsigned long long framesRequested = 0;
+	unsigned long long framesFor[REASON_COUNT] = {};
+	unsigned long long idleWaits = 0;
+	double idleSeconds = 0.0;
+
+	// Asks for a frame for the given reasons, from any thread. Wakes the main thread if it is idle
+	void Invalidate(unsigned reasons);
+	// Main thread: the reasons a frame was asked for since the last call, 0 when none was
+	unsigned Take();
+	// Main thread: true when a frame was asked for and not taken yet
+	bool Requested() const;
+	// Main thread: handles events until one arrives, Invalidate is called or idleTimeout passes
+	void WaitIdle();
+	// Prints the stats
+	void Print() const;
+
+private:
+	std::atomic<unsigned> requested{ 0 };
+};
+
+#endif
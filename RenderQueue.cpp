@@ -0,0 +1,140 @@
+#include"RenderQueue.h"
+
+#include<cstring>
+
+#include"GLState.h"
+#include"Hash.h"
+
+// Queues an indexed draw of count GL_UNSIGNED_INT indices starting at indexOffset bytes
+void RenderQueue::Submit(Pass pass, Shader& program, const RenderMaterial& material, VAO& vao, GLsizei count, GLintptr indexOffset, float depth)
+{
+	RenderPacket packet = { MakeKey(pass, program.ID, material.id, vao.ID, depth), &program, &material, vao.ID, count, indexOffset, NULL, NULL, NULL, 0.0f };
+	packets.push_back(packet);
+}
+
+// Queues a pool mesh at every transform, consecutive pool packets share a multi draw
+void RenderQueue::Submit(Pass pass, Shader& program, const RenderMaterial& material, GeometryPool& pool, const GeometryHandle& geometry, const std::vector<glm::mat4>& transforms, float depth, float atlasSlot)
+{
+	if (geometry.page >= pool.pages.size())
+		return;
+	GLuint vao = pool.pages[geometry.page]->vao.ID;
+	RenderPacket packet = { MakeKey(pass, program.ID, material.id, vao, depth), &program, &material, vao, 0, 0, &pool, &geometry, &transforms, atlasSlot };
+	packets.push_back(packet);
+}
+
+uint64_t RenderQueue::MakeKey(Pass pass, GLuint program, uint16_t material, GLuint vao, float depth)
+{
+	// positive floats order the same as their bits, the top 24 keep sign, exponent and 15 mantissa bits
+	uint32_t depthBits;
+	float clamped = depth > 0.0f ? depth : 0.0f;
+	std::memcpy(&depthBits, &clamped, sizeof(depthBits));
+	return ((uint64_t)(pass & 0xF) << 60)
+		| ((uint64_t)(program & 0x3FF) << 50)
+		| ((uint64_t)material << 34)
+		| ((uint64_t)(vao & 0x3FF) << 24)
+		| (uint64_t)(depthBits >> 8);
+}
+
+// Sorts and runs everything submitted since the last Execute
+void RenderQueue::Execute()
+{
+	items.resize(packets.size());
+	for (size_t i = 0; i < packets.size(); i++)
+		items[i] = SortItem{ packets[i].key, (uint32_t)i };
+	stateChangesSubmitted = countStateChanges(items);
+	radixSort();
+	stateChangesSorted = countStateChanges(items);
+	packetCount = (unsigned)packets.size();
+
+	Shader* program = NULL;
+	const RenderMaterial* material = NULL;
+	GeometryPool* pendingPool = NULL;
+	for (SortItem& item : items)
+	{
+		RenderPacket& packet = packets[item.packet];
+
+		// pool draws pile up until the program, material or kind of draw changes
+		if (pendingPool != NULL && (packet.pool != pendingPool || packet.program != program || packet.material != material))
+		{
+			pendingPool->Flush();
+			pendingPool = NULL;
+		}
+
+		if (packet.program != program)
+		{
+			program = packet.program;
+			program->Activate();
+			material = NULL;
+		}
+		if (packet.material != material)
+		{
+			material = packet.material;
+			if (material->texture != NULL)
+				material->texture->Bind();
+			if (material->atlas != NULL)
+				material->atlas->Bind(material->atlasPage);
+			program->SetInt(program->Uniform(hash_string("flatColor")), material->flatColor);
+			program->SetVec4(program->Uniform(hash_string("clipPlane")), material->clipPlane);
+		}
+
+		if (packet.pool != NULL)
+		{
+			packet.pool->Draw(*packet.geometry, *packet.transforms, packet.atlasSlot);
+			pendingPool = packet.pool;
+		}
+		else
+		{
+			GLState::BindVertexArray(packet.vao);
+			glDrawElements(GL_TRIANGLES, packet.count, GL_UNSIGNED_INT, (void*)packet.indexOffset);
+		}
+	}
+	if (pendingPool != NULL)
+		pendingPool->Flush();
+
+	packets.clear();
+}
+
+// Sorts items by key, one counting pass per byte, bytes every key shares are skipped
+void RenderQueue::radixSort()
+{
+	scratch.resize(items.size());
+	for (int shift = 0; shift < 64; shift += 8)
+	{
+		size_t counts[256] = {};
+		for (SortItem& item : items)
+			counts[(item.key >> shift) & 0xFF]++;
+		if (items.empty() || counts[(items[0].key >> shift) & 0xFF] == items.size())
+			continue;
+
+		size_t offset = 0;
+		for (size_t& count : counts)
+		{
+			size_t next = offset + count;
+			count = offset;
+			offset = next;
+		}
+		// stable, so the lower bytes sorted by earlier passes keep their order
+		for (SortItem& item : items)
+			scratch[counts[(item.key >> shift) & 0xFF]++] = item;
+		items.swap(scratch);
+	}
+}
+
+// Number of program, material and VAO changes running packets in this order would cost
+unsigned RenderQueue::countStateChanges(const std::vector<SortItem>& order) const
+{
+	unsigned changes = 0;
+	const RenderPacket* previous = NULL;
+	for (const SortItem& item : order)
+	{
+		const RenderPacket& packet = packets[item.packet];
+		if (previous == NULL || packet.program != previous->program)
+			changes++;
+		if (previous == NULL || packet.material != previous->material)
+			changes++;
+		if (previous == NULL || packet.vao != previous->vao)
+			changes++;
+		previous = &packet;
+	}
+	return changes;
+}
@@ -0,0 +1,88 @@
+#ifndef RENDER_QUEUE_CLASS_H
+#define RENDER_QUEUE_CLASS_H
+
+#include<glad/glad.h>
+#include<glm/glm.hpp>
+#include<cstdint>
+#include<vector>
+
+#include"GeometryPool.h"
+#include"Texture.h"
+#include"TextureAtlas.h"
+#include"shaderClass.h"
+
+// What a draw needs besides its geometry, uploaded only when consecutive packets use different materials
+struct RenderMaterial
+{
+	// Small number that orders materials in the sort key
+	uint16_t id = 0;
+	// Bound to the active unit, NULL leaves the texture alone
+	Texture* texture = NULL;
+	// Page bound for draws that read their texture from an atlas slot, NULL leaves it alone
+	TextureAtlas* atlas = NULL;
+	int atlasPage = 0;
+	bool flatColor = false;
+	glm::vec4 clipPlane = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+};
+
+// One draw: either an indexed draw of a VAO, or a pool mesh drawn at every one of its transforms
+struct RenderPacket
+{
+	uint64_t key;
+	Shader* program;
+	const RenderMaterial* material;
+	GLuint vao;
+	GLsizei count;
+	GLintptr indexOffset;
+	GeometryPool* pool;
+	const GeometryHandle* geometry;
+	const std::vector<glm::mat4>* transforms;
+	float atlasSlot;
+};
+
+// Collects the draws of a frame and runs them sorted by a 64 bit key so draws sharing a program,
+// material and VAO end up next to each other. From the most significant bits down the key holds
+// pass (4 bits), program (10), material (16), VAO (10) and depth (24), so inside a state group
+// opaque draws go front to back. Keys are sorted with an LSD radix sort
+class RenderQueue
+{
+public:
+	enum Pass
+	{
+		OPAQUE_PASS = 0,
+		// drawn after every opaque draw, like the section caps that sit on the clip plane
+		OVERLAY_PASS = 1
+	};
+
+	// State changes of the last Execute in submission order and in sorted order
+	unsigned stateChangesSubmitted = 0;
+	unsigned stateChangesSorted = 0;
+	unsigned packetCount = 0;
+
+	// Queues an indexed draw of count GL_UNSIGNED_INT indices starting at indexOffset bytes
+	void Submit(Pass pass, Shader& program, const RenderMaterial& material, VAO& vao, GLsizei count, GLintptr indexOffset, float depth);
+	// Queues a pool mesh at every transform, consecutive pool packets share a multi draw.
+	// Meshes with different atlas slots of one page still share it
+	void Submit(Pass pass, Shader& program, const RenderMaterial& material, GeometryPool& pool, const GeometryHandle& geometry, const std::vector<glm::mat4>& transforms, float depth, float atlasSlot = 0.0f);
+	// Sorts and runs everything submitted since the last Execute
+	void Execute();
+
+	static uint64_t MakeKey(Pass pass, GLuint program, uint16_t material, GLuint vao, float depth);
+
+private:
+	struct SortItem
+	{
+		uint64_t key;
+		uint32_t packet;
+	};
+	std::vector<RenderPacket> packets;
+	std::vector<SortItem> items;
+	std::vector<SortItem> scratch;
+
+	// Sorts items by key, one counting pass per byte, bytes every key shares are skipped
+	void radixSort();
+	// Number of program, material and VAO changes running packets in this order would cost
+	unsigned countStateChanges(const std::vector<SortItem>& order) const;
+};
+
+#endif
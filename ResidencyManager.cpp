@@ -0,0 +1,208 @@
+#include"ResidencyManager.h"
+
+#include<algorithm>
+#include<chrono>
+#include<iostream>
+
+// Starts tracking a resource that is resident now
+ResidencyManager::Handle ResidencyManager::Track(const std::string& label, size_t bytes, std::function<void()> evict, std::function<bool()> restore)
+{
+	// loading a large assembly evicts the parts loaded before it that nothing has drawn yet,
+	// so the upload never runs far past the budget
+	makeRoom(bytes);
+
+	Handle handle;
+	if (!freeHandles.empty())
+	{
+		handle = freeHandles.back();
+		freeHandles.pop_back();
+	}
+	else
+	{
+		handle = (Handle)entries.size();
+		entries.emplace_back();
+	}
+	Entry& entry = entries[handle];
+	entry.label = label;
+	entry.bytes = bytes;
+	entry.state = RESIDENT;
+	// never drawn yet, so the first to go when the budget is tight
+	entry.lastUsed = 0;
+	entry.queued = false;
+	entry.evict = std::move(evict);
+	entry.restore = std::move(restore);
+	entry.position = lru.insert(lru.begin(), handle);
+	residentBytes += bytes;
+	peakResidentBytes = std::max(peakResidentBytes, residentBytes);
+	return handle;
+}
+
+// Stops tracking, the owner frees the resource itself
+void ResidencyManager::Untrack(Handle handle)
+{
+	if (handle >= entries.size() || entries[handle].state == UNTRACKED)
+		return;
+	Entry& entry = entries[handle];
+	if (entry.state != EVICTED)
+	{
+		lru.erase(entry.position);
+		residentBytes -= entry.bytes;
+	}
+	// a queued restore finds the entry untracked and is dropped, the handle is reused after that
+	entry.state = UNTRACKED;
+	entry.evict = nullptr;
+	entry.restore = nullptr;
+	if (!entry.queued)
+		freeHandles.push_back(handle);
+}
+
+// Marks a resource as drawn this frame, false when it is not resident
+bool ResidencyManager::Use(Handle handle)
+{
+	if (handle >= entries.size())
+		return true;
+	Entry& entry = entries[handle];
+	switch (entry.state)
+	{
+	case RESIDENT:
+		entry.lastUsed = frame;
+		lru.splice(lru.end(), lru, entry.position);
+		return true;
+	case EVICTED:
+		entry.lastUsed = frame;
+		if (!entry.queued)
+		{
+			entry.queued = true;
+			restoreQueue.push_back(handle);
+		}
+		return false;
+	case RESTORING:
+		entry.lastUsed = frame;
+		lru.splice(lru.end(), lru, entry.position);
+		return false;
+	default:
+		return false;
+	}
+}
+
+// Reports that a restore which returned false has finished
+void ResidencyManager::Restored(Handle handle)
+{
+	if (handle < entries.size() && entries[handle].state == RESTORING)
+		entries[handle].state = RESIDENT;
+}
+
+// Evicts down to the budget and restores what was asked for, call once at the end of every frame
+void ResidencyManager::Update()
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// resources tracked or grown since the last frame may have pushed past the budget
+	makeRoom(0);
+
+	size_t restoredBytes = 0;
+	blocked = false;
+	while (!restoreQueue.empty())
+	{
+		Handle handle = restoreQueue.front();
+		Entry& entry = entries[handle];
+		// untracked meanwhile, or nothing drew it this frame so it is not wanted any more
+		if (entry.state != EVICTED || entry.lastUsed < frame)
+		{
+			restoreQueue.pop_front();
+			entry.queued = false;
+			if (entry.state == UNTRACKED)
+				freeHandles.push_back(handle);
+			continue;
+		}
+		if (restoredBytes > 0 && restoredBytes + entry.bytes > bytesPerFrame)
+			break;
+		if (restoredBytes > 0 && std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() > millisecondsPerFrame)
+			break;
+		// everything resident was drawn this frame, the rest waits until the view changes
+		if (!makeRoom(entry.bytes))
+		{
+			blocked = true;
+			break;
+		}
+		restoreQueue.pop_front();
+		entry.queued = false;
+		entry.state = RESTORING;
+		entry.position = lru.insert(lru.end(), handle);
+		residentBytes += entry.bytes;
+		restoredBytes += entry.bytes;
+		restores++;
+		bytesRestored += entry.bytes;
+		if (entry.restore())
+			entry.state = RESIDENT;
+	}
+	if (blocked)
+		overBudgetFrames++;
+
+	peakResidentBytes = std::max(peakResidentBytes, residentBytes);
+	frame++;
+}
+
+// Tracked resources
+size_t ResidencyManager::Count() const
+{
+	return entries.size() - freeHandles.size();
+}
+
+// Resources resident or on their way back
+size_t ResidencyManager::ResidentCount() const
+{
+	return lru.size();
+}
+
+// True while restores are queued or uploading
+bool ResidencyManager::Restoring() const
+{
+	// a view that needs room the budget does not have waits for the view to change, which asks for frames itself
+	if (!restoreQueue.empty() && !blocked)
+		return true;
+	for (const Entry& entry : entries)
+		if (entry.state == RESTORING)
+			return true;
+	return false;
+}
+
+// Prints the stats
+void ResidencyManager::Print() const
+{
+	std::cout << "Residency: " << ResidentCount() << " of " << Count() << " resources, " << residentBytes / 1048576.0 << " MB resident (peak " << peakResidentBytes / 1048576.0 << " MB";
+	if (budget > 0)
+		std::cout << ", budget " << budget / 1048576.0 << " MB";
+	std::cout << "), " << evictions << " evictions (" << bytesEvicted / 1048576.0 << " MB), " << restores << " restores (" << bytesRestored / 1048576.0 << " MB), " << overBudgetFrames << " frames waiting on the budget" << std::endl;
+}
+
+// Evicts least recently used entries not drawn this frame until bytes more fit
+bool ResidencyManager::makeRoom(size_t bytes)
+{
+	if (budget == 0)
+		return true;
+	// restoring entries are mid upload and drawn ones are needed now, both are passed over
+	std::list<Handle>::iterator next = lru.begin();
+	while (residentBytes + bytes > budget && next != lru.end())
+	{
+		Handle handle = *next++;
+		Entry& entry = entries[handle];
+		// the list is in use order, from here on everything was drawn this frame
+		if (entry.lastUsed >= frame)
+			break;
+		if (entry.state == RESIDENT)
+			evict(handle);
+	}
+	return residentBytes + bytes <= budget;
+}
+
+void ResidencyManager::evict(Handle handle)
+{
+	Entry& entry = entries[handle];
+	entry.evict();
+	entry.state = EVICTED;
+	lru.erase(entry.position);
+	residentBytes -= entry.bytes;
+	evictions++;
+	bytesEvicted += entry.bytes;
+}
@@ -0,0 +1,97 @@
+#ifndef RESIDENCY_MANAGER_CLASS_H
+#define RESIDENCY_MANAGER_CLASS_H
+
+#include<cstdint>
+#include<deque>
+#include<functional>
+#include<list>
+#include<string>
+#include<vector>
+
+// Keeps the GPU memory of meshes and textures under a budget. Every resource is tracked with its
+// byte size and a pair of callbacks: evict frees the GPU copy, restore uploads it again from the
+// copy the owner keeps on the CPU (or on disk). Draws report what they use, and at the end of the
+// frame the least recently drawn resources are evicted until the rest fits. A draw that finds its
+// resource evicted is skipped, and the resource is restored over the next frames within a byte and
+// time budget. Nothing here touches GL, so the whole policy runs without a GPU
+class ResidencyManager
+{
+public:
+	typedef uint32_t Handle;
+	static constexpr Handle NONE = 0xFFFFFFFFu;
+
+	// Bytes resident resources may take, 0 for no limit
+	size_t budget = 0;
+	// Bytes restored per Update, and time after which Update stops early. At least one restore
+	// always goes through, so a resource larger than the per frame budget still comes back
+	size_t bytesPerFrame = 8 << 20;
+	double millisecondsPerFrame = 2.0;
+
+	// Stats
+	size_t residentBytes = 0;
+	size_t peakResidentBytes = 0;
+	unsigned long long evictions = 0;
+	unsigned long long restores = 0;
+	unsigned long long bytesEvicted = 0;
+	unsigned long long bytesRestored = 0;
+	// Frames that ended with restores waiting because everything resident was drawn in them
+	unsigned long long overBudgetFrames = 0;
+
+	// Starts tracking a resource that is resident now. restore returns true when the resource is
+	// back right away, false when its owner calls Restored once an upload over later frames is done
+	Handle Track(const std::string& label, size_t bytes, std::function<void()> evict, std::function<bool()> restore);
+	// Stops tracking, the owner frees the resource itself
+	void Untrack(Handle handle);
+	// Marks a resource as drawn this frame, false when it is not resident and the draw has to be skipped
+	bool Use(Handle handle);
+	// Reports that a restore which returned false has finished
+	void Restored(Handle handle);
+	// Evicts down to the budget and restores what was asked for, call once at the end of every frame
+	void Update();
+
+	// Tracked resources and how many of them are resident
+	size_t Count() const;
+	size_t ResidentCount() const;
+	// True while restores are queued or uploading, they only go through on frames that draw. Restores
+	// waiting on a full budget do not count, more frames of the same view would not make room
+	bool Restoring() const;
+	// Prints the stats
+	void Print() const;
+
+private:
+	enum State
+	{
+		RESIDENT,
+		RESTORING,
+		EVICTED,
+		// free handle
+		UNTRACKED
+	};
+	struct Entry
+	{
+		std::string label;
+		size_t bytes;
+		State state;
+		unsigned long long lastUsed;
+		bool queued;
+		std::function<void()> evict;
+		std::function<bool()> restore;
+		// place in lru while resident or restoring
+		std::list<Handle>::iterator position;
+	};
+	std::vector<Entry> entries;
+	std::vector<Handle> freeHandles;
+	// resident and restoring entries, least recently used first
+	std::list<Handle> lru;
+	std::deque<Handle> restoreQueue;
+	// starts at 1, lastUsed 0 means never drawn
+	unsigned long long frame = 1;
+	// the last Update left restores waiting because everything resident was drawn
+	bool blocked = false;
+
+	// Evicts least recently used entries not drawn this frame until bytes more fit, false when they cannot
+	bool makeRoom(size_t bytes);
+	void evict(Handle handle);
+};
+
+#endif
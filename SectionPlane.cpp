@@ -0,0 +1,532 @@
+#include"SectionPlane.h"
+
+#include<algorithm>
+#include<chrono>
+#include<cmath>
+#include<cstdint>
+#include<limits>
+
+namespace
+{
+	const GLuint NONE = 0xFFFFFFFFu;
+
+	// Twice the signed area of the triangle, positive when a, b, c turn counter clockwise
+	double cross2(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c)
+	{
+		return ((double)b.x - a.x) * ((double)c.y - a.y) - ((double)b.y - a.y) * ((double)c.x - a.x);
+	}
+
+	bool inTriangle(const glm::vec2& p, const glm::vec2& a, const glm::vec2& b, const glm::vec2& c)
+	{
+		return cross2(a, b, p) >= 0.0 && cross2(b, c, p) >= 0.0 && cross2(c, a, p) >= 0.0;
+	}
+
+	float signedArea(const std::vector<glm::vec2>& pts, const std::vector<GLuint>& loop)
+	{
+		float area = 0.0f;
+		for (size_t i = 0, j = loop.size() - 1; i < loop.size(); j = i++)
+			area += (pts[loop[j]].x - pts[loop[i]].x) * (pts[loop[j]].y + pts[loop[i]].y);
+		return area * 0.5f;
+	}
+
+	bool inPolygon(const std::vector<glm::vec2>& pts, const std::vector<GLuint>& loop, const glm::vec2& p)
+	{
+		bool inside = false;
+		for (size_t i = 0, j = loop.size() - 1; i < loop.size(); j = i++)
+		{
+			const glm::vec2& a = pts[loop[i]];
+			const glm::vec2& b = pts[loop[j]];
+			if ((a.y > p.y) != (b.y > p.y) && p.x < (b.x - a.x) * (p.y - a.y) / (b.y - a.y) + a.x)
+				inside = !inside;
+		}
+		return inside;
+	}
+
+	// Joins a clockwise hole into a counter clockwise outer loop through a bridge from the
+	// rightmost hole vertex to a visible outer vertex (Eberly, "Triangulation by Ear Clipping")
+	void bridgeHole(const std::vector<glm::vec2>& pts, std::vector<GLuint>& outer, const std::vector<GLuint>& hole)
+	{
+		size_t m = 0;
+		for (size_t i = 1; i < hole.size(); i++)
+			if (pts[hole[i]].x > pts[hole[m]].x)
+				m = i;
+		glm::vec2 M = pts[hole[m]];
+
+		// closest outer edge hit by a ray from M towards +x
+		float bestX = std::numeric_limits<float>::max();
+		size_t bestEdge = NONE;
+		for (size_t i = 0; i < outer.size(); i++)
+		{
+			const glm::vec2& a = pts[outer[i]];
+			const glm::vec2& b = pts[outer[(i + 1) % outer.size()]];
+			if (a.y == b.y || (a.y > M.y) == (b.y > M.y))
+				continue;
+			float x = a.x + (M.y - a.y) * (b.x - a.x) / (b.y - a.y);
+			if (x >= M.x && x < bestX)
+			{
+				bestX = x;
+				bestEdge = i;
+			}
+		}
+		if (bestEdge == NONE)
+			return;
+
+		size_t candidate = pts[outer[bestEdge]].x > pts[outer[(bestEdge + 1) % outer.size()]].x ? bestEdge : (bestEdge + 1) % outer.size();
+		glm::vec2 I(bestX, M.y);
+		glm::vec2 P = pts[outer[candidate]];
+
+		// an outer vertex inside the triangle M, I, P would block the bridge, take the one closest in angle instead
+		float bestAngle = std::numeric_limits<float>::max();
+		for (size_t i = 0; i < outer.size(); i++)
+		{
+			const glm::vec2& q = pts[outer[i]];
+			if (i == candidate || q.x < M.x || q == P)
+				continue;
+			bool inside = cross2(M, I, P) >= 0.0 ? inTriangle(q, M, I, P) : inTriangle(q, M, P, I);
+			if (!inside)
+				continue;
+			float angle = std::atan2(std::fabs(q.y - M.y), q.x - M.x);
+			if (angle < bestAngle)
+			{
+				bestAngle = angle;
+				candidate = i;
+			}
+		}
+
+		std::vector<GLuint> merged;
+		merged.reserve(outer.size() + hole.size() + 2);
+		merged.insert(merged.end(), outer.begin(), outer.begin() + candidate + 1);
+		for (size_t i = 0; i <= hole.size(); i++)
+			merged.push_back(hole[(m + i) % hole.size()]);
+		merged.insert(merged.end(), outer.begin() + candidate, outer.end());
+		outer.swap(merged);
+	}
+
+	// Ear clips a counter clockwise polygon, the ear test only looks at nearby reflex vertices
+	// instead of the whole polygon
+	void earClip(const std::vector<glm::vec2>& pts, const std::vector<GLuint>& poly, std::vector<GLuint>& out)
+	{
+		size_t n = poly.size();
+		if (n < 3)
+			return;
+
+		std::vector<size_t> prev(n), next(n);
+		std::vector<char> reflex(n, 0), removed(n, 0);
+		for (size_t i = 0; i < n; i++)
+		{
+			prev[i] = (i + n - 1) % n;
+			next[i] = (i + 1) % n;
+		}
+
+		for (size_t i = 0; i < n; i++)
+			reflex[i] = cross2(pts[poly[prev[i]]], pts[poly[i]], pts[poly[next[i]]]) <= 0.0;
+
+		// reflex vertices sorted along a Morton curve, an ear only scans the curve range between the
+		// corners of its bounding box, which stays local even where the cut points cluster
+		glm::vec2 lo, scale;
+		std::vector<uint64_t> curve;
+		auto mortonOf = [&](const glm::vec2& p)
+		{
+			glm::vec2 q = glm::clamp((p - lo) * scale, glm::vec2(0.0f), glm::vec2(65535.0f));
+			uint32_t x = (uint32_t)q.x, y = (uint32_t)q.y;
+			x = (x | (x << 8)) & 0x00FF00FFu; x = (x | (x << 4)) & 0x0F0F0F0Fu; x = (x | (x << 2)) & 0x33333333u; x = (x | (x << 1)) & 0x55555555u;
+			y = (y | (y << 8)) & 0x00FF00FFu; y = (y | (y << 4)) & 0x0F0F0F0Fu; y = (y | (y << 2)) & 0x33333333u; y = (y | (y << 1)) & 0x55555555u;
+			return x | (y << 1);
+		};
+		// rebuilt from the live vertices whenever the polygon has halved so late ears do not
+		// wade through entries that were clipped or stopped being reflex
+		size_t curveBuiltAt = 0;
+		auto buildCurve = [&](size_t start, size_t count)
+		{
+			glm::vec2 hi(-std::numeric_limits<float>::max());
+			lo = glm::vec2(std::numeric_limits<float>::max());
+			size_t i = start;
+			for (size_t k = 0; k < count; k++, i = next[i])
+			{
+				lo = glm::min(lo, pts[poly[i]]);
+				hi = glm::max(hi, pts[poly[i]]);
+			}
+			scale = 65535.0f / glm::max(hi - lo, glm::vec2(1e-12f));
+			curve.clear();
+			for (size_t k = 0; k < count; k++, i = next[i])
+				if (reflex[i])
+					curve.push_back(((uint64_t)mortonOf(pts[poly[i]]) << 32) | i);
+			std::sort(curve.begin(), curve.end());
+			curveBuiltAt = count;
+		};
+		buildCurve(0, n);
+
+		auto isEar = [&](size_t i)
+		{
+			const glm::vec2& a = pts[poly[prev[i]]];
+			const glm::vec2& b = pts[poly[i]];
+			const glm::vec2& c = pts[poly[next[i]]];
+			if (cross2(a, b, c) <= 0.0)
+				return false;
+			glm::vec2 boxLo = glm::min(a, glm::min(b, c));
+			glm::vec2 boxHi = glm::max(a, glm::max(b, c));
+			uint64_t first = (uint64_t)mortonOf(boxLo) << 32;
+			uint64_t last = ((uint64_t)mortonOf(boxHi) << 32) | 0xFFFFFFFFu;
+			for (auto it = std::lower_bound(curve.begin(), curve.end(), first); it != curve.end() && *it <= last; ++it)
+			{
+				size_t j = (size_t)(*it & 0xFFFFFFFFu);
+				if (removed[j] || !reflex[j] || j == prev[i] || j == i || j == next[i])
+					continue;
+				const glm::vec2& p = pts[poly[j]];
+				if (p.x < boxLo.x || p.y < boxLo.y || p.x > boxHi.x || p.y > boxHi.y)
+					continue;
+				if (p == a || p == b || p == c)
+					continue;
+				if (inTriangle(p, a, b, c))
+					return false;
+			}
+			return true;
+		};
+		auto clip = [&](size_t i, bool emit)
+		{
+			if (emit)
+			{
+				out.push_back(poly[prev[i]]);
+				out.push_back(poly[i]);
+				out.push_back(poly[next[i]]);
+			}
+			removed[i] = 1;
+			next[prev[i]] = next[i];
+			prev[next[i]] = prev[i];
+			// clipping an ear can only make its neighbours more convex
+			size_t p = prev[i], q = next[i];
+			if (reflex[p] && cross2(pts[poly[prev[p]]], pts[poly[p]], pts[poly[next[p]]]) > 0.0)
+				reflex[p] = 0;
+			if (reflex[q] && cross2(pts[poly[prev[q]]], pts[poly[q]], pts[poly[next[q]]]) > 0.0)
+				reflex[q] = 0;
+		};
+
+		size_t remaining = n;
+		size_t cur = 0;
+		size_t stop = cur;
+		while (remaining > 3)
+		{
+			if (remaining * 2 < curveBuiltAt)
+				buildCurve(cur, remaining);
+
+			// collinear vertices add nothing to the triangulation and only slow the ear search down
+			bool collinear = cross2(pts[poly[prev[cur]]], pts[poly[cur]], pts[poly[next[cur]]]) == 0.0;
+			if (collinear || isEar(cur))
+			{
+				// skipping a vertex after each ear avoids fanning around one vertex, fans make ever larger
+				// triangles that cover most of the grid
+				size_t after = next[next[cur]];
+				clip(cur, !collinear);
+				remaining--;
+				cur = stop = after;
+			}
+			else
+			{
+				cur = next[cur];
+				if (cur == stop)
+				{
+					// no ear left means the input is degenerate or self touching, drop a vertex so we always finish
+					size_t after = next[cur];
+					clip(cur, cross2(pts[poly[prev[cur]]], pts[poly[cur]], pts[poly[next[cur]]]) > 0.0);
+					remaining--;
+					cur = stop = after;
+				}
+			}
+		}
+		if (cross2(pts[poly[prev[cur]]], pts[poly[cur]], pts[poly[next[cur]]]) > 0.0)
+		{
+			out.push_back(poly[prev[cur]]);
+			out.push_back(poly[cur]);
+			out.push_back(poly[next[cur]]);
+		}
+	}
+}
+
+// Constructor that copies the positions out of interleaved vertices (stride in floats)
+SectionPlane::SectionPlane(const GLfloat* vertices, size_t vertexCount, size_t stride, const GLuint* indices, size_t indexCount, glm::vec3 normal)
+	: triangles(indices, indices + indexCount), topology(indices, indexCount)
+{
+	positions.resize(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++)
+		positions[i] = glm::vec3(vertices[i * stride], vertices[i * stride + 1], vertices[i * stride + 2]);
+
+	edgeStamp.assign(topology.edgeCount, 0);
+	edgePoint.resize(topology.edgeCount);
+	edgeSegment.resize(topology.edgeCount * 2);
+
+	SetNormal(normal);
+}
+
+// Changes the plane direction, this rebuilds the slab index so it is slower than a Cut
+void SectionPlane::SetNormal(glm::vec3 normal)
+{
+	Normal = glm::normalize(normal);
+	buildSlabs();
+	Offset = glm::clamp(Offset, minOffset, maxOffset);
+}
+
+// Buckets every triangle into the slabs it overlaps
+void SectionPlane::buildSlabs()
+{
+	size_t triangleCount = topology.triangleCount;
+
+	minOffset = std::numeric_limits<float>::max();
+	maxOffset = -std::numeric_limits<float>::max();
+	distances.resize(positions.size());
+	for (size_t i = 0; i < positions.size(); i++)
+	{
+		distances[i] = glm::dot(Normal, positions[i]);
+		minOffset = std::min(minOffset, distances[i]);
+		maxOffset = std::max(maxOffset, distances[i]);
+	}
+	if (positions.empty())
+		minOffset = maxOffset = 0.0f;
+
+	// slabs about as thick as an average triangle keep the duplicates low, but never fewer than
+	// a few hundred triangles per slab so the index stays small on coarse meshes
+	double extent = 0.0;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		float d0 = distances[triangles[t * 3]], d1 = distances[triangles[t * 3 + 1]], d2 = distances[triangles[t * 3 + 2]];
+		extent += std::max(d0, std::max(d1, d2)) - std::min(d0, std::min(d1, d2));
+	}
+	float range = maxOffset - minOffset;
+	float averageExtent = triangleCount ? (float)(extent / triangleCount) : range;
+	size_t slabCount = std::max<size_t>(1, triangleCount / 256);
+	if (averageExtent > 0.0f)
+		slabCount = std::min(slabCount, (size_t)std::ceil(range / averageExtent));
+	slabCount = std::max<size_t>(1, slabCount);
+	slabOrigin = minOffset;
+	slabWidth = std::max(range / (float)slabCount, 1e-12f);
+
+	auto slabOf = [this, slabCount](float d)
+	{
+		float s = std::floor((d - slabOrigin) / slabWidth);
+		return (size_t)glm::clamp(s, 0.0f, (float)(slabCount - 1));
+	};
+
+	// counting pass followed by a fill pass gives a compact list per slab
+	slabStart.assign(slabCount + 1, 0);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		float d0 = distances[triangles[t * 3]], d1 = distances[triangles[t * 3 + 1]], d2 = distances[triangles[t * 3 + 2]];
+		size_t first = slabOf(std::min(d0, std::min(d1, d2)));
+		size_t last = slabOf(std::max(d0, std::max(d1, d2)));
+		for (size_t s = first; s <= last; s++)
+			slabStart[s + 1]++;
+	}
+	for (size_t s = 0; s < slabCount; s++)
+		slabStart[s + 1] += slabStart[s];
+
+	slabTriangles.resize(slabStart[slabCount]);
+	std::vector<GLuint> fill(slabStart.begin(), slabStart.end() - 1);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		float d0 = distances[triangles[t * 3]], d1 = distances[triangles[t * 3 + 1]], d2 = distances[triangles[t * 3 + 2]];
+		size_t first = slabOf(std::min(d0, std::min(d1, d2)));
+		size_t last = slabOf(std::max(d0, std::max(d1, d2)));
+		for (size_t s = first; s <= last; s++)
+			slabTriangles[fill[s]++] = (GLuint)t;
+	}
+}
+
+// Moves the plane to the offset and regenerates the cap geometry
+void SectionPlane::Cut(float offset)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	Offset = offset;
+	capVertices.clear();
+	capIndices.clear();
+
+	if (++stamp == 0)
+	{
+		std::fill(edgeStamp.begin(), edgeStamp.end(), 0);
+		stamp = 1;
+	}
+
+	// each crossed triangle gives one segment between the two edges it crosses, segments are linked
+	// through their edges rather than by direction so meshes with inconsistent winding still close
+	std::vector<glm::vec3> points;
+	std::vector<GLuint> segmentEdges;
+
+	auto pointOnEdge = [&](GLuint edge)
+	{
+		if (edgeStamp[edge] != stamp)
+		{
+			// always interpolate from the smaller vertex index so both triangles on an edge agree exactly
+			const glm::vec3& a = positions[topology.edgeVertices[edge * 2]];
+			const glm::vec3& b = positions[topology.edgeVertices[edge * 2 + 1]];
+			float da = distances[topology.edgeVertices[edge * 2]] - Offset;
+			float db = distances[topology.edgeVertices[edge * 2 + 1]] - Offset;
+			float t = (da == db) ? 0.0f : da / (da - db);
+			edgeStamp[edge] = stamp;
+			edgePoint[edge] = (GLuint)points.size();
+			edgeSegment[edge * 2] = NONE;
+			edgeSegment[edge * 2 + 1] = NONE;
+			points.push_back(a + glm::clamp(t, 0.0f, 1.0f) * (b - a));
+		}
+		return edgePoint[edge];
+	};
+	auto attach = [&](GLuint edge, GLuint segment)
+	{
+		if (edgeSegment[edge * 2] == NONE)
+			edgeSegment[edge * 2] = segment;
+		else
+			edgeSegment[edge * 2 + 1] = segment;
+	};
+
+	if (offset >= minOffset && offset <= maxOffset && !slabStart.empty())
+	{
+		size_t slabCount = slabStart.size() - 1;
+		float s = std::floor((offset - slabOrigin) / slabWidth);
+		size_t slab = (size_t)glm::clamp(s, 0.0f, (float)(slabCount - 1));
+
+		for (GLuint i = slabStart[slab]; i < slabStart[slab + 1]; i++)
+		{
+			GLuint t = slabTriangles[i];
+			// vertices exactly on the plane count as kept so a triangle crosses exactly zero or two edges
+			bool kept[3];
+			for (int k = 0; k < 3; k++)
+				kept[k] = distances[triangles[t * 3 + k]] >= offset;
+			if (kept[0] == kept[1] && kept[1] == kept[2])
+				continue;
+
+			GLuint segment = (GLuint)(segmentEdges.size() / 2);
+			for (int k = 0; k < 3; k++)
+			{
+				if (kept[k] == kept[(k + 1) % 3])
+					continue;
+				GLuint edge = topology.triangleEdges[t * 3 + k];
+				pointOnEdge(edge);
+				attach(edge, segment);
+				segmentEdges.push_back(edge);
+			}
+		}
+	}
+
+	// walk the segments into closed loops, open chains come from holes in the mesh and are dropped
+	std::vector<std::vector<GLuint>> loops;
+	size_t segmentCount = segmentEdges.size() / 2;
+	std::vector<char> visited(segmentCount, 0);
+	for (GLuint first = 0; first < segmentCount; first++)
+	{
+		if (visited[first])
+			continue;
+		visited[first] = 1;
+
+		GLuint startEdge = segmentEdges[first * 2];
+		GLuint edge = segmentEdges[first * 2 + 1];
+		GLuint seg = first;
+		std::vector<GLuint> loop(1, edgePoint[startEdge]);
+		bool closed = false;
+		while (true)
+		{
+			if (edge == startEdge)
+			{
+				closed = true;
+				break;
+			}
+			GLuint p = edgePoint[edge];
+			if (points[loop.back()] != points[p])
+				loop.push_back(p);
+
+			GLuint nextSeg = edgeSegment[edge * 2] == seg ? edgeSegment[edge * 2 + 1] : edgeSegment[edge * 2];
+			if (nextSeg == NONE || visited[nextSeg])
+				break;
+			visited[nextSeg] = 1;
+			edge = segmentEdges[nextSeg * 2] == edge ? segmentEdges[nextSeg * 2 + 1] : segmentEdges[nextSeg * 2];
+			seg = nextSeg;
+		}
+		if (closed && loop.size() > 1 && points[loop.front()] == points[loop.back()])
+			loop.pop_back();
+		if (closed && loop.size() >= 3)
+			loops.push_back(loop);
+	}
+
+	// 2D frame on the plane, counter clockwise in it faces away from the kept side
+	glm::vec3 u = std::fabs(Normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+	u = glm::normalize(u - Normal * glm::dot(u, Normal));
+	glm::vec3 v = glm::cross(-Normal, u);
+	// centering the 2D points keeps the float precision where the tiny ear areas of a dense cut need it
+	glm::vec3 center(0.0f);
+	for (const glm::vec3& p : points)
+		center += p / (float)points.size();
+	std::vector<glm::vec2> flat(points.size());
+	for (size_t i = 0; i < points.size(); i++)
+		flat[i] = glm::vec2(glm::dot(points[i] - center, u), glm::dot(points[i] - center, v));
+
+	// a loop inside an odd number of other loops is a hole, its parent is the smallest loop around it
+	size_t loopCount = loops.size();
+	std::vector<float> areas(loopCount);
+	std::vector<glm::vec4> bounds(loopCount);
+	for (size_t i = 0; i < loopCount; i++)
+	{
+		areas[i] = signedArea(flat, loops[i]);
+		glm::vec2 lo = flat[loops[i][0]], hi = lo;
+		for (GLuint p : loops[i])
+		{
+			lo = glm::min(lo, flat[p]);
+			hi = glm::max(hi, flat[p]);
+		}
+		bounds[i] = glm::vec4(lo, hi);
+	}
+	std::vector<int> depth(loopCount, 0);
+	std::vector<size_t> parent(loopCount, NONE);
+	for (size_t i = 0; i < loopCount; i++)
+	{
+		glm::vec2 p = flat[loops[i][0]];
+		for (size_t j = 0; j < loopCount; j++)
+		{
+			if (i == j || p.x < bounds[j].x || p.y < bounds[j].y || p.x > bounds[j].z || p.y > bounds[j].w)
+				continue;
+			if (inPolygon(flat, loops[j], p))
+			{
+				depth[i]++;
+				if (parent[i] == NONE || std::fabs(areas[j]) < std::fabs(areas[parent[i]]))
+					parent[i] = j;
+			}
+		}
+	}
+	for (size_t i = 0; i < loopCount; i++)
+	{
+		bool hole = depth[i] % 2 == 1;
+		if ((areas[i] < 0.0f) != hole)
+			std::reverse(loops[i].begin(), loops[i].end());
+	}
+
+	std::vector<GLuint> triangulated;
+	for (size_t i = 0; i < loopCount; i++)
+	{
+		if (depth[i] % 2 == 1)
+			continue;
+		std::vector<size_t> holes;
+		for (size_t j = 0; j < loopCount; j++)
+			if (depth[j] % 2 == 1 && parent[j] == i)
+				holes.push_back(j);
+		// bridging the rightmost holes first keeps earlier bridges from blocking later ones
+		std::sort(holes.begin(), holes.end(), [&bounds](size_t l, size_t r) { return bounds[l].z > bounds[r].z; });
+
+		std::vector<GLuint> polygon = loops[i];
+		for (size_t h : holes)
+			bridgeHole(flat, polygon, loops[h]);
+		earClip(flat, polygon, triangulated);
+	}
+
+	capVertices.reserve(points.size() * 8);
+	for (size_t i = 0; i < points.size(); i++)
+	{
+		capVertices.insert(capVertices.end(), { points[i].x, points[i].y, points[i].z });
+		capVertices.insert(capVertices.end(), { capColor.r, capColor.g, capColor.b });
+		capVertices.insert(capVertices.end(), { glm::dot(points[i], u), glm::dot(points[i], v) });
+	}
+	capIndices.swap(triangulated);
+
+	cutMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// Plane equation for the clipPlane uniform, dot(xyz, position) + w >= 0 is kept
+glm::vec4 SectionPlane::Equation()
+{
+	return glm::vec4(Normal, -Offset);
+}
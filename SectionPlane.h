@@ -0,0 +1,66 @@
+#ifndef SECTION_PLANE_CLASS_H
+#define SECTION_PLANE_CLASS_H
+
+#include<glad/glad.h>
+#include<glm/glm.hpp>
+#include<vector>
+
+#include"MeshTopology.h"
+
+// Cuts a closed triangle mesh with a plane and builds the cap polygons that close the cut,
+// the shader discards everything behind the plane and the caps are drawn on top of the cut
+class SectionPlane
+{
+public:
+	// Unit normal of the plane, the side it points to is the side that is kept
+	glm::vec3 Normal;
+	// Distance of the plane from the origin along the normal
+	float Offset = 0.0f;
+	// Range of offsets where the plane actually touches the mesh
+	float minOffset = 0.0f;
+	float maxOffset = 0.0f;
+
+	// Cap triangles in the same layout as the mesh vertices: position, color, texture coordinate
+	std::vector<GLfloat> capVertices;
+	std::vector<GLuint> capIndices;
+	glm::vec3 capColor = glm::vec3(0.85f, 0.25f, 0.20f);
+
+	// How long the last Cut took in milliseconds
+	float cutMilliseconds = 0.0f;
+
+	// Constructor that copies the positions out of interleaved vertices (stride in floats)
+	SectionPlane(const GLfloat* vertices, size_t vertexCount, size_t stride, const GLuint* indices, size_t indexCount, glm::vec3 normal);
+
+	// Changes the plane direction, this rebuilds the slab index so it is slower than a Cut
+	void SetNormal(glm::vec3 normal);
+	// Moves the plane to the offset and regenerates the cap geometry
+	void Cut(float offset);
+	// Plane equation for the clipPlane uniform, dot(xyz, position) + w >= 0 is kept
+	glm::vec4 Equation();
+
+private:
+	std::vector<glm::vec3> positions;
+	std::vector<GLuint> triangles;
+	MeshTopology topology;
+	// Distance of every vertex along the normal, so a cut never touches the positions of uncut triangles
+	std::vector<float> distances;
+
+	// Triangles bucketed by the range of distances they cover along the normal so a cut
+	// only visits the triangles of one slab instead of the whole mesh
+	float slabOrigin = 0.0f;
+	float slabWidth = 1.0f;
+	std::vector<GLuint> slabStart;
+	std::vector<GLuint> slabTriangles;
+
+	// Per edge scratch reused between cuts, an entry is only valid when its stamp matches,
+	// edgeSegment holds the two segments that meet at the edge
+	std::vector<GLuint> edgeStamp;
+	std::vector<GLuint> edgePoint;
+	std::vector<GLuint> edgeSegment;
+	GLuint stamp = 0;
+
+	// Buckets every triangle into the slabs it overlaps
+	void buildSlabs();
+};
+
+#endif
@@ -0,0 +1,75 @@
+#include"ShaderLibrary.h"
+
+#include"GLExtensions.h"
+#include"TextureAtlas.h"
+
+// Constructor that builds the fallback
+ShaderLibrary::ShaderLibrary(const char* vertexFile, const char* fragmentFile)
+	: fallback(vertexFile, fragmentFile), vertexFile(vertexFile), fragmentFile(fragmentFile)
+{
+}
+
+// The variant with these features when it is ready, the fallback until then
+Shader& ShaderLibrary::Get(uint32_t features)
+{
+	auto found = variants.find(features);
+	if (found == variants.end())
+	{
+		// only starts the compile, Update picks it up once the driver is done
+		Variant variant = { std::unique_ptr<Shader>(new Shader(vertexFile.c_str(), fragmentFile.c_str(), Defines(features), false)), false };
+		found = variants.emplace(features, std::move(variant)).first;
+	}
+	return found->second.ready ? *found->second.shader : fallback;
+}
+
+// Finishes variants the driver is done with, call once per frame
+void ShaderLibrary::Update()
+{
+	for (auto& entry : variants)
+	{
+		Variant& variant = entry.second;
+		if (variant.ready)
+			continue;
+		bool wasCached = variant.shader->fromCache;
+		if (!variant.shader->Ready())
+			continue;
+		variant.ready = true;
+		variantsReady++;
+		if (wasCached)
+			variantsFromCache++;
+		// the driver was waited on, leave the rest for later frames
+		if (!GLExtensions::parallelShaderCompile && !wasCached)
+			return;
+	}
+}
+
+// True while a variant that was asked for is still compiling
+bool ShaderLibrary::Pending() const
+{
+	for (const auto& entry : variants)
+		if (!entry.second.ready)
+			return true;
+	return false;
+}
+
+// The defines of a variant
+std::string ShaderLibrary::Defines(uint32_t features)
+{
+	std::string defines;
+	defines += std::string("#define TEXTURED ") + ((features & TEXTURED) ? "1" : "0") + "\n";
+	defines += std::string("#define FLAT_SHADING ") + ((features & FLAT_SHADING) ? "1" : "0") + "\n";
+	defines += std::string("#define CLIPPED ") + ((features & CLIPPED) ? "1" : "0") + "\n";
+	defines += std::string("#define INSTANCED ") + ((features & INSTANCED) ? "1" : "0") + "\n";
+	defines += std::string("#define ATLAS ") + ((features & ATLAS) ? "1" : "0") + "\n";
+	// the size of the AtlasSlots block comes from the one constant the CPU side fills it by
+	if (features & ATLAS)
+		defines += "#define MAX_ATLAS_SLOTS " + std::to_string(MAX_ATLAS_SLOTS) + "\n";
+	return defines;
+}
+
+// Releases the fallback and every variant
+void ShaderLibrary::Delete()
+{
+	fallback.Delete();
+	variants.clear();
+}
@@ -0,0 +1,64 @@
+#ifndef SHADER_LIBRARY_CLASS_H
+#define SHADER_LIBRARY_CLASS_H
+
+#include<cstdint>
+#include<memory>
+#include<string>
+#include<unordered_map>
+
+#include"shaderClass.h"
+
+// Builds variants of one vertex and fragment shader pair by defining feature switches, only when a
+// variant is first asked for. Until a variant has compiled the general program (no switches defined)
+// is handed out instead, so a new combination never stalls a frame
+class ShaderLibrary
+{
+public:
+	// Feature bits, each one becomes a 0 or 1 define in the variant
+	enum Feature : uint32_t
+	{
+		// texture instead of vertex color
+		TEXTURED = 1 << 0,
+		// one color per triangle instead of interpolating
+		FLAT_SHADING = 1 << 1,
+		// discard behind the section plane
+		CLIPPED = 1 << 2,
+		// per instance transform at locations 3 to 6
+		INSTANCED = 1 << 3,
+		// texture from a TextureAtlas slot (location 8) instead of tex0 or vertex color
+		ATLAS = 1 << 4
+	};
+
+	// Compiled right away, drawn while variants compile
+	Shader fallback;
+	// Variants that finished compiling, and how many of those came from the binary cache
+	unsigned variantsReady = 0;
+	unsigned variantsFromCache = 0;
+
+	// Constructor that builds the fallback
+	ShaderLibrary(const char* vertexFile, const char* fragmentFile);
+
+	// The variant with these features when it is ready, the fallback until then
+	Shader& Get(uint32_t features);
+	// Finishes variants the driver is done with, call once per frame. Without parallel compile
+	// support finishing waits on the driver, so only one variant is finished per call
+	void Update();
+	// True while a variant that was asked for is still compiling
+	bool Pending() const;
+	// The defines of a variant
+	static std::string Defines(uint32_t features);
+	// Releases the fallback and every variant
+	void Delete();
+
+private:
+	struct Variant
+	{
+		std::unique_ptr<Shader> shader;
+		bool ready;
+	};
+	std::string vertexFile;
+	std::string fragmentFile;
+	std::unordered_map<uint32_t, Variant> variants;
+};
+
+#endif
@@ -0,0 +1,337 @@
+#include"SoftwareRasterizer.h"
+
+#include<algorithm>
+#include<atomic>
+#include<cfloat>
+#include<chrono>
+#include<cmath>
+
+#include"JobSystem.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include<emmintrin.h>
+#define SOFTWARE_RASTERIZER_SSE2
+#endif
+
+namespace
+{
+	// color (3), texture coordinate (2), occlusion, clip distance
+	const int ATTRIBUTES = 7;
+
+	struct ClipVertex
+	{
+		glm::vec4 position;
+		float attributes[ATTRIBUTES];
+	};
+
+	// a triangle after the perspective divide, attributes are premultiplied by 1/w so they
+	// interpolate linearly in screen space
+	struct ScreenTriangle
+	{
+		float x[3], y[3], z[3], invW[3];
+		float attributes[3][ATTRIBUTES];
+		int minX, minY, maxX, maxY;
+	};
+
+	// runs work(thread) for every thread index on the shared job system, the calling thread takes part
+	template<typename Work>
+	void parallel(unsigned threadCount, Work work)
+	{
+		JobSystem::Shared().Parallel(threadCount, work);
+	}
+
+	ClipVertex lerp(const ClipVertex& a, const ClipVertex& b, float t)
+	{
+		ClipVertex result;
+		result.position = a.position + (b.position - a.position) * t;
+		for (int k = 0; k < ATTRIBUTES; k++)
+			result.attributes[k] = a.attributes[k] + (b.attributes[k] - a.attributes[k]) * t;
+		return result;
+	}
+
+	// Sutherland-Hodgman against the near (w + z >= 0) and far (w - z >= 0) planes, x and y are
+	// left to the scissoring by tile bounds
+	int clipPolygon(ClipVertex* polygon, int count, ClipVertex* scratch)
+	{
+		for (int plane = 0; plane < 2; plane++)
+		{
+			float sign = plane == 0 ? 1.0f : -1.0f;
+			int out = 0;
+			for (int i = 0; i < count; i++)
+			{
+				const ClipVertex& a = polygon[i];
+				const ClipVertex& b = polygon[(i + 1) % count];
+				float da = a.position.w + sign * a.position.z;
+				float db = b.position.w + sign * b.position.z;
+				if (da >= 0.0f)
+					scratch[out++] = a;
+				if ((da >= 0.0f) != (db >= 0.0f))
+					scratch[out++] = lerp(a, b, da / (da - db));
+			}
+			std::copy(scratch, scratch + out, polygon);
+			count = out;
+			if (count < 3)
+				return 0;
+		}
+		return count;
+	}
+}
+
+// Constructor for a framebuffer of the given size
+SoftwareRasterizer::SoftwareRasterizer(int width, int height)
+	: width(width), height(height), color(width, height, 4), depth((size_t)width * height, 1.0f)
+{
+	threadCount = JobSystem::Shared().WorkerCount() + 1;
+}
+
+// Fills the color buffer and resets the depth buffer to 1
+void SoftwareRasterizer::Clear(glm::vec4 clearColor)
+{
+	unsigned char rgba[4];
+	for (int k = 0; k < 4; k++)
+		rgba[k] = (unsigned char)std::lround(glm::clamp(clearColor[k], 0.0f, 1.0f) * 255.0f);
+	for (size_t i = 0; i < color.pixels.size(); i += 4)
+		std::copy(rgba, rgba + 4, &color.pixels[i]);
+	std::fill(depth.begin(), depth.end(), 1.0f);
+}
+
+// Draws every instance of the mesh, occlusion may be empty and texture may be NULL when flatColor is set
+void SoftwareRasterizer::Draw(const Mesh& mesh, const std::vector<glm::mat4>& transforms, const std::vector<GLubyte>& occlusion,
+	const glm::mat4& camMatrix, const Image* texture, bool flatColor, glm::vec4 clipPlane)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	size_t vertexCount = mesh.VertexCount();
+	size_t triangleCount = mesh.indices.size() / 3;
+	size_t instanceCount = transforms.size();
+
+	// vertex stage, the same math as default.vert
+	std::vector<ClipVertex> shaded(vertexCount * instanceCount);
+	parallel(threadCount, [&](unsigned thread)
+	{
+		for (size_t i = thread; i < shaded.size(); i += threadCount)
+		{
+			size_t v = i % vertexCount;
+			const GLfloat* source = &mesh.vertices[v * Mesh::stride];
+			glm::vec4 worldPos = transforms[i / vertexCount] * glm::vec4(source[0], source[1], source[2], 1.0f);
+			ClipVertex& out = shaded[i];
+			out.position = camMatrix * worldPos;
+			std::copy(source + 3, source + 8, out.attributes);
+			out.attributes[5] = occlusion.empty() ? 1.0f : occlusion[v] / 255.0f;
+			out.attributes[6] = glm::dot(clipPlane, worldPos);
+		}
+	});
+
+	// setup and binning, every thread bins its share of triangles into its own tile lists so
+	// nothing is shared, and the tiles walk the lists in thread order to keep draw order stable
+	int tilesX = (width + tileSize - 1) / tileSize;
+	int tilesY = (height + tileSize - 1) / tileSize;
+	std::vector<std::vector<ScreenTriangle>> triangles(threadCount);
+	std::vector<std::vector<std::vector<uint32_t>>> bins(threadCount, std::vector<std::vector<uint32_t>>((size_t)tilesX * tilesY));
+	parallel(threadCount, [&](unsigned thread)
+	{
+		size_t total = triangleCount * instanceCount;
+		size_t first = total * thread / threadCount;
+		size_t last = total * (thread + 1) / threadCount;
+		for (size_t t = first; t < last; t++)
+		{
+			size_t base = (t / triangleCount) * vertexCount;
+			size_t index = (t % triangleCount) * 3;
+			ClipVertex polygon[9], scratch[9];
+			bool outside = false;
+			for (int k = 0; k < 3; k++)
+				polygon[k] = shaded[base + mesh.indices[index + k]];
+
+			// trivially reject triangles outside one of the frustum planes
+			for (int axis = 0; axis < 3 && !outside; axis++)
+				for (float sign = -1.0f; sign <= 1.0f && !outside; sign += 2.0f)
+					outside = sign * polygon[0].position[axis] > polygon[0].position.w
+						&& sign * polygon[1].position[axis] > polygon[1].position.w
+						&& sign * polygon[2].position[axis] > polygon[2].position.w;
+			if (outside)
+				continue;
+			int count = clipPolygon(polygon, 3, scratch);
+
+			// the clipped polygon is convex, fan it out
+			for (int k = 1; k + 1 < count; k++)
+			{
+				ScreenTriangle triangle;
+				const ClipVertex* corners[3] = { &polygon[0], &polygon[k], &polygon[k + 1] };
+				for (int c = 0; c < 3; c++)
+				{
+					float invW = 1.0f / corners[c]->position.w;
+					triangle.x[c] = (corners[c]->position.x * invW * 0.5f + 0.5f) * width;
+					triangle.y[c] = (corners[c]->position.y * invW * 0.5f + 0.5f) * height;
+					triangle.z[c] = corners[c]->position.z * invW * 0.5f + 0.5f;
+					triangle.invW[c] = invW;
+					for (int a = 0; a < ATTRIBUTES; a++)
+						triangle.attributes[c][a] = corners[c]->attributes[a] * invW;
+				}
+
+				// there is no face culling in the GL path either, so wind everything counter clockwise
+				float area = (triangle.x[1] - triangle.x[0]) * (triangle.y[2] - triangle.y[0]) - (triangle.y[1] - triangle.y[0]) * (triangle.x[2] - triangle.x[0]);
+				if (!(std::fabs(area) > 0.0f))
+					continue;
+				if (area < 0.0f)
+				{
+					std::swap(triangle.x[1], triangle.x[2]);
+					std::swap(triangle.y[1], triangle.y[2]);
+					std::swap(triangle.z[1], triangle.z[2]);
+					std::swap(triangle.invW[1], triangle.invW[2]);
+					std::swap(triangle.attributes[1], triangle.attributes[2]);
+				}
+
+				// pixel centers sit at +0.5, keep the ones the bounds can reach
+				float loX = std::min({ triangle.x[0], triangle.x[1], triangle.x[2] });
+				float hiX = std::max({ triangle.x[0], triangle.x[1], triangle.x[2] });
+				float loY = std::min({ triangle.y[0], triangle.y[1], triangle.y[2] });
+				float hiY = std::max({ triangle.y[0], triangle.y[1], triangle.y[2] });
+				triangle.minX = std::max(0, (int)std::ceil(loX - 0.5f));
+				triangle.minY = std::max(0, (int)std::ceil(loY - 0.5f));
+				triangle.maxX = std::min(width - 1, (int)std::floor(hiX - 0.5f));
+				triangle.maxY = std::min(height - 1, (int)std::floor(hiY - 0.5f));
+				if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+					continue;
+
+				uint32_t id = (uint32_t)triangles[thread].size();
+				triangles[thread].push_back(triangle);
+				for (int ty = triangle.minY / tileSize; ty <= triangle.maxY / tileSize; ty++)
+					for (int tx = triangle.minX / tileSize; tx <= triangle.maxX / tileSize; tx++)
+						bins[thread][(size_t)ty * tilesX + tx].push_back(id);
+			}
+		}
+	});
+	trianglesBinned = 0;
+	for (std::vector<ScreenTriangle>& list : triangles)
+		trianglesBinned += list.size();
+
+	// fragment stage, the same math as default.frag with nearest sampling and repeat wrapping
+	auto shade = [&](const ScreenTriangle& triangle, int x, int y, float e0, float e1, float e2)
+	{
+		// normalizing by the sum instead of the area keeps the weights summing to one on tiny
+		// triangles, where the rounding in the edge values is a large part of the area
+		float invSum = 1.0f / (e0 + e1 + e2);
+		float b0 = e0 * invSum, b1 = e1 * invSum, b2 = e2 * invSum;
+		float z = b0 * triangle.z[0] + b1 * triangle.z[1] + b2 * triangle.z[2];
+		size_t pixel = (size_t)y * width + x;
+		if (!(z < depth[pixel]) || z < 0.0f)
+			return;
+		float w = 1.0f / (b0 * triangle.invW[0] + b1 * triangle.invW[1] + b2 * triangle.invW[2]);
+		float attributes[ATTRIBUTES];
+		for (int a = 0; a < ATTRIBUTES; a++)
+			attributes[a] = (b0 * triangle.attributes[0][a] + b1 * triangle.attributes[1][a] + b2 * triangle.attributes[2][a]) * w;
+
+		// behind the section plane
+		if (attributes[6] < 0.0f)
+			return;
+
+		glm::vec3 rgb(attributes[0], attributes[1], attributes[2]);
+		if (!flatColor)
+		{
+			rgb = glm::vec3(0.0f);
+			if (texture != NULL && texture->width > 0 && texture->height > 0)
+			{
+				int tx = (int)std::floor(attributes[3] * texture->width) % texture->width;
+				int ty = (int)std::floor(attributes[4] * texture->height) % texture->height;
+				tx += tx < 0 ? texture->width : 0;
+				ty += ty < 0 ? texture->height : 0;
+				const unsigned char* texel = &texture->pixels[((size_t)ty * texture->width + tx) * texture->channels];
+				rgb = texture->channels >= 3 ? glm::vec3(texel[0], texel[1], texel[2]) / 255.0f : glm::vec3(texel[0] / 255.0f);
+			}
+		}
+		rgb *= attributes[5];
+
+		depth[pixel] = z;
+		unsigned char* out = &color.pixels[pixel * 4];
+		for (int k = 0; k < 3; k++)
+			out[k] = (unsigned char)(glm::clamp(rgb[k], 0.0f, 1.0f) * 255.0f + 0.5f);
+		out[3] = 255;
+	};
+
+	std::atomic<int> nextTile(0);
+	parallel(threadCount, [&](unsigned)
+	{
+		for (int tile = nextTile++; tile < tilesX * tilesY; tile = nextTile++)
+		{
+			int tileMinX = (tile % tilesX) * tileSize;
+			int tileMinY = (tile / tilesX) * tileSize;
+			int tileMaxX = std::min(tileMinX + tileSize, width) - 1;
+			int tileMaxY = std::min(tileMinY + tileSize, height) - 1;
+
+			for (unsigned list = 0; list < threadCount; list++)
+				for (uint32_t id : bins[list][tile])
+				{
+					const ScreenTriangle& triangle = triangles[list][id];
+					int minX = std::max(triangle.minX, tileMinX);
+					int maxX = std::min(triangle.maxX, tileMaxX);
+					int minY = std::max(triangle.minY, tileMinY);
+					int maxY = std::min(triangle.maxY, tileMaxY);
+
+					// edge k is opposite corner k: e = A * x + B * y + C, positive inside, with x and y
+					// relative to the triangle bounds so C stays small enough for float
+					float originX = (float)triangle.minX, originY = (float)triangle.minY;
+					float A[3], B[3], C[3], bias[3];
+					for (int k = 0; k < 3; k++)
+					{
+						int i = (k + 1) % 3, j = (k + 2) % 3;
+						float xi = triangle.x[i] - originX, yi = triangle.y[i] - originY;
+						float xj = triangle.x[j] - originX, yj = triangle.y[j] - originY;
+						A[k] = yi - yj;
+						B[k] = xj - xi;
+						C[k] = xi * yj - yi * xj;
+						// top left fill rule, pixels exactly on a right or bottom edge belong to the neighbour
+						bool topLeft = A[k] > 0.0f || (A[k] == 0.0f && B[k] < 0.0f);
+						bias[k] = topLeft ? 0.0f : FLT_MIN;
+					}
+
+					for (int y = minY; y <= maxY; y++)
+					{
+						float py = y + 0.5f - originY;
+						float row[3];
+						for (int k = 0; k < 3; k++)
+							row[k] = B[k] * py + C[k];
+						int x = minX;
+#ifdef SOFTWARE_RASTERIZER_SSE2
+						// four pixels at a time, only the covered ones are shaded
+						__m128 offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+						__m128 edgeA[3], edgeRow[3], edgeBias[3];
+						for (int k = 0; k < 3; k++)
+						{
+							edgeA[k] = _mm_set1_ps(A[k]);
+							edgeRow[k] = _mm_set1_ps(row[k]);
+							edgeBias[k] = _mm_set1_ps(bias[k]);
+						}
+						for (; x + 3 <= maxX; x += 4)
+						{
+							__m128 px = _mm_add_ps(_mm_set1_ps(x - originX), offsets);
+							__m128 e[3];
+							for (int k = 0; k < 3; k++)
+								e[k] = _mm_add_ps(_mm_mul_ps(edgeA[k], px), edgeRow[k]);
+							__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e[0], edgeBias[0]), _mm_cmpge_ps(e[1], edgeBias[1])), _mm_cmpge_ps(e[2], edgeBias[2]));
+							int mask = _mm_movemask_ps(inside);
+							if (mask == 0)
+								continue;
+							alignas(16) float e0[4], e1[4], e2[4];
+							_mm_store_ps(e0, e[0]);
+							_mm_store_ps(e1, e[1]);
+							_mm_store_ps(e2, e[2]);
+							for (int lane = 0; lane < 4; lane++)
+								if (mask & (1 << lane))
+									shade(triangle, x + lane, y, e0[lane], e1[lane], e2[lane]);
+						}
+#endif
+						for (; x <= maxX; x++)
+						{
+							float px = x + 0.5f - originX;
+							float e0 = A[0] * px + row[0];
+							float e1 = A[1] * px + row[1];
+							float e2 = A[2] * px + row[2];
+							if (e0 >= bias[0] && e1 >= bias[1] && e2 >= bias[2])
+								shade(triangle, x, y, e0, e1, e2);
+						}
+					}
+				}
+		}
+	});
+
+	milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
@@ -0,0 +1,42 @@
+#ifndef SOFTWARE_RASTERIZER_CLASS_H
+#define SOFTWARE_RASTERIZER_CLASS_H
+
+#include<glad/glad.h>
+#include<glm/glm.hpp>
+#include<vector>
+
+#include"Image.h"
+#include"Mesh.h"
+
+// CPU backend for machines without a GPU, draws the same inputs as default.vert and default.frag:
+// a mesh, its instance transforms and baked occlusion, camMatrix, clipPlane and tex0.
+// Triangles are binned into square tiles and the tiles are rasterized in parallel with SIMD
+// edge functions against a depth buffer
+class SoftwareRasterizer
+{
+public:
+	int width;
+	int height;
+	// RGBA color and depth in [0, 1], both with the bottom row first like the default framebuffer
+	Image color;
+	std::vector<float> depth;
+
+	// Tile edge in pixels
+	int tileSize = 64;
+	unsigned threadCount;
+
+	// Stats of the last Draw
+	size_t trianglesBinned = 0;
+	double milliseconds = 0.0;
+
+	// Constructor for a framebuffer of the given size
+	SoftwareRasterizer(int width, int height);
+
+	// Fills the color buffer and resets the depth buffer to 1
+	void Clear(glm::vec4 clearColor);
+	// Draws every instance of the mesh, occlusion may be empty and texture may be NULL when flatColor is set
+	void Draw(const Mesh& mesh, const std::vector<glm::mat4>& transforms, const std::vector<GLubyte>& occlusion,
+		const glm::mat4& camMatrix, const Image* texture, bool flatColor, glm::vec4 clipPlane = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+};
+
+#endif
@@ -0,0 +1,176 @@
+#include"StreamBuffer.h"
+
+#include<chrono>
+
+#include"GLExtensions.h"
+#include"GLState.h"
+
+// Constructor for a buffer of segmentSize bytes per frame in flight
+StreamBuffer::StreamBuffer(GLenum target, GLsizeiptr segmentSize, int frameCount)
+	: target(target), segmentSize(segmentSize), frameCount(frameCount), fences(frameCount, (GLsync)0)
+{
+	persistent = GLExtensions::bufferStorage;
+	create();
+}
+
+// Makes sure the segments hold at least this many bytes, call before the first Allocate of a frame
+void StreamBuffer::Reserve(GLsizeiptr bytesPerFrame)
+{
+	if (bytesPerFrame <= segmentSize || head > 0)
+		return;
+	while (segmentSize < bytesPerFrame)
+		segmentSize *= 2;
+
+	// immutable storage cannot be resized, so the whole buffer is replaced once nothing reads it
+	waitAll();
+	if (mapped != NULL)
+	{
+		bindForWrite();
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		mapped = NULL;
+	}
+	GLState::DeleteBuffer(ID);
+	create();
+	segment = 0;
+	segmentReady = false;
+}
+
+// Claims space in this frame's segment, write through pointer and then call Commit
+StreamBuffer::Allocation StreamBuffer::Allocate(GLsizeiptr size, GLsizeiptr alignment)
+{
+	if (!segmentReady)
+		acquireSegment();
+
+	GLsizeiptr offset = (head + alignment - 1) / alignment * alignment;
+	if (offset + size > segmentSize)
+	{
+		overflows++;
+		return Allocation{ NULL, 0, 0 };
+	}
+	head = offset + size;
+	frameBytes += size;
+
+	GLintptr bufferOffset = segment * segmentSize + offset;
+	if (persistent)
+		return Allocation{ mapped + bufferOffset, bufferOffset, size };
+
+	// the segment is known to be free, so the driver does not have to synchronize either
+	bindForWrite();
+	void* pointer = glMapBufferRange(GL_COPY_WRITE_BUFFER, bufferOffset, size, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+	return Allocation{ pointer, bufferOffset, size };
+}
+
+// Finishes writing an allocation, unmaps it when the buffer is not persistently mapped
+void StreamBuffer::Commit(const Allocation& allocation)
+{
+	if (persistent || allocation.pointer == NULL)
+		return;
+	bindForWrite();
+	glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+}
+
+// Fences the segment written this frame and moves to the next one
+void StreamBuffer::EndFrame()
+{
+	if (head > 0)
+	{
+		fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		segment = (segment + 1) % frameCount;
+		segmentReady = false;
+		head = 0;
+	}
+	bytesStreamed = frameBytes;
+	stallMilliseconds = frameStall;
+	totalBytesStreamed += frameBytes;
+	totalStallMilliseconds += frameStall;
+	frameBytes = 0;
+	frameStall = 0.0;
+}
+
+// Binds the buffer to its target
+void StreamBuffer::Bind()
+{
+	GLState::BindBuffer(target, ID);
+}
+
+// Waits for the GPU and deletes the buffer
+void StreamBuffer::Delete()
+{
+	waitAll();
+	if (mapped != NULL)
+	{
+		bindForWrite();
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		mapped = NULL;
+	}
+	GLState::DeleteBuffer(ID);
+}
+
+// Binds the buffer for mapping, orphaning and creating. An element buffer bound to its own target would
+// replace the one of whichever VAO is bound, the copy target belongs to no VAO
+void StreamBuffer::bindForWrite()
+{
+	GLState::BindBuffer(GL_COPY_WRITE_BUFFER, ID);
+}
+
+// Creates the GL buffer at the current size
+void StreamBuffer::create()
+{
+	GLsizeiptr size = segmentSize * frameCount;
+	glGenBuffers(1, &ID);
+	bindForWrite();
+	if (persistent)
+	{
+		// coherent, so writes are visible to the GPU without explicit flushes
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		GLExtensions::BufferStorage(GL_COPY_WRITE_BUFFER, size, NULL, flags);
+		mapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags);
+	}
+	else
+		glBufferData(GL_COPY_WRITE_BUFFER, size, NULL, GL_STREAM_DRAW);
+}
+
+// Waits for or, without persistent mapping, orphans around the GPU still reading this segment
+void StreamBuffer::acquireSegment()
+{
+	segmentReady = true;
+	GLsync fence = fences[segment];
+	if (fence == 0)
+		return;
+	fences[segment] = 0;
+
+	// usually signaled long ago, frameCount frames have passed since it was written
+	if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+	{
+		if (!persistent)
+		{
+			// fresh storage from the driver instead of waiting, every fence is about the old storage
+			bindForWrite();
+			glBufferData(GL_COPY_WRITE_BUFFER, segmentSize * frameCount, NULL, GL_STREAM_DRAW);
+			for (GLsync& other : fences)
+				if (other != 0)
+				{
+					glDeleteSync(other);
+					other = 0;
+				}
+		}
+		else
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED);
+			frameStall += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		}
+	}
+	glDeleteSync(fence);
+}
+
+void StreamBuffer::waitAll()
+{
+	for (GLsync& fence : fences)
+		if (fence != 0)
+		{
+			while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED);
+			glDeleteSync(fence);
+			fence = 0;
+		}
+}
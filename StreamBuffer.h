@@ -0,0 +1,72 @@
+#ifndef STREAM_BUFFER_CLASS_H
+#define STREAM_BUFFER_CLASS_H
+
+#include<glad/glad.h>
+#include<cstddef>
+#include<vector>
+
+// Ring buffer for data that is rewritten every frame, like section caps or highlights.
+// The buffer is split into one segment per frame in flight and each segment is guarded by a fence,
+// so writing never waits for the GPU unless it falls a whole ring behind.
+// With ARB_buffer_storage the buffer stays mapped for its whole life, without it every allocation
+// is mapped unsynchronized and a segment the GPU still reads is replaced by orphaning the buffer
+class StreamBuffer
+{
+public:
+	// Where one allocation landed, pointer is NULL when it did not fit in this frame's segment
+	struct Allocation
+	{
+		void* pointer;
+		GLintptr offset;
+		GLsizeiptr size;
+	};
+
+	GLuint ID;
+	GLenum target;
+	bool persistent;
+	GLsizeiptr segmentSize;
+	int frameCount;
+
+	// Stats of the last finished frame and totals
+	GLsizeiptr bytesStreamed = 0;
+	double stallMilliseconds = 0.0;
+	unsigned long long totalBytesStreamed = 0;
+	double totalStallMilliseconds = 0.0;
+	unsigned long long overflows = 0;
+
+	// Constructor for a buffer of segmentSize bytes per frame in flight
+	StreamBuffer(GLenum target, GLsizeiptr segmentSize, int frameCount = 3);
+
+	// Makes sure the segments hold at least this many bytes, call before the first Allocate of a frame.
+	// Growing replaces the buffer, so attribute pointers into it have to be set again
+	void Reserve(GLsizeiptr bytesPerFrame);
+	// Claims space in this frame's segment, write through pointer and then call Commit
+	Allocation Allocate(GLsizeiptr size, GLsizeiptr alignment = 16);
+	// Finishes writing an allocation, unmaps it when the buffer is not persistently mapped
+	void Commit(const Allocation& allocation);
+	// Fences the segment written this frame and moves to the next one
+	void EndFrame();
+	// Binds the buffer to its target, for an element buffer that attaches it to the bound VAO
+	void Bind();
+	// Waits for the GPU and deletes the buffer
+	void Delete();
+
+private:
+	unsigned char* mapped = NULL;
+	std::vector<GLsync> fences;
+	int segment = 0;
+	GLsizeiptr head = 0;
+	bool segmentReady = false;
+	GLsizeiptr frameBytes = 0;
+	double frameStall = 0.0;
+
+	// Binds the buffer for mapping, orphaning and creating, leaving the target's binding alone
+	void bindForWrite();
+	// Creates the GL buffer at the current size
+	void create();
+	// Waits for or, without persistent mapping, orphans around the GPU still reading this segment
+	void acquireSegment();
+	void waitAll();
+};
+
+#endif
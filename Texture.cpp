@@ -1,24 +1,87 @@
 #include"Texture.h"
 
-Texture::Texture(const char* image, GLenum texType, GLenum slot, GLenum format, GLenum pixelType)
+#include<iostream>
+
+#include"GLResources.h"
+#include"GLState.h"
+#include"TextureCompressor.h"
+
+Texture::Texture(const char* image, GLenum texType, GLenum slot, GLenum /*format*/, GLenum /*pixelType*/)
+{
+	// Reads the image flipped so it appears right side up, then builds the mip chain on the CPU.
+	// The chain is cached with the texture, so later loads upload every level straight from disk.
+	// format and pixelType are kept for existing callers, the cached chain is always RGBA8
+	TextureFile file;
+	try
+	{
+		TextureCompressor compressor;
+		file = compressor.Compress(Image(image), TextureFile::RGBA8);
+	}
+	catch (int)
+	{
+		// a missing or broken file shows as one grey texel instead of ending the program
+		std::cout << "Failed to read " << image << std::endl;
+		file.levels.push_back(TextureFile::Level{ 1, 1, std::vector<unsigned char>{ 160, 160, 160, 255 } });
+	}
+	create(file, texType, slot, image);
+}
+
+// Constructor for a texture made from pixels already in memory, it has no mip levels
+Texture::Texture(const void* pixels, GLsizei width, GLsizei height, GLenum texType, GLenum slot, GLenum format, GLenum pixelType, const char* label)
+{
+	TextureFile file;
+	file.levels.push_back(TextureFile::Level{ width, height, std::vector<unsigned char>() });
+	create(file, texType, slot, label);
+
+	// Assigns the image to the OpenGL Texture object
+	GLState::ActiveTexture(slot);
+	GLState::BindTexture(texType, ID);
+	glTexImage2D(texType, 0, GL_RGBA, width, height, 0, format, pixelType, pixels);
+	GLState::BindTexture(texType, 0);
+}
+
+// Constructor for a texture with its whole mip chain, compressed or not
+Texture::Texture(const TextureFile& file, GLenum texType, GLenum slot, const char* label)
+{
+	create(file, texType, slot, label);
+}
+
+// Creates the GL texture and uploads every level of the chain as it is, levels without data are left for the caller
+void Texture::create(const TextureFile& file, GLenum texType, GLenum slot, const char* label)
 {
 	// Assigns the type of the texture ot the texture object
 	type = texType;
 
-	// Stores the width, height, and the number of color channels of the image
-	int widthImg, heightImg, numColCh;
-	// Flips the image so it appears right side up
-	stbi_set_flip_vertically_on_load(true);
-	// Reads the image from a file and stores it in bytes
-	unsigned char* bytes = stbi_load(image, &widthImg, &heightImg, &numColCh, 0);
-
 	// Generates an OpenGL texture object
 	glGenTextures(1, &ID);
+	GLResources::Track(GLResources::TEXTURE, ID, label);
 
 	// assign texture to texture unit
-	glActiveTexture(slot);
-	glBindTexture(texType, ID);
+	GLState::ActiveTexture(slot);
+	GLState::BindTexture(texType, ID);
+
+	SetParameters(texType);
+
+	// the chain comes with the texture, the driver never generates mipmaps
+	for (size_t level = 0; level < file.levels.size(); level++)
+	{
+		const TextureFile::Level& mip = file.levels[level];
+		if (mip.data.empty())
+			continue;
+		if (file.Compressed())
+			glCompressedTexImage2D(texType, (GLint)level, TextureFile::InternalFormat(file.format), mip.width, mip.height, 0, (GLsizei)mip.data.size(), mip.data.data());
+		else
+			glTexImage2D(texType, (GLint)level, GL_RGBA, mip.width, mip.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, mip.data.data());
+	}
+	glTexParameteri(texType, GL_TEXTURE_MAX_LEVEL, (GLint)file.levels.size() - 1);
 
+	// unbind the texture so we dont accidentally modify it
+	GLState::BindTexture(texType, 0);
+}
+
+// The filtering and wrapping every texture here uses, on the texture bound to type
+void Texture::SetParameters(GLenum texType)
+{
 	// configure the algorithm used the modify texture size
 	glTexParameteri(texType, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
 	glTexParameteri(texType, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -26,40 +89,61 @@ Texture::Texture(const char* image, GLenum texType, GLenum slot, GLenum format,
 	// Configures the way the texture wraps to the borders like by repeating
 	glTexParameteri(texType, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(texType, GL_TEXTURE_WRAP_T, GL_REPEAT);
+}
 
-	// Assigns the image to the OpenGL Texture object
-	glTexImage2D(texType, 0, GL_RGBA, widthImg, heightImg, 0, format, pixelType, bytes);
-	// Generates MipMaps
-	glGenerateMipmap(texType);
+// Takes over the texture of another Texture
+Texture::Texture(Texture&& other) noexcept
+	: ID(other.ID), type(other.type), residency(other.residency)
+{
+	other.ID = 0;
+	other.residency = ResidencyManager::NONE;
+}
 
-	// delete the texture once it is stored in the texture object
-	stbi_image_free(bytes);
+Texture& Texture::operator=(Texture&& other) noexcept
+{
+	if (this != &other)
+	{
+		GLResources::Release(GLResources::TEXTURE, ID);
+		ID = other.ID;
+		type = other.type;
+		residency = other.residency;
+		other.ID = 0;
+		other.residency = ResidencyManager::NONE;
+	}
+	return *this;
+}
 
-	// unbind the texture so we dont accidentally modify it
-	glBindTexture(texType, 0);
+// Queues the texture for deletion at the end of the frame
+Texture::~Texture()
+{
+	GLResources::Release(GLResources::TEXTURE, ID);
 }
 
 void Texture::texUnit(Shader& shader, const char* uniform, GLuint unit)
 {
-	// Gets the location of the uniform
-	GLuint texUni = glGetUniformLocation(shader.ID, uniform);
-	// Shader needs to be activated before changing the value of a uniform
-	shader.Activate();
-	// Sets the value of the uniform
-	glUniform1i(texUni, unit);
+	// Gets the location of the uniform from the shader's reflection and sets it
+	shader.SetInt(shader.Uniform(uniform), unit);
 }
 
 void Texture::Bind()
 {
-	glBindTexture(type, ID);
+	GLState::BindTexture(type, ID);
 }
 
 void Texture::Unbind()
 {
-	glBindTexture(type, 0);
+	GLState::BindTexture(type, 0);
 }
 
 void Texture::Delete()
 {
-	glDeleteTextures(1, &ID);
-}
\ No newline at end of file
+	GLResources::Release(GLResources::TEXTURE, ID);
+	ID = 0;
+}
+
+// Takes over another GL texture and releases the current one
+void Texture::Replace(GLuint texture)
+{
+	GLResources::Release(GLResources::TEXTURE, ID);
+	ID = texture;
+}
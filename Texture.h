@@ -5,14 +5,30 @@
 #include<glad/glad.h>
 #include<stb/stb_image.h>
 
+#include"ResidencyManager.h"
 #include"shaderClass.h"
+#include"TextureFile.h"
 
 class Texture 
 {
 public:
 	GLuint ID;
 	GLenum type;
+	// Handle in the ResidencyManager that may evict it, NONE when nothing does
+	ResidencyManager::Handle residency = ResidencyManager::NONE;
 	Texture(const char* image, GLenum texType, GLenum slot, GLenum format, GLenum pixelType);
+	// Constructor for a texture made from pixels already in memory, it has no mip levels.
+	// label names it in resource dumps
+	Texture(const void* pixels, GLsizei width, GLsizei height, GLenum texType, GLenum slot, GLenum format, GLenum pixelType, const char* label);
+	// Constructor for a texture with its whole mip chain, compressed or not
+	Texture(const TextureFile& file, GLenum texType, GLenum slot, const char* label);
+
+	// Move only, the object owns the GL texture and releases it when destroyed
+	Texture(const Texture&) = delete;
+	Texture& operator=(const Texture&) = delete;
+	Texture(Texture&& other) noexcept;
+	Texture& operator=(Texture&& other) noexcept;
+	~Texture();
 
 	// asign a texture unit (collection of like 16 textures) to this texture
 	void texUnit(Shader& shader, const char* uniform, GLuint unit);
@@ -23,8 +39,17 @@ public:
 	// unbind texture
 	void Unbind();
 
-	// delete texture for cleanup
+	// release the texture before the destructor would
 	void Delete();
+
+	// Takes over another GL texture and releases the current one, for swapping in a finished upload
+	void Replace(GLuint texture);
+	// The filtering and wrapping every texture here uses, on the texture bound to type
+	static void SetParameters(GLenum texType);
+
+private:
+	// Creates the GL texture and uploads every level of the chain as it is, levels without data are left for the caller
+	void create(const TextureFile& file, GLenum texType, GLenum slot, const char* label);
 };
 
 #endif
\ No newline at end of file
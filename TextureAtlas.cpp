@@ -0,0 +1,194 @@
+#include"TextureAtlas.h"
+
+#include<algorithm>
+
+#include"GLResources.h"
+#include"GLState.h"
+
+// Constructor for an empty atlas, pages are added as textures need them
+TextureAtlas::TextureAtlas(TextureFile::Format format, GLsizei layerSize, GLsizei layersPerPage)
+	: format(format), layerSize(layerSize), layersPerPage(layersPerPage),
+	slotRects(MAX_ATLAS_SLOTS), slotLayers(MAX_ATLAS_SLOTS / 4)
+{
+	glGenBuffers(1, &slotBuffer);
+	GLResources::Track(GLResources::BUFFER, slotBuffer, "atlas slots");
+	GLState::BindBuffer(GL_UNIFORM_BUFFER, slotBuffer);
+	std::vector<glm::vec4> zeros(slotRects.size() + slotLayers.size(), glm::vec4(0.0f));
+	glBufferData(GL_UNIFORM_BUFFER, zeros.size() * sizeof(glm::vec4), zeros.data(), GL_DYNAMIC_DRAW);
+}
+
+// Uploads a texture into a free slot and returns its index
+int TextureAtlas::Add(const TextureFile& file)
+{
+	if (file.format != format || file.levels.empty() || slots.size() >= (size_t)MAX_ATLAS_SLOTS)
+		return -1;
+	GLsizei width = file.levels[0].width, height = file.levels[0].height;
+	if (width <= 0 || height <= 0 || width > layerSize || height > layerSize)
+		return -1;
+	// compressed levels can only be written as whole blocks, and there is no texel to stretch
+	// over the levels the chain is missing
+	if (file.Compressed())
+	{
+		for (GLint level = 0; level <= maxLevel(); level++)
+		{
+			if ((size_t)level >= file.levels.size() || file.levels[level].width % 4 != 0 || file.levels[level].height % 4 != 0)
+				return -1;
+		}
+	}
+
+	GLsizei slotWidth = minimumSlot, slotHeight = minimumSlot;
+	while (slotWidth < width)
+		slotWidth *= 2;
+	while (slotHeight < height)
+		slotHeight *= 2;
+	int layer;
+	GLsizei x, y;
+	if (!allocate(slotWidth, slotHeight, layer, x, y))
+		return -1;
+
+	Slot slot = { layer / layersPerPage, layer % layersPerPage,
+		glm::vec4((float)x, (float)y, (float)width, (float)height) / (float)layerSize };
+
+	GLState::ActiveTexture(GL_TEXTURE0 + ATLAS_TEXTURE_UNIT);
+	GLState::BindTexture(GL_TEXTURE_2D_ARRAY, pages[slot.page]);
+	GLState::BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	for (GLint level = 0; level <= maxLevel(); level++)
+	{
+		GLint levelX = x >> level, levelY = y >> level;
+		if ((size_t)level < file.levels.size())
+		{
+			const TextureFile::Level& mip = file.levels[level];
+			if (file.Compressed())
+				glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, levelX, levelY, slot.layer, mip.width, mip.height, 1, TextureFile::InternalFormat(format), (GLsizei)mip.data.size(), mip.data.data());
+			else
+				glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, levelX, levelY, slot.layer, mip.width, mip.height, 1, GL_RGBA, GL_UNSIGNED_BYTE, mip.data.data());
+			bytesUploaded += mip.data.size();
+		}
+		else
+		{
+			// the chain stops before the page's last level, its last texel fills the rest
+			const TextureFile::Level& last = file.levels.back();
+			GLsizei levelWidth = std::max(1, width >> level), levelHeight = std::max(1, height >> level);
+			std::vector<unsigned char> fill((size_t)levelWidth * levelHeight * 4);
+			for (size_t texel = 0; texel < fill.size() && last.data.size() >= 4; texel += 4)
+				std::copy(last.data.begin(), last.data.begin() + 4, fill.begin() + texel);
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, levelX, levelY, slot.layer, levelWidth, levelHeight, 1, GL_RGBA, GL_UNSIGNED_BYTE, fill.data());
+			bytesUploaded += fill.size();
+		}
+	}
+	GLState::ActiveTexture(GL_TEXTURE0);
+
+	int index = (int)slots.size();
+	slots.push_back(slot);
+	slotRects[index] = slot.rect;
+	slotLayers[index / 4][index % 4] = (float)slot.layer;
+	GLState::BindBuffer(GL_UNIFORM_BUFFER, slotBuffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, index * sizeof(glm::vec4), sizeof(glm::vec4), &slotRects[index]);
+	glBufferSubData(GL_UNIFORM_BUFFER, (slotRects.size() + index / 4) * sizeof(glm::vec4), sizeof(glm::vec4), &slotLayers[index / 4]);
+	return index;
+}
+
+// Binds a page to ATLAS_TEXTURE_UNIT and the slot table to ATLAS_SLOTS_BINDING
+void TextureAtlas::Bind(int page)
+{
+	if (page < 0 || (size_t)page >= pages.size())
+		return;
+	GLState::ActiveTexture(GL_TEXTURE0 + ATLAS_TEXTURE_UNIT);
+	GLState::BindTexture(GL_TEXTURE_2D_ARRAY, pages[page]);
+	// Texture::Bind binds on whichever unit is active
+	GLState::ActiveTexture(GL_TEXTURE0);
+	GLState::BindBufferBase(GL_UNIFORM_BUFFER, ATLAS_SLOTS_BINDING, slotBuffer);
+}
+
+// Deletes every page and the slot table
+void TextureAtlas::Delete()
+{
+	for (GLuint page : pages)
+		GLResources::Release(GLResources::TEXTURE, page);
+	pages.clear();
+	layers.clear();
+	slots.clear();
+	GLResources::Release(GLResources::BUFFER, slotBuffer);
+	slotBuffer = 0;
+}
+
+// Finds room for a slot, adding a page when every layer is full
+bool TextureAtlas::allocate(GLsizei width, GLsizei height, int& layer, GLsizei& x, GLsizei& y)
+{
+	if (width > layerSize || height > layerSize)
+		return false;
+	// slots sit at multiples of their own size, so each level's offset is a whole texel (or block)
+	auto alignUp = [](GLsizei value, GLsizei alignment) { return (value + alignment - 1) / alignment * alignment; };
+	for (size_t index = 0;; index++)
+	{
+		if (index == layers.size())
+			addPage();
+		Layer& candidate = layers[index];
+		for (Shelf& shelf : candidate.shelves)
+		{
+			GLsizei left = alignUp(shelf.x, width);
+			if (shelf.height == height && left + width <= layerSize)
+			{
+				layer = (int)index;
+				x = left;
+				y = shelf.y;
+				shelf.x = left + width;
+				return true;
+			}
+		}
+		GLsizei bottom = alignUp(candidate.top, height);
+		if (bottom + height <= layerSize)
+		{
+			candidate.shelves.push_back(Shelf{ bottom, height, width });
+			candidate.top = bottom + height;
+			layer = (int)index;
+			x = 0;
+			y = bottom;
+			return true;
+		}
+	}
+}
+
+// Creates the array texture of a new page with room for every level
+void TextureAtlas::addPage()
+{
+	GLuint page;
+	glGenTextures(1, &page);
+	GLResources::Track(GLResources::TEXTURE, page, "atlas page");
+	GLState::ActiveTexture(GL_TEXTURE0 + ATLAS_TEXTURE_UNIT);
+	GLState::BindTexture(GL_TEXTURE_2D_ARRAY, page);
+	// the shader repeats inside a slot itself, clamping keeps the edge slots from reading across the layer
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, maxLevel());
+
+	// storage only, the pixel unpack buffer must be unbound for NULL to mean no data
+	GLState::BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	GLsizei blockBytes = format == TextureFile::BC1 ? 8 : 16;
+	for (GLint level = 0; level <= maxLevel(); level++)
+	{
+		GLsizei size = std::max(1, layerSize >> level);
+		if (format == TextureFile::RGBA8)
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, size, size, layersPerPage, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		else
+		{
+			GLsizei blocks = ((size + 3) / 4) * ((size + 3) / 4);
+			glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, TextureFile::InternalFormat(format), size, size, layersPerPage, 0, blocks * blockBytes * layersPerPage, NULL);
+		}
+	}
+	GLState::ActiveTexture(GL_TEXTURE0);
+
+	pages.push_back(page);
+	layers.resize(layers.size() + layersPerPage);
+}
+
+// Highest mip level of the pages
+GLint TextureAtlas::maxLevel() const
+{
+	GLint level = 0;
+	while ((minimumSlot >> (level + 1)) > 0)
+		level++;
+	return format == TextureFile::RGBA8 ? level : std::max(0, level - 2);
+}
@@ -0,0 +1,85 @@
+#ifndef TEXTURE_ATLAS_CLASS_H
+#define TEXTURE_ATLAS_CLASS_H
+
+#include<glad/glad.h>
+#include<glm/glm.hpp>
+#include<vector>
+
+#include"TextureFile.h"
+
+// Binding point of the AtlasSlots block, Shader links every program's block to it
+const GLuint ATLAS_SLOTS_BINDING = 1;
+// Texture unit the atlas sampler reads from, Shader points every program's atlas uniform at it
+const GLuint ATLAS_TEXTURE_UNIT = 1;
+// Slots the AtlasSlots block holds, ShaderLibrary passes it to the shaders as a define
+const int MAX_ATLAS_SLOTS = 512;
+
+// Packs textures of one format into the layers of GL_TEXTURE_2D_ARRAY pages, so draws that differ only
+// in texture can share one bind and one multi draw. A texture gets a power of two slot on a shelf of
+// a layer, and draws pass just the slot index (attribute 8). The shader looks the slot's rectangle and
+// layer up in the AtlasSlots uniform block and repeats the texture inside the rectangle.
+// Make one atlas per format
+class TextureAtlas
+{
+public:
+	// Where a texture was packed, rect is the offset (xy) and scale (zw) of its texture coordinates
+	struct Slot
+	{
+		int page;
+		int layer;
+		glm::vec4 rect;
+	};
+
+	TextureFile::Format format;
+	GLsizei layerSize;
+	GLsizei layersPerPage;
+	// Smallest slot side, slots are aligned to their size so every mip level down to
+	// log2(minimumSlot) stays whole (and block aligned when compressed)
+	GLsizei minimumSlot = 16;
+	// Array texture of each page
+	std::vector<GLuint> pages;
+	// Indexed by slot index
+	std::vector<Slot> slots;
+	// Bytes uploaded into the pages
+	size_t bytesUploaded = 0;
+
+	// Constructor for an empty atlas, pages are added as textures need them
+	TextureAtlas(TextureFile::Format format, GLsizei layerSize = 512, GLsizei layersPerPage = 4);
+
+	// Uploads a texture into a free slot and returns its index, -1 when it is of another format,
+	// larger than a layer, not whole 4x4 blocks when compressed, or every slot is taken
+	int Add(const TextureFile& file);
+	// Binds a page to ATLAS_TEXTURE_UNIT and the slot table to ATLAS_SLOTS_BINDING
+	void Bind(int page);
+	// Deletes every page and the slot table
+	void Delete();
+
+private:
+	// A row of equally tall slots, filled left to right
+	struct Shelf
+	{
+		GLsizei y;
+		GLsizei height;
+		GLsizei x;
+	};
+	// Shelves of one layer, stacked from the bottom
+	struct Layer
+	{
+		std::vector<Shelf> shelves;
+		GLsizei top = 0;
+	};
+	std::vector<Layer> layers;
+	GLuint slotBuffer = 0;
+	// Rectangle of every slot, then its layer in component index % 4 of entry index / 4, like the std140 block
+	std::vector<glm::vec4> slotRects;
+	std::vector<glm::vec4> slotLayers;
+
+	// Finds room for a slot, adding a page when every layer is full
+	bool allocate(GLsizei width, GLsizei height, int& layer, GLsizei& x, GLsizei& y);
+	// Creates the array texture of a new page with room for every level
+	void addPage();
+	// Highest mip level of the pages
+	GLint maxLevel() const;
+};
+
+#endif
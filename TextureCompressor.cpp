@@ -0,0 +1,486 @@
+#include"TextureCompressor.h"
+
+#include<algorithm>
+#include<chrono>
+#include<cmath>
+#include<cstdint>
+#include<cstring>
+#include<glm/glm.hpp>
+
+#include"Hash.h"
+#include"JobSystem.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include<emmintrin.h>
+#define TEXTURE_COMPRESSOR_SSE2
+#endif
+
+namespace
+{
+	// bumped whenever an encoder changes so stale cache files are not picked up
+	const uint64_t ENCODER_VERSION = 2;
+
+	// 4x4 texels split into channels so four texels at a time fit an SSE register
+	struct Block
+	{
+		alignas(16) float channel[4][16];
+	};
+
+	// BC7 4 bit index weights out of 64
+	const int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	void loadBlock(const unsigned char* rgba, int width, int height, int blockX, int blockY, Block& block)
+	{
+		for (int y = 0; y < 4; y++)
+			for (int x = 0; x < 4; x++)
+			{
+				int sx = std::min(blockX * 4 + x, width - 1);
+				int sy = std::min(blockY * 4 + y, height - 1);
+				const unsigned char* texel = rgba + ((size_t)sy * width + sx) * 4;
+				for (int k = 0; k < 4; k++)
+					block.channel[k][y * 4 + x] = texel[k];
+			}
+	}
+
+	glm::vec4 texel(const Block& block, int i)
+	{
+		return glm::vec4(block.channel[0][i], block.channel[1][i], block.channel[2][i], block.channel[3][i]);
+	}
+
+	// Picks the closest palette entry for every texel, returns the summed squared error.
+	// channels is 3 to ignore alpha
+	float nearest(const Block& block, const glm::vec4* palette, int paletteSize, int channels, uint8_t indices[16])
+	{
+		float total = 0.0f;
+#ifdef TEXTURE_COMPRESSOR_SSE2
+		for (int i = 0; i < 16; i += 4)
+		{
+			__m128 c[4];
+			for (int k = 0; k < channels; k++)
+				c[k] = _mm_load_ps(&block.channel[k][i]);
+			__m128 best = _mm_set1_ps(1e30f);
+			__m128i bestIndex = _mm_setzero_si128();
+			for (int p = 0; p < paletteSize; p++)
+			{
+				__m128 distance = _mm_setzero_ps();
+				for (int k = 0; k < channels; k++)
+				{
+					__m128 d = _mm_sub_ps(c[k], _mm_set1_ps(palette[p][k]));
+					distance = _mm_add_ps(distance, _mm_mul_ps(d, d));
+				}
+				__m128 closer = _mm_cmplt_ps(distance, best);
+				best = _mm_min_ps(distance, best);
+				__m128i mask = _mm_castps_si128(closer);
+				bestIndex = _mm_or_si128(_mm_and_si128(mask, _mm_set1_epi32(p)), _mm_andnot_si128(mask, bestIndex));
+			}
+			alignas(16) float errors[4];
+			alignas(16) int32_t chosen[4];
+			_mm_store_ps(errors, best);
+			_mm_store_si128((__m128i*)chosen, bestIndex);
+			for (int k = 0; k < 4; k++)
+			{
+				indices[i + k] = (uint8_t)chosen[k];
+				total += errors[k];
+			}
+		}
+#else
+		for (int i = 0; i < 16; i++)
+		{
+			float best = 1e30f;
+			for (int p = 0; p < paletteSize; p++)
+			{
+				float distance = 0.0f;
+				for (int k = 0; k < channels; k++)
+				{
+					float d = block.channel[k][i] - palette[p][k];
+					distance += d * d;
+				}
+				if (distance < best)
+				{
+					best = distance;
+					indices[i] = (uint8_t)p;
+				}
+			}
+			total += best;
+		}
+#endif
+		return total;
+	}
+
+	// Ends of the segment along the principal axis of the texels that covers all of them
+	void principalRange(const Block& block, int channels, glm::vec4& low, glm::vec4& high)
+	{
+		glm::vec4 mean(0.0f), lo(255.0f), hi(0.0f);
+		for (int i = 0; i < 16; i++)
+		{
+			glm::vec4 t = texel(block, i);
+			mean += t;
+			lo = glm::min(lo, t);
+			hi = glm::max(hi, t);
+		}
+		mean /= 16.0f;
+		if (channels == 3)
+		{
+			mean.a = lo.a = hi.a = 255.0f;
+		}
+
+		glm::mat4 covariance(0.0f);
+		for (int i = 0; i < 16; i++)
+		{
+			glm::vec4 d = texel(block, i) - mean;
+			if (channels == 3)
+				d.a = 0.0f;
+			for (int row = 0; row < 4; row++)
+				covariance[row] += d * d[row];
+		}
+
+		// power iteration from the bounding box diagonal, turned to follow the strongest correlation
+		glm::vec4 axis = hi - lo;
+		if (channels == 3)
+			axis.a = 0.0f;
+		if (glm::dot(axis, axis) < 1e-6f)
+		{
+			low = high = mean;
+			return;
+		}
+		for (int iteration = 0; iteration < 8; iteration++)
+		{
+			glm::vec4 next = covariance * axis;
+			float length = glm::length(next);
+			if (length < 1e-6f)
+				break;
+			axis = next / length;
+		}
+		axis = glm::normalize(axis);
+
+		float tMin = 1e30f, tMax = -1e30f;
+		for (int i = 0; i < 16; i++)
+		{
+			float t = glm::dot(texel(block, i) - mean, axis);
+			tMin = std::min(tMin, t);
+			tMax = std::max(tMax, t);
+		}
+		low = glm::clamp(mean + axis * tMin, glm::vec4(0.0f), glm::vec4(255.0f));
+		high = glm::clamp(mean + axis * tMax, glm::vec4(0.0f), glm::vec4(255.0f));
+	}
+
+	// Least squares endpoints for texels placed at weight t between start and end, false when
+	// every texel sits on the same weight
+	bool fitEndpoints(const Block& block, const float weights[16], glm::vec4& start, glm::vec4& end)
+	{
+		float a = 0.0f, b = 0.0f, c = 0.0f;
+		glm::vec4 startSum(0.0f), endSum(0.0f);
+		for (int i = 0; i < 16; i++)
+		{
+			float t = weights[i];
+			a += (1.0f - t) * (1.0f - t);
+			b += t * (1.0f - t);
+			c += t * t;
+			startSum += texel(block, i) * (1.0f - t);
+			endSum += texel(block, i) * t;
+		}
+		float determinant = a * c - b * b;
+		if (std::fabs(determinant) < 1e-6f)
+			return false;
+		start = glm::clamp((startSum * c - endSum * b) / determinant, glm::vec4(0.0f), glm::vec4(255.0f));
+		end = glm::clamp((endSum * a - startSum * b) / determinant, glm::vec4(0.0f), glm::vec4(255.0f));
+		return true;
+	}
+
+	uint16_t to565(const glm::vec4& color)
+	{
+		int r = (int)std::lround(color.r * 31.0f / 255.0f);
+		int g = (int)std::lround(color.g * 63.0f / 255.0f);
+		int b = (int)std::lround(color.b * 31.0f / 255.0f);
+		return (uint16_t)((r << 11) | (g << 5) | b);
+	}
+
+	glm::vec4 from565(uint16_t color)
+	{
+		int r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+		return glm::vec4((float)((r << 3) | (r >> 2)), (float)((g << 2) | (g >> 4)), (float)((b << 3) | (b >> 2)), 255.0f);
+	}
+
+	// BC1 color block in four color mode, which BC3 requires
+	void encodeColor(const Block& block, unsigned char* out)
+	{
+		// palette positions of the indices, 0 is the first endpoint and 1 the second
+		const float positions[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+		glm::vec4 low, high;
+		principalRange(block, 3, low, high);
+
+		float bestError = 1e30f;
+		uint16_t bestColors[2] = { 0, 0 };
+		uint8_t bestIndices[16] = {};
+		for (int iteration = 0; iteration < 3; iteration++)
+		{
+			uint16_t c0 = to565(high), c1 = to565(low);
+			if (c0 < c1)
+				std::swap(c0, c1);
+
+			uint8_t indices[16] = {};
+			float error;
+			if (c0 == c1)
+			{
+				// one color, every index picks the first endpoint
+				glm::vec4 color = from565(c0);
+				error = 0.0f;
+				for (int i = 0; i < 16; i++)
+					for (int k = 0; k < 3; k++)
+						error += (block.channel[k][i] - color[k]) * (block.channel[k][i] - color[k]);
+			}
+			else
+			{
+				glm::vec4 e0 = from565(c0), e1 = from565(c1);
+				glm::vec4 palette[4] = { e0, e1, (e0 * 2.0f + e1) / 3.0f, (e0 + e1 * 2.0f) / 3.0f };
+				error = nearest(block, palette, 4, 3, indices);
+			}
+			if (error < bestError)
+			{
+				bestError = error;
+				bestColors[0] = c0;
+				bestColors[1] = c1;
+				std::memcpy(bestIndices, indices, 16);
+			}
+			if (c0 == c1 || error == 0.0f)
+				break;
+
+			float weights[16];
+			for (int i = 0; i < 16; i++)
+				weights[i] = positions[indices[i]];
+			if (!fitEndpoints(block, weights, high, low))
+				break;
+		}
+
+		out[0] = (unsigned char)(bestColors[0] & 0xFF);
+		out[1] = (unsigned char)(bestColors[0] >> 8);
+		out[2] = (unsigned char)(bestColors[1] & 0xFF);
+		out[3] = (unsigned char)(bestColors[1] >> 8);
+		uint32_t bits = 0;
+		for (int i = 0; i < 16; i++)
+			bits |= (uint32_t)bestIndices[i] << (2 * i);
+		for (int k = 0; k < 4; k++)
+			out[4 + k] = (unsigned char)(bits >> (8 * k));
+	}
+
+	// BC3 alpha block in eight value mode between the smallest and largest alpha
+	void encodeAlpha(const Block& block, unsigned char* out)
+	{
+		float lo = 255.0f, hi = 0.0f;
+		for (int i = 0; i < 16; i++)
+		{
+			lo = std::min(lo, block.channel[3][i]);
+			hi = std::max(hi, block.channel[3][i]);
+		}
+		int a0 = (int)hi, a1 = (int)lo;
+		out[0] = (unsigned char)a0;
+		out[1] = (unsigned char)a1;
+
+		uint64_t bits = 0;
+		if (a0 > a1)
+		{
+			// steps from a0 to a1 in sevenths, index 0 is a0, 1 is a1 and 2 to 7 are the steps between
+			for (int i = 0; i < 16; i++)
+			{
+				int step = (int)std::lround((a0 - block.channel[3][i]) * 7.0f / (a0 - a1));
+				step = std::min(std::max(step, 0), 7);
+				uint64_t index = step == 0 ? 0 : step == 7 ? 1 : (uint64_t)step + 1;
+				bits |= index << (3 * i);
+			}
+		}
+		for (int k = 0; k < 6; k++)
+			out[2 + k] = (unsigned char)(bits >> (8 * k));
+	}
+
+	void putBits(unsigned char* out, int& position, uint32_t value, int count)
+	{
+		for (int i = 0; i < count; i++, position++)
+			if (value & (1u << i))
+				out[position >> 3] |= (unsigned char)(1u << (position & 7));
+	}
+
+	// BC7 mode 6: one subset, 7 bit RGBA endpoints with a shared low bit each and 4 bit indices
+	void encodeBC7(const Block& block, unsigned char* out)
+	{
+		glm::vec4 low, high;
+		principalRange(block, 4, low, high);
+
+		float bestError = 1e30f;
+		int bestEndpoints[2][4] = {};
+		int bestParity[2] = { 0, 0 };
+		uint8_t bestIndices[16] = {};
+		for (int iteration = 0; iteration < 2; iteration++)
+		{
+			uint8_t lastIndices[16] = {};
+			float lastError = 1e30f;
+			for (int parity = 0; parity < 4; parity++)
+			{
+				int p[2] = { parity & 1, parity >> 1 };
+				int endpoints[2][4];
+				glm::vec4 decoded[2];
+				const glm::vec4* source[2] = { &low, &high };
+				for (int e = 0; e < 2; e++)
+					for (int k = 0; k < 4; k++)
+					{
+						endpoints[e][k] = std::min(std::max((int)std::lround(((*source[e])[k] - p[e]) / 2.0f), 0), 127);
+						decoded[e][k] = (float)(endpoints[e][k] * 2 + p[e]);
+					}
+
+				glm::vec4 palette[16];
+				for (int w = 0; w < 16; w++)
+					palette[w] = glm::floor((decoded[0] * (float)(64 - BC7_WEIGHTS[w]) + decoded[1] * (float)BC7_WEIGHTS[w] + 32.0f) / 64.0f);
+				uint8_t indices[16];
+				float error = nearest(block, palette, 16, 4, indices);
+				if (error < bestError)
+				{
+					bestError = error;
+					std::memcpy(bestEndpoints, endpoints, sizeof(endpoints));
+					bestParity[0] = p[0];
+					bestParity[1] = p[1];
+					std::memcpy(bestIndices, indices, 16);
+				}
+				if (error < lastError)
+				{
+					lastError = error;
+					std::memcpy(lastIndices, indices, 16);
+				}
+			}
+			if (bestError == 0.0f)
+				break;
+
+			float weights[16];
+			for (int i = 0; i < 16; i++)
+				weights[i] = BC7_WEIGHTS[lastIndices[i]] / 64.0f;
+			if (!fitEndpoints(block, weights, low, high))
+				break;
+		}
+
+		// the first index is stored with 3 bits, so its top bit has to be 0
+		if (bestIndices[0] >= 8)
+		{
+			for (int k = 0; k < 4; k++)
+				std::swap(bestEndpoints[0][k], bestEndpoints[1][k]);
+			std::swap(bestParity[0], bestParity[1]);
+			for (int i = 0; i < 16; i++)
+				bestIndices[i] = (uint8_t)(15 - bestIndices[i]);
+		}
+
+		std::memset(out, 0, 16);
+		int position = 0;
+		putBits(out, position, 1u << 6, 7);
+		for (int k = 0; k < 4; k++)
+		{
+			putBits(out, position, (uint32_t)bestEndpoints[0][k], 7);
+			putBits(out, position, (uint32_t)bestEndpoints[1][k], 7);
+		}
+		putBits(out, position, (uint32_t)bestParity[0], 1);
+		putBits(out, position, (uint32_t)bestParity[1], 1);
+		putBits(out, position, bestIndices[0], 3);
+		for (int i = 1; i < 16; i++)
+			putBits(out, position, bestIndices[i], 4);
+	}
+}
+
+// Builds the mip chain and encodes every level, RGBA8 keeps the chain uncompressed
+TextureFile TextureCompressor::Compress(const Image& image, TextureFile::Format format, bool useCache)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	TextureFile result;
+
+	uint64_t key = hash_bytes(image.pixels.data(), image.pixels.size());
+	uint64_t settings[7] = { ENCODER_VERSION, (uint64_t)image.width, (uint64_t)image.height, (uint64_t)image.channels, (uint64_t)format, (uint64_t)mips.filter, (uint64_t)mips.srgb };
+	key = hash_bytes(settings, sizeof(settings), key);
+	std::string cacheFile = cacheDirectory + "/" + hash_to_hex(key) + ".tex";
+
+	cacheHit = useCache && result.Read(cacheFile) && result.format == format;
+	size_t texels = 0;
+	if (!cacheHit)
+	{
+		mips.threadCount = threadCount;
+		std::vector<Image> chain = mips.Build(image);
+		result.format = format;
+		result.levels.clear();
+		for (Image& mip : chain)
+		{
+			TextureFile::Level level;
+			level.width = mip.width;
+			level.height = mip.height;
+			if (format == TextureFile::RGBA8)
+				level.data.swap(mip.pixels);
+			else
+			{
+				level.data.resize((size_t)((mip.width + 3) / 4) * ((mip.height + 3) / 4) * BlockBytes(format));
+				EncodeLevel(mip.pixels.data(), mip.width, mip.height, format, level.data.data());
+			}
+			texels += (size_t)mip.width * mip.height;
+			result.levels.push_back(std::move(level));
+		}
+		if (useCache)
+			result.Write(cacheFile);
+	}
+
+	uncompressedBytes = 0;
+	for (TextureFile::Level& level : result.levels)
+		uncompressedBytes += (size_t)level.width * level.height * 4;
+	compressedBytes = result.Bytes();
+	seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	megapixelsPerSecond = !cacheHit && seconds > 0.0 ? texels / seconds / 1e6 : 0.0;
+	return result;
+}
+
+// Encodes one RGBA image of width by height texels into blocks, edge blocks repeat the last texel
+void TextureCompressor::EncodeLevel(const unsigned char* rgba, int width, int height, TextureFile::Format format, unsigned char* blocks)
+{
+	int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+	size_t blockBytes = BlockBytes(format);
+	// small levels are not worth waking workers for
+	unsigned threads = std::max(1, blocksX * blocksY / 64);
+	if (threadCount > 0)
+		threads = std::min(threads, threadCount);
+
+	// block rows go out in ranges that shrink towards the end so uneven rows do not leave threads idle
+	JobSystem::Shared().ParallelFor((size_t)blocksY, 1, [&](size_t firstRow, size_t lastRow)
+	{
+		Block block;
+		for (int by = (int)firstRow; by < (int)lastRow; by++)
+			for (int bx = 0; bx < blocksX; bx++)
+			{
+				loadBlock(rgba, width, height, bx, by, block);
+				unsigned char* out = blocks + ((size_t)by * blocksX + bx) * blockBytes;
+				switch (format)
+				{
+				case TextureFile::BC1:
+					encodeColor(block, out);
+					break;
+				case TextureFile::BC3:
+					encodeAlpha(block, out);
+					encodeColor(block, out + 8);
+					break;
+				case TextureFile::BC7:
+					encodeBC7(block, out);
+					break;
+				default:
+					break;
+				}
+			}
+	}, threads);
+}
+
+// BC7 when the driver has it, otherwise BC3 for images with alpha and BC1 for the rest
+TextureFile::Format TextureCompressor::Choose(const Image& image, bool bc7Supported)
+{
+	if (bc7Supported)
+		return TextureFile::BC7;
+	if (image.channels == 2 || image.channels == 4)
+		for (size_t i = image.channels - 1; i < image.pixels.size(); i += image.channels)
+			if (image.pixels[i] != 255)
+				return TextureFile::BC3;
+	return TextureFile::BC1;
+}
+
+// Bytes of one 4x4 block
+size_t TextureCompressor::BlockBytes(TextureFile::Format format)
+{
+	return format == TextureFile::BC1 ? 8 : 16;
+}
@@ -0,0 +1,99 @@
+#include"TextureFile.h"
+
+#include<cstdint>
+#include<filesystem>
+#include<fstream>
+
+#include"GLExtensions.h"
+
+namespace
+{
+	const uint32_t MAGIC = 0x58455454; // "TTEX"
+	// bumped whenever the layout changes
+	const uint32_t VERSION = 1;
+}
+
+// Reads a container, false when it is missing, damaged or from an older layout
+bool TextureFile::Read(const std::string& filename)
+{
+	std::ifstream in(filename, std::ios::binary);
+	uint32_t header[4] = {};
+	if (!in || !in.read((char*)header, sizeof(header)) || header[0] != MAGIC || header[1] != VERSION || header[2] > BC7)
+		return false;
+	format = (Format)header[2];
+	levels.resize(header[3]);
+	for (Level& level : levels)
+	{
+		uint32_t size[3] = {};
+		if (!in.read((char*)size, sizeof(size)))
+			return false;
+		level.width = (int)size[0];
+		level.height = (int)size[1];
+		level.data.resize(size[2]);
+		if (!in.read((char*)level.data.data(), size[2]))
+			return false;
+	}
+	return !levels.empty();
+}
+
+// Writes next to the final name and renames, so a crash never leaves half a file behind
+bool TextureFile::Write(const std::string& filename) const
+{
+	std::error_code error;
+	std::filesystem::path path(filename);
+	if (path.has_parent_path())
+		std::filesystem::create_directories(path.parent_path(), error);
+	std::string temporary = filename + ".tmp";
+	{
+		std::ofstream out(temporary, std::ios::binary);
+		uint32_t header[4] = { MAGIC, VERSION, (uint32_t)format, (uint32_t)levels.size() };
+		out.write((const char*)header, sizeof(header));
+		for (const Level& level : levels)
+		{
+			uint32_t size[3] = { (uint32_t)level.width, (uint32_t)level.height, (uint32_t)level.data.size() };
+			out.write((const char*)size, sizeof(size));
+			out.write((const char*)level.data.data(), level.data.size());
+		}
+		if (!out)
+			return false;
+	}
+	std::filesystem::rename(temporary, filename, error);
+	return !error;
+}
+
+// Bytes over every level
+size_t TextureFile::Bytes() const
+{
+	size_t bytes = 0;
+	for (const Level& level : levels)
+		bytes += level.data.size();
+	return bytes;
+}
+
+bool TextureFile::Compressed() const
+{
+	return format != RGBA8;
+}
+
+// The GL internal format to upload with
+GLenum TextureFile::InternalFormat(Format format)
+{
+	switch (format)
+	{
+	case BC1: return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+	case BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	case BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+	default: return GL_RGBA8;
+	}
+}
+
+const char* TextureFile::Name(Format format)
+{
+	switch (format)
+	{
+	case BC1: return "BC1";
+	case BC3: return "BC3";
+	case BC7: return "BC7";
+	default: return "RGBA8";
+	}
+}
@@ -0,0 +1,49 @@
+#ifndef TEXTURE_FILE_CLASS_H
+#define TEXTURE_FILE_CLASS_H
+
+#include<glad/glad.h>
+#include<string>
+#include<vector>
+
+// A texture with its whole mip chain, ready to upload level by level, and the container it is cached in.
+// The file is a small header followed by every level's size and bytes, smallest level last
+class TextureFile
+{
+public:
+	enum Format
+	{
+		// 4 bytes per texel, uncompressed
+		RGBA8,
+		// 8 bytes per 4x4 block, RGB with no alpha
+		BC1,
+		// 16 bytes per block, BC1 color with a separate alpha block
+		BC3,
+		// 16 bytes per block, best quality for color and alpha
+		BC7
+	};
+
+	// One mip level, rows or rows of blocks run from the bottom of the image like the texture
+	struct Level
+	{
+		int width;
+		int height;
+		std::vector<unsigned char> data;
+	};
+
+	Format format = RGBA8;
+	std::vector<Level> levels;
+
+	// Reads a container, false when it is missing, damaged or from an older layout
+	bool Read(const std::string& filename);
+	// Writes next to the final name and renames, so a crash never leaves half a file behind
+	bool Write(const std::string& filename) const;
+
+	// Bytes over every level
+	size_t Bytes() const;
+	bool Compressed() const;
+	// The GL internal format to upload with
+	static GLenum InternalFormat(Format format);
+	static const char* Name(Format format);
+};
+
+#endif
@@ -0,0 +1,294 @@
+#include"TextureLoader.h"
+
+#include<algorithm>
+#include<chrono>
+#include<cstring>
+
+#include"GLResources.h"
+#include"GLState.h"
+
+// Constructor that creates the upload buffer, decodes run on JobSystem::Shared()
+TextureLoader::TextureLoader()
+	: pixels(GL_PIXEL_UNPACK_BUFFER, 4 << 20)
+{
+	// the pixel buffer has to stay unbound outside Update, a bound one turns client pointers into offsets
+	GLState::BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+// Waits for the decode jobs, textures still in flight keep their placeholder
+TextureLoader::~TextureLoader()
+{
+	stopping = true;
+	// the jobs point at this loader
+	JobSystem::Shared().Wait(jobs);
+}
+
+// Returns a placeholder texture right away, its contents are swapped in once the file is uploaded
+std::shared_ptr<Texture> TextureLoader::Load(const char* filename, const TextureSampler& sampler)
+{
+	// the content is hashed by the decode job, reading the whole file here would stall the GL thread
+	uint64_t key = TextureRegistry::PathKey(filename, compress, sampler);
+	if (std::shared_ptr<Texture> shared = registry.Find(key))
+	{
+		registry.hits++;
+		return shared;
+	}
+	registry.misses++;
+
+	// grey checkerboard, with the nearest filter every texture unit repeat shows as four squares
+	const unsigned char checker[16] =
+	{
+		200, 200, 200, 255,   120, 120, 120, 255,
+		120, 120, 120, 255,   200, 200, 200, 255
+	};
+	std::shared_ptr<Texture> texture = std::make_shared<Texture>(checker, 2, 2, GL_TEXTURE_2D, GL_TEXTURE0, GL_RGBA, GL_UNSIGNED_BYTE, filename);
+	registry.Insert(key, texture);
+
+	Request request{ filename, key, texture, NULL, sampler, false };
+	JobSystem::Shared().Run([this, request]() mutable { decode(std::move(request)); }, &jobs);
+	return texture;
+}
+
+// Uploads decoded images within the frame budget, call once per frame on the GL thread
+void TextureLoader::Update()
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// a texture nobody holds any more frees its budget
+	for (size_t i = 0; i < tracked.size();)
+	{
+		if (tracked[i].first.expired())
+		{
+			residency->Untrack(tracked[i].second);
+			tracked[i] = tracked.back();
+			tracked.pop_back();
+		}
+		else
+			i++;
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		while (!decoded.empty())
+		{
+			Request request = std::move(decoded.front());
+			decoded.pop_front();
+			if (request.failed)
+			{
+				// the placeholder stays, which is easier to spot than a missing material
+				texturesFailed++;
+				continue;
+			}
+			uploads.push_back(Upload{ std::move(request), 0, 0, 0 });
+		}
+	}
+	if (uploads.empty())
+		return;
+
+	// at least one row of every level, or one compressed level, has to fit or the upload would never move
+	GLsizeiptr budget = bytesPerFrame;
+	for (Upload& upload : uploads)
+	{
+		const TextureFile::Level& largest = upload.request.file->levels[0];
+		budget = std::max(budget, upload.request.file->Compressed() ? (GLsizeiptr)largest.data.size() : (GLsizeiptr)largest.width * 4);
+	}
+	pixels.Reserve(budget);
+	pixels.Bind();
+	GLState::ActiveTexture(GL_TEXTURE0);
+
+	while (!uploads.empty() && budget > 0)
+	{
+		Upload& upload = uploads.front();
+		// nobody holds the texture any more, the upload would go nowhere
+		if (upload.request.texture.use_count() == 1)
+		{
+			if (upload.texture != 0)
+				GLResources::Release(GLResources::TEXTURE, upload.texture);
+			uploads.pop_front();
+			continue;
+		}
+		if (upload.texture == 0)
+			startUpload(upload);
+		const TextureFile& file = *upload.request.file;
+		const TextureFile::Level& level = file.levels[upload.nextLevel];
+
+		GLState::BindTexture(GL_TEXTURE_2D, upload.texture);
+		if (file.Compressed())
+		{
+			// block compressed levels go whole, starting with the largest
+			GLsizeiptr levelBytes = (GLsizeiptr)level.data.size();
+			StreamBuffer::Allocation allocation = pixels.Allocate(levelBytes, 16);
+			// the segment is full, the rest waits for the next frame
+			if (allocation.pointer == NULL)
+				break;
+			std::memcpy(allocation.pointer, level.data.data(), levelBytes);
+			pixels.Commit(allocation);
+			glCompressedTexImage2D(GL_TEXTURE_2D, upload.nextLevel, TextureFile::InternalFormat(file.format), level.width, level.height, 0, (GLsizei)levelBytes, (void*)allocation.offset);
+			upload.nextLevel++;
+			budget -= levelBytes;
+			bytesUploaded += levelBytes;
+		}
+		else
+		{
+			GLsizeiptr rowBytes = (GLsizeiptr)level.width * 4;
+			int rows = (int)std::min<GLsizeiptr>(level.height - upload.nextRow, std::max<GLsizeiptr>(1, budget / rowBytes));
+			StreamBuffer::Allocation allocation = pixels.Allocate(rows * rowBytes, 4);
+			if (allocation.pointer == NULL)
+				break;
+			std::memcpy(allocation.pointer, level.data.data() + upload.nextRow * rowBytes, rows * rowBytes);
+			pixels.Commit(allocation);
+
+			// rows are stored bottom up like the texture, so they go in at the same row index
+			glTexSubImage2D(GL_TEXTURE_2D, upload.nextLevel, 0, upload.nextRow, level.width, rows, GL_RGBA, GL_UNSIGNED_BYTE, (void*)allocation.offset);
+			upload.nextRow += rows;
+			budget -= rows * rowBytes;
+			bytesUploaded += rows * rowBytes;
+			if (upload.nextRow >= level.height)
+			{
+				upload.nextLevel++;
+				upload.nextRow = 0;
+			}
+		}
+		bool done = upload.nextLevel >= (int)file.levels.size();
+
+		if (done)
+		{
+			finishUpload(upload);
+			uploads.pop_front();
+		}
+		if (std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() > millisecondsPerFrame)
+			break;
+	}
+
+	GLState::BindTexture(GL_TEXTURE_2D, 0);
+	GLState::BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	pixels.EndFrame();
+	uploadMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// True while decoded images wait for or are in their upload
+bool TextureLoader::Uploading()
+{
+	if (!uploads.empty())
+		return true;
+	std::lock_guard<std::mutex> guard(lock);
+	return !decoded.empty();
+}
+
+// Drops the decodes that have not started, waits for the rest and releases the upload buffer
+void TextureLoader::Delete()
+{
+	stopping = true;
+	JobSystem::Shared().Wait(jobs);
+	for (Upload& upload : uploads)
+		if (upload.texture != 0)
+			GLResources::Release(GLResources::TEXTURE, upload.texture);
+	uploads.clear();
+	pixels.Delete();
+}
+
+// Decodes one file, runs as a job
+void TextureLoader::decode(Request request)
+{
+	if (stopping)
+		return;
+
+	// once the content is known a texture made from the same image under another name takes over
+	// this name, the placeholder is still filled from the shared decode for whoever holds it
+	{
+		uint64_t key = registry.Key(request.filename, compress, request.sampler);
+		std::shared_ptr<Texture> shared = registry.Merge(key, request.texture);
+		if (shared != request.texture)
+			registry.Insert(request.pathKey, shared);
+	}
+
+	// Image flips with the thread local stb flag, so jobs never touch each other's setting. The
+	// chain is built here too, off the GL thread. A job asking for an image another is decoding
+	// ends right away, that decode queues this request along with its own
+	registry.Decode(request.filename, compress, [this, request](std::shared_ptr<const TextureFile> file) mutable
+	{
+		request.file = file;
+		request.failed = file == NULL;
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			decoded.push_back(std::move(request));
+		}
+		if (redraw != NULL)
+			redraw->Invalidate(RedrawTracker::LOADING);
+	});
+}
+
+// Creates the destination texture for a decoded image
+void TextureLoader::startUpload(Upload& upload)
+{
+	Request& request = upload.request;
+	glGenTextures(1, &upload.texture);
+	GLResources::Track(GLResources::TEXTURE, upload.texture, request.filename);
+	GLState::BindTexture(GL_TEXTURE_2D, upload.texture);
+	TextureRegistry::ApplySampler(GL_TEXTURE_2D, request.sampler);
+	// the chain stops where the generator stopped, nothing is left for the driver to fill in
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)request.file->levels.size() - 1);
+	if (request.file->Compressed())
+		return;
+
+	// storage only, the rows arrive over the next frames. A NULL pointer would be read as an offset
+	// into the bound pixel buffer, so it is unbound for these calls
+	GLState::BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	for (const TextureFile::Level& level : request.file->levels)
+		glTexImage2D(GL_TEXTURE_2D, (GLint)(&level - request.file->levels.data()), GL_RGBA, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	pixels.Bind();
+}
+
+// Moves the finished texture into the Texture the caller holds
+void TextureLoader::finishUpload(Upload& upload)
+{
+	Texture& texture = *upload.request.texture;
+	texture.Replace(upload.texture);
+	upload.texture = 0;
+
+	// a restore after an eviction is not a new texture
+	if (residency != NULL && texture.residency != ResidencyManager::NONE)
+		residency->Restored(texture.residency);
+	else
+	{
+		texturesLoaded++;
+		if (upload.request.file->Compressed())
+		{
+			texturesCompressed++;
+			// against the same chain in RGBA8
+			for (const TextureFile::Level& level : upload.request.file->levels)
+				bytesSaved += (unsigned long long)level.width * level.height * 4;
+			bytesSaved -= upload.request.file->Bytes();
+		}
+	}
+	if (residency != NULL && texture.residency == ResidencyManager::NONE)
+	{
+		// evicting drops the GL texture, draws skip it until the kept chain is uploaded again
+		std::weak_ptr<Texture> weak = upload.request.texture;
+		std::string filename = upload.request.filename;
+		std::shared_ptr<const TextureFile> copy = upload.request.file;
+		TextureSampler sampler = upload.request.sampler;
+		texture.residency = residency->Track(filename, copy->Bytes(),
+			[weak]()
+			{
+				if (std::shared_ptr<Texture> held = weak.lock())
+					held->Replace(0);
+			},
+			[this, weak, filename, copy, sampler]()
+			{
+				std::shared_ptr<Texture> held = weak.lock();
+				if (held == NULL)
+					return true;
+				reupload(held, filename, copy, sampler);
+				return false;
+			});
+		tracked.push_back(std::make_pair(weak, texture.residency));
+	}
+}
+
+// Queues a chain that is already decoded, for restoring an evicted texture
+void TextureLoader::reupload(std::shared_ptr<Texture> texture, const std::string& filename, std::shared_ptr<const TextureFile> file, const TextureSampler& sampler)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	decoded.push_back(Request{ filename, 0, texture, file, sampler, false });
+}
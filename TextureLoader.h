@@ -0,0 +1,110 @@
+#ifndef TEXTURE_LOADER_CLASS_H
+#define TEXTURE_LOADER_CLASS_H
+
+#include<glad/glad.h>
+#include<deque>
+#include<memory>
+#include<mutex>
+#include<string>
+#include<vector>
+
+#include"Image.h"
+#include"JobSystem.h"
+#include"RedrawTracker.h"
+#include"ResidencyManager.h"
+#include"StreamBuffer.h"
+#include"Texture.h"
+#include"TextureRegistry.h"
+
+// Loads textures without stalling the frame. Files are decoded as jobs on the shared JobSystem, which also build
+// the mip chain and, where the driver supports it, block compress it (both cached on disk by
+// TextureCompressor). The levels are copied into a pixel unpack ring buffer a few rows at a time
+// each frame, so one large image is spread over several frames. The returned texture shows a
+// checkerboard until its upload is complete
+class TextureLoader
+{
+public:
+	// Bytes copied to the GPU per Update, and time after which Update stops early
+	GLsizeiptr bytesPerFrame = 4 << 20;
+	double millisecondsPerFrame = 2.0;
+	// Encode to BC7, or BC3/BC1 without BC7 support, when the driver can sample them. Otherwise the chain stays RGBA8
+	bool compress = true;
+	// When set, every loaded texture is tracked in it. The mip chain stays in memory, so an evicted
+	// texture is uploaded again over the next frames without decoding the file
+	ResidencyManager* residency = NULL;
+	// When set, a finished decode asks it for a frame, uploads only move on frames that are drawn
+	RedrawTracker* redraw = NULL;
+	// Shares textures and decodes between loads of the same image
+	TextureRegistry registry;
+
+	// Stats
+	unsigned texturesLoaded = 0;
+	unsigned texturesFailed = 0;
+	unsigned texturesCompressed = 0;
+	// GPU memory not spent thanks to compression, mip chains included
+	unsigned long long bytesSaved = 0;
+	unsigned long long bytesUploaded = 0;
+	double uploadMilliseconds = 0.0;
+
+	// Constructor that creates the upload buffer, decodes run on JobSystem::Shared()
+	TextureLoader();
+	// Waits for the decode jobs, textures still in flight keep their placeholder
+	~TextureLoader();
+
+	// Returns a placeholder texture right away, its contents are swapped in once the file is uploaded.
+	// A path that is already loaded or loading comes back as the same texture, and so does another
+	// name for the same image once a decode job has hashed it
+	std::shared_ptr<Texture> Load(const char* filename, const TextureSampler& sampler = TextureSampler());
+	// Uploads decoded images within the frame budget, call once per frame on the GL thread
+	void Update();
+	// True while decoded images wait for or are in their upload. Decodes still running do not count,
+	// they ask redraw for a frame when they finish
+	bool Uploading();
+	// Drops the decodes that have not started, waits for the rest and releases the upload buffer
+	void Delete();
+
+private:
+	struct Request
+	{
+		std::string filename;
+		// what the placeholder is registered under until the decode job knows the content
+		uint64_t pathKey;
+		std::shared_ptr<Texture> texture;
+		// the whole mip chain, block compressed or RGBA8, shared with the registry
+		std::shared_ptr<const TextureFile> file;
+		TextureSampler sampler;
+		bool failed;
+	};
+	// The image being uploaded, its texture is only handed to the Texture when every level is in
+	struct Upload
+	{
+		Request request;
+		GLuint texture;
+		int nextLevel;
+		// RGBA8 levels go in a few rows at a time, compressed levels whole
+		int nextRow;
+	};
+
+	// decode jobs still queued or running
+	JobSystem::Counter jobs;
+	std::atomic<bool> stopping{ false };
+	std::mutex lock;
+	std::deque<Request> decoded;
+
+	StreamBuffer pixels;
+	std::deque<Upload> uploads;
+
+	// Decodes one file, runs as a job
+	void decode(Request request);
+	// Creates the destination texture for a decoded image
+	void startUpload(Upload& upload);
+	// Moves the finished texture into the Texture the caller holds
+	void finishUpload(Upload& upload);
+	// Queues a chain that is already decoded, for restoring an evicted texture
+	void reupload(std::shared_ptr<Texture> texture, const std::string& filename, std::shared_ptr<const TextureFile> file, const TextureSampler& sampler);
+
+	// Textures tracked in residency, untracked once nobody else holds them
+	std::vector<std::pair<std::weak_ptr<Texture>, ResidencyManager::Handle>> tracked;
+};
+
+#endif
@@ -0,0 +1,210 @@
+#include"TextureRegistry.h"
+
+#include<filesystem>
+#include<fstream>
+#include<future>
+#include<iterator>
+#include<vector>
+
+#include"GLExtensions.h"
+#include"GLState.h"
+#include"Hash.h"
+#include"Image.h"
+#include"TextureCompressor.h"
+
+// Key of a file's content, format choice and sampler, 0 when the file cannot be read
+uint64_t TextureRegistry::Key(const std::string& filename, bool compress, const TextureSampler& sampler)
+{
+	uint64_t content = contentHash(filename);
+	if (content == 0)
+		return 0;
+	GLint parameters[4] = { compress, sampler.minFilter, sampler.magFilter, sampler.wrap };
+	return hash_bytes(parameters, sizeof(parameters), content);
+}
+
+// Key of a path, format choice and sampler, made without touching the file
+uint64_t TextureRegistry::PathKey(const std::string& filename, bool compress, const TextureSampler& sampler)
+{
+	// seeded apart from content hashes, so a path never reads as the content of another file
+	uint64_t path = hash_bytes(filename.data(), filename.size(), hash_string("path"));
+	GLint parameters[4] = { compress, sampler.minFilter, sampler.magFilter, sampler.wrap };
+	return hash_bytes(parameters, sizeof(parameters), path);
+}
+
+// The live texture of a key, NULL when nobody holds one
+std::shared_ptr<Texture> TextureRegistry::Find(uint64_t key)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	auto found = textures.find(key);
+	if (found == textures.end())
+		return NULL;
+	std::shared_ptr<Texture> texture = found->second.lock();
+	if (texture == NULL)
+		textures.erase(found);
+	return texture;
+}
+
+// Makes a texture the one Find returns for its key
+void TextureRegistry::Insert(uint64_t key, const std::shared_ptr<Texture>& texture)
+{
+	if (key == 0)
+		return;
+	std::lock_guard<std::mutex> guard(lock);
+	textures[key] = texture;
+}
+
+// Makes a texture the one Find returns for its key unless a live one is there already
+std::shared_ptr<Texture> TextureRegistry::Merge(uint64_t key, const std::shared_ptr<Texture>& texture)
+{
+	if (key == 0)
+		return texture;
+	std::lock_guard<std::mutex> guard(lock);
+	std::weak_ptr<Texture>& entry = textures[key];
+	if (std::shared_ptr<Texture> existing = entry.lock())
+		return existing;
+	entry = texture;
+	return texture;
+}
+
+// Decodes a file and builds its mip chain once per content and format choice, then calls done
+void TextureRegistry::Decode(const std::string& filename, bool compress, const std::function<void(std::shared_ptr<const TextureFile>)>& done)
+{
+	uint64_t key = contentHash(filename);
+	// files that cannot be read all hash to 0, each fails on its own instead of waiting on another
+	if (key == 0)
+		key = PathKey(filename, compress);
+	key = hash_bytes(&compress, sizeof(compress), key);
+
+	std::shared_ptr<const TextureFile> file;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		auto found = decoded.find(key);
+		if (found != decoded.end())
+		{
+			file = found->second.lock();
+			if (file == NULL)
+				decoded.erase(found);
+		}
+		if (file == NULL)
+		{
+			auto running = decoding.find(key);
+			if (running != decoding.end())
+			{
+				// another thread is decoding the same image and hands it on when it is done. Waiting
+				// here would hold a worker, or deadlock one that helps out while it waits
+				running->second.push_back(done);
+				decodesShared++;
+				return;
+			}
+			decoding[key];
+			decodes++;
+		}
+		else
+			decodesShared++;
+	}
+	if (file != NULL)
+	{
+		done(file);
+		return;
+	}
+
+	try
+	{
+		Image image(filename.c_str());
+		// workers call this, one thread each keeps them from fighting over the cores
+		TextureCompressor compressor;
+		compressor.threadCount = 1;
+		TextureFile::Format format = TextureFile::RGBA8;
+		if (compress && (GLExtensions::textureCompressionBPTC || GLExtensions::textureCompressionS3TC))
+		{
+			format = TextureCompressor::Choose(image, GLExtensions::textureCompressionBPTC);
+			if (format != TextureFile::BC7 && !GLExtensions::textureCompressionS3TC)
+				format = TextureFile::RGBA8;
+		}
+		file = std::make_shared<const TextureFile>(compressor.Compress(image, format));
+	}
+	catch (int)
+	{
+		// the waiting loads see the same failure
+		file = NULL;
+	}
+
+	std::vector<std::function<void(std::shared_ptr<const TextureFile>)>> waiting;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		waiting.swap(decoding[key]);
+		decoding.erase(key);
+		if (file != NULL)
+			decoded[key] = file;
+	}
+	done(file);
+	for (const std::function<void(std::shared_ptr<const TextureFile>)>& waiter : waiting)
+		waiter(file);
+}
+
+// The shared texture of a file, decoded and uploaded on the calling GL thread when nobody holds it
+std::shared_ptr<Texture> TextureRegistry::Get(const char* filename, bool compress, const TextureSampler& sampler)
+{
+	uint64_t key = Key(filename, compress, sampler);
+	if (std::shared_ptr<Texture> texture = Find(key))
+	{
+		hits++;
+		return texture;
+	}
+	misses++;
+
+	// the calling thread is no job, so unlike one it may wait for a decode another thread started
+	std::promise<std::shared_ptr<const TextureFile>> result;
+	Decode(filename, compress, [&result](std::shared_ptr<const TextureFile> file) { result.set_value(file); });
+	std::shared_ptr<const TextureFile> file = result.get_future().get();
+	if (file == NULL)
+		return NULL;
+	std::shared_ptr<Texture> texture = std::make_shared<Texture>(*file, GL_TEXTURE_2D, GL_TEXTURE0, filename);
+	GLState::ActiveTexture(GL_TEXTURE0);
+	GLState::BindTexture(GL_TEXTURE_2D, texture->ID);
+	ApplySampler(GL_TEXTURE_2D, sampler);
+	GLState::BindTexture(GL_TEXTURE_2D, 0);
+	Insert(key, texture);
+	return texture;
+}
+
+// Sets the sampler on the texture bound to target
+void TextureRegistry::ApplySampler(GLenum target, const TextureSampler& sampler)
+{
+	glTexParameteri(target, GL_TEXTURE_MIN_FILTER, sampler.minFilter);
+	glTexParameteri(target, GL_TEXTURE_MAG_FILTER, sampler.magFilter);
+	glTexParameteri(target, GL_TEXTURE_WRAP_S, sampler.wrap);
+	glTexParameteri(target, GL_TEXTURE_WRAP_T, sampler.wrap);
+}
+
+// Hash of a file's bytes, 0 when it cannot be read
+uint64_t TextureRegistry::contentHash(const std::string& filename)
+{
+	std::error_code error;
+	uintmax_t size = std::filesystem::file_size(filename, error);
+	if (error)
+		return 0;
+	long long time = (long long)std::filesystem::last_write_time(filename, error).time_since_epoch().count();
+	if (error)
+		return 0;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		auto known = fileHashes.find(filename);
+		if (known != fileHashes.end() && known->second.size == size && known->second.time == time)
+			return known->second.hash;
+	}
+
+	// reading the bytes costs a fraction of decoding them, and only happens once per file version
+	std::ifstream in(filename, std::ios::binary);
+	if (!in)
+		return 0;
+	std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	uint64_t hash = hash_bytes(bytes.data(), bytes.size());
+	// 0 is kept for unreadable files
+	if (hash == 0)
+		hash = 1;
+
+	std::lock_guard<std::mutex> guard(lock);
+	fileHashes[filename] = FileHash{ size, time, hash };
+	return hash;
+}
@@ -0,0 +1,84 @@
+#ifndef TEXTURE_REGISTRY_CLASS_H
+#define TEXTURE_REGISTRY_CLASS_H
+
+#include<glad/glad.h>
+#include<cstdint>
+#include<functional>
+#include<memory>
+#include<mutex>
+#include<string>
+#include<unordered_map>
+#include<vector>
+
+#include"Texture.h"
+#include"TextureFile.h"
+
+// How a texture is sampled, part of the registry key since it is state of the GL texture
+struct TextureSampler
+{
+	GLint minFilter = GL_NEAREST_MIPMAP_LINEAR;
+	GLint magFilter = GL_NEAREST;
+	GLint wrap = GL_REPEAT;
+};
+
+// Hands out one shared texture per image, so parts that use the same material decode and upload it
+// once. Textures are keyed by a hash of the file's bytes with the format choice and sampler they are
+// made with, so the same image under two names is shared too. Hashing reads the whole file, so a
+// loader that must not block inserts its placeholder under a path key and merges it into the content
+// key once a worker knows the hash. The registry only holds weak
+// references, a texture is released when its last user lets go. Decoding is shared the same way:
+// a request for an image that is already decoding is handed the result of that decode instead of
+// starting its own, and a decoded chain is reused for as long as anything keeps it
+class TextureRegistry
+{
+public:
+	// Stats, textures found already made and decodes that ran or were shared
+	unsigned hits = 0;
+	unsigned misses = 0;
+	unsigned decodes = 0;
+	unsigned decodesShared = 0;
+
+	// Key of a file's content, format choice and sampler, 0 when the file cannot be read. The
+	// content hash is remembered per path until the file's size or time changes. Thread safe
+	uint64_t Key(const std::string& filename, bool compress, const TextureSampler& sampler = TextureSampler());
+	// Key of a path, format choice and sampler, made without touching the file
+	static uint64_t PathKey(const std::string& filename, bool compress, const TextureSampler& sampler = TextureSampler());
+	// The live texture of a key, NULL when nobody holds one
+	std::shared_ptr<Texture> Find(uint64_t key);
+	// Makes a texture the one Find returns for its key
+	void Insert(uint64_t key, const std::shared_ptr<Texture>& texture);
+	// Makes a texture the one Find returns for its key unless a live one is there already, returns
+	// whichever is there afterwards
+	std::shared_ptr<Texture> Merge(uint64_t key, const std::shared_ptr<Texture>& texture);
+	// Decodes a file and builds its mip chain, block compressed when compress is set and the driver
+	// can sample it, once per content and format choice. done gets the chain, NULL when the file
+	// cannot be decoded. When the image is already decoding Decode returns right away and the thread
+	// finishing that decode calls done, so a job never waits on another. Thread safe
+	void Decode(const std::string& filename, bool compress, const std::function<void(std::shared_ptr<const TextureFile>)>& done);
+	// The shared texture of a file, decoded and uploaded on the calling GL thread when nobody holds
+	// it. NULL when the file cannot be decoded
+	std::shared_ptr<Texture> Get(const char* filename, bool compress = false, const TextureSampler& sampler = TextureSampler());
+
+	// Sets the sampler on the texture bound to target
+	static void ApplySampler(GLenum target, const TextureSampler& sampler);
+
+private:
+	// What a path's content hash was computed from
+	struct FileHash
+	{
+		uintmax_t size;
+		long long time;
+		uint64_t hash;
+	};
+	std::mutex lock;
+	std::unordered_map<uint64_t, std::weak_ptr<Texture>> textures;
+	// decodes that are running, with the requests waiting for them
+	std::unordered_map<uint64_t, std::vector<std::function<void(std::shared_ptr<const TextureFile>)>>> decoding;
+	std::unordered_map<uint64_t, std::weak_ptr<const TextureFile>> decoded;
+	std::unordered_map<std::string, FileHash> fileHashes;
+
+	// Hash of a file's bytes, 0 when it cannot be read
+	uint64_t contentHash(const std::string& filename);
+};
+
+#endif
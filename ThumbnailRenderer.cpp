@@ -0,0 +1,179 @@
+#include"ThumbnailRenderer.h"
+
+#include<glm/gtc/matrix_transform.hpp>
+#include<algorithm>
+#include<atomic>
+#include<chrono>
+#include<filesystem>
+#include<fstream>
+#include<iostream>
+#include<map>
+#include<mutex>
+#include<set>
+
+#include"AmbientOcclusion.h"
+#include"Hash.h"
+#include"JobSystem.h"
+#include"Mesh.h"
+#include"SoftwareRasterizer.h"
+
+namespace fs = std::filesystem;
+
+// Constructor that uses every thread of the shared JobSystem
+ThumbnailRenderer::ThumbnailRenderer()
+{
+	threadCount = JobSystem::Shared().WorkerCount() + 1;
+}
+
+// Renders every STL in a directory (recursively) or listed one per line in a text file into
+// outputDirectory, returns false when the input cannot be read
+bool ThumbnailRenderer::Run(const std::string& input, const std::string& outputDirectory)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	rendered = skipped = failed = 0;
+
+	// pairs of source file and thumbnail, a directory is mirrored so equal names in different
+	// folders do not collide, a list is flattened by file name and tells repeated names apart by path
+	std::vector<std::pair<std::string, std::string>> jobs;
+	std::error_code error;
+	if (fs::is_directory(input, error))
+	{
+		for (const fs::directory_entry& entry : fs::recursive_directory_iterator(input, error))
+		{
+			std::string extension = entry.path().extension().string();
+			std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+			if (entry.is_regular_file(error) && extension == ".stl")
+				jobs.emplace_back(entry.path().string(), (fs::path(outputDirectory) / fs::relative(entry.path(), input, error)).replace_extension(".png").string());
+		}
+		std::sort(jobs.begin(), jobs.end());
+	}
+	else
+	{
+		std::ifstream list(input);
+		if (!list)
+			return false;
+		std::vector<std::string> files;
+		std::set<std::string> listed;
+		std::map<std::string, int> nameCount;
+		// names are compared without case, Windows would write A.png and a.png to the same file
+		auto nameOf = [](const std::string& file)
+		{
+			std::string name = fs::path(file).stem().string();
+			std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+			return name;
+		};
+		std::string line;
+		while (std::getline(list, line))
+		{
+			line.erase(line.find_last_not_of(" \t\r") + 1);
+			if (line.empty() || !listed.insert(line).second)
+				continue;
+			files.push_back(line);
+			nameCount[nameOf(line)]++;
+		}
+		// a name listed from several folders gets the hash of the full path, otherwise every one
+		// after the first would find the first one's thumbnail and be skipped as done
+		for (const std::string& file : files)
+		{
+			std::string name = fs::path(file).stem().string();
+			if (nameCount[nameOf(file)] > 1)
+				name += "-" + hash_to_hex(hash_string(file.c_str()));
+			jobs.emplace_back(file, (fs::path(outputDirectory) / (name + ".png")).string());
+		}
+	}
+
+	std::atomic<size_t> nextJob(0);
+	std::atomic<size_t> done(0), renderedCount(0), skippedCount(0), failedCount(0);
+	std::mutex logMutex;
+	auto lastReport = start;
+	auto worker = [&]()
+	{
+		for (size_t job = nextJob++; job < jobs.size(); job = nextJob++)
+		{
+			const std::string& output = jobs[job].second;
+			// one per worker, every worker checks its own files
+			std::error_code sizeError;
+			if (fs::file_size(output, sizeError) > 0 && !sizeError)
+				skippedCount++;
+			else if (Render(jobs[job].first, output))
+				renderedCount++;
+			else
+			{
+				failedCount++;
+				std::lock_guard<std::mutex> lock(logMutex);
+				std::cout << "Failed to render " << jobs[job].first << std::endl;
+			}
+			done++;
+
+			// progress every few seconds, whichever worker gets there first reports
+			std::lock_guard<std::mutex> lock(logMutex);
+			auto now = std::chrono::high_resolution_clock::now();
+			if (std::chrono::duration<double>(now - lastReport).count() >= 5.0)
+			{
+				lastReport = now;
+				double elapsed = std::chrono::duration<double>(now - start).count();
+				std::cout << done << "/" << jobs.size() << " files, " << renderedCount / elapsed << " files/s" << std::endl;
+			}
+		}
+	};
+
+	JobSystem::Shared().Parallel(threadCount, [&](unsigned) { worker(); });
+
+	rendered = renderedCount;
+	skipped = skippedCount;
+	failed = failedCount;
+	seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	return true;
+}
+
+// Renders one file, the image is written to a temporary name first so a killed run never
+// leaves a truncated PNG that would be skipped next time
+bool ThumbnailRenderer::Render(const std::string& filename, const std::string& output)
+{
+	Mesh mesh;
+	try
+	{
+		mesh = Mesh(filename.c_str(), color);
+	}
+	catch (int)
+	{
+		return false;
+	}
+	if (mesh.indices.empty())
+		return false;
+
+	// frame the bounding sphere of the part so it fills the image from any view direction
+	glm::vec3 lo(1e30f), hi(-1e30f);
+	for (size_t v = 0; v < mesh.VertexCount(); v++)
+	{
+		lo = glm::min(lo, mesh.Position(v));
+		hi = glm::max(hi, mesh.Position(v));
+	}
+	glm::vec3 center = (lo + hi) * 0.5f;
+	float radius = std::max(glm::length(hi - lo) * 0.5f, 1e-6f);
+	float fov = glm::radians(30.0f);
+	float distance = radius / std::sin(fov * 0.5f);
+	glm::vec3 direction = glm::normalize(viewDirection);
+	glm::vec3 up = std::abs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+	glm::mat4 view = glm::lookAt(center - direction * distance, center, up);
+	glm::mat4 projection = glm::perspective(fov, 1.0f, std::max(distance - radius * 1.01f, radius * 0.01f), distance + radius * 1.01f);
+
+	// the workers already keep every core busy, so each file bakes and rasterizes on one thread
+	AmbientOcclusion ambientOcclusion;
+	ambientOcclusion.raysPerVertex = raysPerVertex;
+	ambientOcclusion.threadCount = 1;
+	std::vector<GLubyte> occlusion = ambientOcclusion.Bake(mesh, false);
+
+	SoftwareRasterizer rasterizer(size, size);
+	rasterizer.threadCount = 1;
+	rasterizer.Clear(background);
+	rasterizer.Draw(mesh, std::vector<glm::mat4>(1, glm::mat4(1.0f)), occlusion, projection * view, NULL, true);
+
+	std::error_code error;
+	fs::create_directories(fs::path(output).parent_path(), error);
+	std::string temporary = output + ".tmp";
+	if (!rasterizer.color.WritePNG(temporary.c_str()))
+		return false;
+	fs::rename(temporary, output, error);
+	return !error;
+}
@@ -0,0 +1,41 @@
+#ifndef THUMBNAIL_RENDERER_CLASS_H
+#define THUMBNAIL_RENDERER_CLASS_H
+
+#include<glm/glm.hpp>
+#include<string>
+#include<vector>
+
+// Renders PNG previews of many STL files without a window. Every worker thread loads, bakes and
+// rasterizes whole files on its own so reading one file overlaps rendering the others.
+// Finished thumbnails are skipped, so an interrupted run picks up where it stopped
+class ThumbnailRenderer
+{
+public:
+	// Thumbnail edge in pixels
+	int size = 256;
+	// Occlusion rays per vertex, STL files have no normals so this is all the shading a part gets
+	int raysPerVertex = 16;
+	// Direction the camera looks at every part from
+	glm::vec3 viewDirection = glm::vec3(-1.0f, -0.8f, -1.4f);
+	glm::vec3 color = glm::vec3(0.80f, 0.80f, 0.82f);
+	glm::vec4 background = glm::vec4(0.07f, 0.13f, 0.17f, 1.0f);
+	unsigned threadCount;
+
+	// Stats of the last Run
+	size_t rendered = 0;
+	size_t skipped = 0;
+	size_t failed = 0;
+	double seconds = 0.0;
+
+	// Constructor that uses every core
+	ThumbnailRenderer();
+
+	// Renders every STL in a directory (recursively) or listed one per line in a text file into
+	// outputDirectory, returns false when the input cannot be read
+	bool Run(const std::string& input, const std::string& outputDirectory);
+	// Renders one file, the image is written to a temporary name first so a killed run never
+	// leaves a truncated PNG that would be skipped next time
+	bool Render(const std::string& filename, const std::string& output);
+};
+
+#endif
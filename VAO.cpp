@@ -1,39 +1,74 @@
 #include"VAO.h"
 
+#include"GLResources.h"
+#include"GLState.h"
+
 // Constructor that generates a VAO ID
 VAO::VAO()
 {
 	glGenVertexArrays(1, &ID);
+	GLResources::Track(GLResources::VERTEX_ARRAY, ID, "VAO");
+}
+
+// Takes over the vertex array of another VAO
+VAO::VAO(VAO&& other) noexcept
+	: ID(other.ID)
+{
+	other.ID = 0;
+}
+
+VAO& VAO::operator=(VAO&& other) noexcept
+{
+	if (this != &other)
+	{
+		GLResources::Release(GLResources::VERTEX_ARRAY, ID);
+		ID = other.ID;
+		other.ID = 0;
+	}
+	return *this;
+}
+
+// Queues the vertex array for deletion at the end of the frame
+VAO::~VAO()
+{
+	GLResources::Release(GLResources::VERTEX_ARRAY, ID);
 }
 
 // Links a VBO to the VAO using a certain layout
-void VAO::LinkAttrib(VBO& VBO, GLuint layout, GLuint numComponents, GLenum type, GLsizeiptr stride, void* offset)
+void VAO::LinkAttrib(VBO& VBO, GLuint layout, GLuint numComponents, GLenum type, GLsizeiptr stride, void* offset, GLuint divisor, GLboolean normalized)
+{
+	LinkAttrib(VBO.ID, layout, numComponents, type, stride, offset, divisor, normalized);
+}
+
+// Same for a buffer that is not a VBO, like a StreamBuffer
+void VAO::LinkAttrib(GLuint buffer, GLuint layout, GLuint numComponents, GLenum type, GLsizeiptr stride, void* offset, GLuint divisor, GLboolean normalized)
 {
-	VBO.Bind();
+	GLState::BindBuffer(GL_ARRAY_BUFFER, buffer);
 
 	// configure VAO to work with VBO
 	// 0 is index of vertex attribute, 3 vertex values, type of value is float
 	// integer coordinates is false, amount of data between vertex is just 3 floats,
 	// offset is pointer to beginning of array, which is the start of the array
-	glVertexAttribPointer(layout, numComponents, type, GL_FALSE, stride, offset);
+	glVertexAttribPointer(layout, numComponents, type, normalized, stride, offset);
 	glEnableVertexAttribArray(layout);
-	VBO.Unbind();
+	glVertexAttribDivisor(layout, divisor);
 }
 
 // Binds the VAO
 void VAO::Bind()
 {
-	glBindVertexArray(ID);
+	GLState::BindVertexArray(ID);
 }
 
 // Unbinds the VAO
 void VAO::Unbind()
 {
-	glBindVertexArray(0);
+	GLState::BindVertexArray(0);
 }
 
-// Deletes the VAO
+// Releases the VAO before the destructor would
 void VAO::Delete()
 {
-	glDeleteVertexArrays(1, &ID);
+	GLResources::Release(GLResources::VERTEX_ARRAY, ID);
+	ID = 0;
 }
\ No newline at end of file
@@ -12,13 +12,23 @@ public:
 	// Constructor that generates a VAO ID
 	VAO();
 
-	// Links a VBO to the VAO using a certain layout
-	void LinkAttrib(VBO& VBO, GLuint layout, GLuint numComponents, GLenum type, GLsizeiptr stride, void* offset);
+	// Move only, the object owns the GL vertex array and releases it when destroyed
+	VAO(const VAO&) = delete;
+	VAO& operator=(const VAO&) = delete;
+	VAO(VAO&& other) noexcept;
+	VAO& operator=(VAO&& other) noexcept;
+	~VAO();
+
+	// Links a VBO to the VAO using a certain layout, a divisor of 1 advances the attribute
+	// once per instance instead of once per vertex and normalized maps integers to 0..1
+	void LinkAttrib(VBO& VBO, GLuint layout, GLuint numComponents, GLenum type, GLsizeiptr stride, void* offset, GLuint divisor = 0, GLboolean normalized = GL_FALSE);
+	// Same for a buffer that is not a VBO, like a StreamBuffer
+	void LinkAttrib(GLuint buffer, GLuint layout, GLuint numComponents, GLenum type, GLsizeiptr stride, void* offset, GLuint divisor = 0, GLboolean normalized = GL_FALSE);
 	// Binds the VAO
 	void Bind();
 	// Unbinds the VAO
 	void Unbind();
-	// Deletes the VAO
+	// Releases the VAO before the destructor would
 	void Delete();
 };
 #endif
\ No newline at end of file
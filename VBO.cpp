@@ -1,12 +1,16 @@
 #include"VBO.h"
 
+#include"GLResources.h"
+#include"GLState.h"
+
 VBO::VBO(GLfloat* vertices, GLsizeiptr size)
 {
 	// generate 1 buffer object
 	glGenBuffers(1, &ID);
+	GLResources::Track(GLResources::BUFFER, ID, "VBO");
 
 	// bind the VBO, making it the current object to make it modifiable
-	glBindBuffer(GL_ARRAY_BUFFER, ID);
+	GLState::BindBuffer(GL_ARRAY_BUFFER, ID);
 
 	// STREAM = modify once, use a few times
 	// STATIC = modify once, use many many times
@@ -15,17 +19,59 @@ VBO::VBO(GLfloat* vertices, GLsizeiptr size)
 	glBufferData(GL_ARRAY_BUFFER, size, vertices, GL_STATIC_DRAW);
 }
 
+// Constructor for packed byte attributes like baked occlusion
+VBO::VBO(GLubyte* data, GLsizeiptr size)
+{
+	glGenBuffers(1, &ID);
+	GLResources::Track(GLResources::BUFFER, ID, "VBO");
+	GLState::BindBuffer(GL_ARRAY_BUFFER, ID);
+	glBufferData(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW);
+}
+
+// Takes over the buffer of another VBO
+VBO::VBO(VBO&& other) noexcept
+	: ID(other.ID)
+{
+	other.ID = 0;
+}
+
+VBO& VBO::operator=(VBO&& other) noexcept
+{
+	if (this != &other)
+	{
+		GLResources::Release(GLResources::BUFFER, ID);
+		ID = other.ID;
+		other.ID = 0;
+	}
+	return *this;
+}
+
+// Queues the buffer for deletion at the end of the frame
+VBO::~VBO()
+{
+	GLResources::Release(GLResources::BUFFER, ID);
+}
+
+// DYNAMIC because geometry like section caps is rebuilt while the plane moves
+void VBO::Update(GLfloat* vertices, GLsizeiptr size)
+{
+	GLState::BindBuffer(GL_ARRAY_BUFFER, ID);
+	glBufferData(GL_ARRAY_BUFFER, size, vertices, GL_DYNAMIC_DRAW);
+}
+
 void VBO::Bind()
 {
-	glBindBuffer(GL_ARRAY_BUFFER, ID);
+	GLState::BindBuffer(GL_ARRAY_BUFFER, ID);
 }
 
 void VBO::Unbind()
 {
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	GLState::BindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
+// Releases the VBO before the destructor would
 void VBO::Delete()
 {
-	glDeleteBuffers(1, &ID);
+	GLResources::Release(GLResources::BUFFER, ID);
+	ID = 0;
 }
\ No newline at end of file
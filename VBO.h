@@ -10,12 +10,23 @@ public:
 	GLuint ID;
 	// Constructor that generates a Vertex Buffer Object and links it to vertices
 	VBO(GLfloat* vertices, GLsizeiptr size);
+	// Constructor for packed byte attributes like baked occlusion
+	VBO(GLubyte* data, GLsizeiptr size);
 
+	// Move only, the object owns the GL buffer and releases it when destroyed
+	VBO(const VBO&) = delete;
+	VBO& operator=(const VBO&) = delete;
+	VBO(VBO&& other) noexcept;
+	VBO& operator=(VBO&& other) noexcept;
+	~VBO();
+
+	// Replaces the contents of the VBO with new vertices
+	void Update(GLfloat* vertices, GLsizeiptr size);
 	// Binds the VBO
 	void Bind();
 	// Unbinds the VBO
 	void Unbind();
-	// Deletes the VBO
+	// Releases the VBO before the destructor would
 	void Delete();
 };
 
@@ -1,13 +1,62 @@
 #version 330 core
+// Variant switches, see default.vert. TEXTURED left undefined picks texture or vertex color
+// at run time with the flatColor uniform
+#ifndef CLIPPED
+#define CLIPPED 1
+#endif
+#ifndef FLAT_SHADING
+#define FLAT_SHADING 0
+#endif
+#ifndef ATLAS
+#define ATLAS 0
+#endif
+
 out vec4 FragColor;
 
+#if FLAT_SHADING
+flat in vec3 color;
+#else
 in vec3 color;
+#endif
 
 in vec2 texCoord;
 
+in float clipDistance;
+
+in float occlusion;
+
 uniform sampler2D tex0;
 
+#if ATLAS
+// every page of a TextureAtlas, the slot picks the layer and the rectangle inside it
+uniform sampler2DArray atlas;
+flat in vec4 atlasRect;
+flat in float atlasLayer;
+#endif
+
+#ifndef TEXTURED
+// STL parts have no texture coordinates and use their vertex color instead
+uniform bool flatColor;
+#endif
+
 void main()
 {
+#if CLIPPED
+   // behind the section plane
+   if (clipDistance < 0.0)
+      discard;
+#endif
+
+#if ATLAS
+   // repeats inside the slot, the gradients of the unwrapped coordinates keep the seams on the right mip
+   vec2 atlasCoord = atlasRect.xy + fract(texCoord) * atlasRect.zw;
+   FragColor = textureGrad(atlas, vec3(atlasCoord, atlasLayer), dFdx(texCoord) * atlasRect.zw, dFdy(texCoord) * atlasRect.zw);
+#elif !defined(TEXTURED)
+   FragColor = flatColor ? vec4(color, 1.0) : texture(tex0, texCoord);
+#elif TEXTURED
    FragColor = texture(tex0, texCoord);
+#else
+   FragColor = vec4(color, 1.0);
+#endif
+   FragColor.rgb *= occlusion;
 }
\ No newline at end of file
@@ -1,19 +1,91 @@
 #version 330 core
+// Variant switches, ShaderLibrary defines them as 0 or 1. Left undefined this builds the general
+// program that handles every case, which is also what is drawn while a variant compiles
+#ifndef INSTANCED
+#define INSTANCED 1
+#endif
+#ifndef CLIPPED
+#define CLIPPED 1
+#endif
+#ifndef FLAT_SHADING
+#define FLAT_SHADING 0
+#endif
+#ifndef ATLAS
+#define ATLAS 0
+#endif
+
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aColor;
 layout (location = 2) in vec2 aTex;
+// per instance transform, takes locations 3 to 6
+// draws without an instance buffer get the identity from the current attribute values
+layout (location = 3) in mat4 instanceMatrix;
+// baked ambient occlusion, 1 is fully open, meshes without a bake get 1 from the current attribute value
+layout (location = 7) in float aOcclusion;
+#if ATLAS
+// per instance slot in the texture atlas, draws without an instance buffer use the current attribute value
+layout (location = 8) in float aAtlasSlot;
+#endif
 
+#if FLAT_SHADING
+// the color of a triangle's last vertex for the whole triangle
+flat out vec3 color;
+#else
 out vec3 color;
+#endif
 
 out vec2 texCoord;
 
+out float clipDistance;
+
+out float occlusion;
+
 uniform float scale;
 
-uniform mat4 camMatrix;
+#include "FrameData.glsl"
+
+#if ATLAS
+// MAX_ATLAS_SLOTS comes from TextureAtlas.h through the defines of every atlas variant
+#ifndef MAX_ATLAS_SLOTS
+#error MAX_ATLAS_SLOTS is defined by ShaderLibrary::Defines
+#endif
+layout (std140) uniform AtlasSlots
+{
+   // offset (xy) and scale (zw) of each slot's texture coordinates
+   vec4 atlasRects[MAX_ATLAS_SLOTS];
+   // layer of slot i in component i % 4 of entry i / 4
+   vec4 atlasLayers[MAX_ATLAS_SLOTS / 4];
+};
+
+flat out vec4 atlasRect;
+flat out float atlasLayer;
+#endif
+
+#if CLIPPED
+// section plane, dot(clipPlane.xyz, position) + clipPlane.w >= 0 is kept
+// (0, 0, 0, 1) keeps everything
+uniform vec4 clipPlane;
+#endif
 
 void main()
 {
-   gl_Position = camMatrix * vec4(aPos, 1.0);
+#if INSTANCED
+   vec4 worldPos = instanceMatrix * vec4(aPos, 1.0);
+#else
+   vec4 worldPos = vec4(aPos, 1.0);
+#endif
+   gl_Position = viewProjection * worldPos;
    color = aColor;
    texCoord = aTex;
+#if CLIPPED
+   clipDistance = dot(clipPlane, worldPos);
+#else
+   clipDistance = 1.0;
+#endif
+   occlusion = aOcclusion;
+#if ATLAS
+   int slot = int(aAtlasSlot);
+   atlasRect = atlasRects[slot];
+   atlasLayer = atlasLayers[slot / 4][slot % 4];
+#endif
 }
\ No newline at end of file
@@ -1,5 +1,15 @@
 #include "shaderClass.h"
 
+#include"FrameData.h"
+#include"GLExtensions.h"
+#include"GLResources.h"
+#include"GLState.h"
+#include"Hash.h"
+#include"ProgramCache.h"
+#include"TextureAtlas.h"
+
+#include<glm/gtc/type_ptr.hpp>
+
 std::string get_file_contents(const char* filename)
 {
 	std::ifstream in(filename, std::ios::binary);
@@ -16,51 +26,296 @@ std::string get_file_contents(const char* filename)
 	throw(errno);
 }
 
-Shader::Shader(const char* vertexFile, const char* fragmentFile)
+// Replaces #include "file" lines with the file, paths are relative to directory
+std::string expand_includes(const std::string& source, const std::string& directory, int depth)
 {
-	std::string vertexCode = get_file_contents(vertexFile);
-	std::string fragmentCode = get_file_contents(fragmentFile);
-
-	const char* vertexSource = vertexCode.c_str();
-	const char* fragmentSource = fragmentCode.c_str();
+	// a file including itself would never end
+	if (depth > 16)
+	{
+		std::cout << "SHADER_INCLUDE_ERROR: includes nested too deep" << std::endl;
+		return source;
+	}
 
-	// create a vertex shader by compiling the source code at the top
-	GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertexShader, 1, &vertexSource, NULL);
-	glCompileShader(vertexShader);
+	std::istringstream lines(source);
+	std::string expanded, line;
+	while (std::getline(lines, line))
+	{
+		size_t directive = line.find_first_not_of(" \t");
+		size_t open = line.find('"');
+		size_t close = line.rfind('"');
+		if (directive != std::string::npos && line.compare(directive, 8, "#include") == 0 && open != std::string::npos && close > open)
+		{
+			std::string path = directory + line.substr(open + 1, close - open - 1);
+			std::string file = get_file_contents(path.c_str());
+			expanded += expand_includes(file, path.substr(0, path.find_last_of("/\\") + 1), depth + 1);
+			expanded += "\n";
+		}
+		else
+			expanded += line + "\n";
+	}
+	return expanded;
+}
 
-	compileErrors(vertexShader, "VERTEX");
+// Puts defines right after the #version line, GLSL wants that line first
+std::string insert_defines(const std::string& source, const std::string& defines)
+{
+	if (defines.empty())
+		return source;
+	size_t version = source.find("#version");
+	size_t lineEnd = version == std::string::npos ? std::string::npos : source.find('\n', version);
+	if (lineEnd == std::string::npos)
+		return defines + "\n" + source;
+	return source.substr(0, lineEnd + 1) + defines + "\n" + source.substr(lineEnd + 1);
+}
 
-	// create a fragment shader by compiling the source code at the top
-	GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragmentShader, 1, &fragmentSource, NULL);
-	glCompileShader(fragmentShader);
+Shader::Shader(const char* vertexFile, const char* fragmentFile, const std::string& defines, bool wait)
+{
+	std::string vertexPath = vertexFile;
+	std::string fragmentPath = fragmentFile;
+	std::string vertexCode = expand_includes(get_file_contents(vertexFile), vertexPath.substr(0, vertexPath.find_last_of("/\\") + 1));
+	std::string fragmentCode = expand_includes(get_file_contents(fragmentFile), fragmentPath.substr(0, fragmentPath.find_last_of("/\\") + 1));
 
-	compileErrors(fragmentShader, "FRAGMENT");
+	vertexCode = insert_defines(vertexCode, defines);
+	fragmentCode = insert_defines(fragmentCode, defines);
 
 	// create and wrap the shader program 
 	ID = glCreateProgram();
-	glAttachShader(ID, vertexShader);
-	glAttachShader(ID, fragmentShader);
-	glLinkProgram(ID);
+	GLResources::Track(GLResources::PROGRAM, ID, vertexPath + " " + fragmentPath);
+
+	// a binary saved by an earlier launch skips compiling and linking entirely
+	cacheKey = ProgramCache::Key(vertexCode, fragmentCode, defines);
+	fromCache = ProgramCache::Load(ID, cacheKey);
+	linking = true;
+	if (!fromCache)
+	{
+		const char* vertexSource = vertexCode.c_str();
+		const char* fragmentSource = fragmentCode.c_str();
 
-	compileErrors(ID, "PROGRAM");
+		// nothing below asks for a status, so a driver that compiles in parallel returns right away
+		// create a vertex shader by compiling the source code at the top
+		pendingVertex = glCreateShader(GL_VERTEX_SHADER);
+		glShaderSource(pendingVertex, 1, &vertexSource, NULL);
+		glCompileShader(pendingVertex);
 
-	// delete old shaders once saved in program
-	glDeleteShader(vertexShader);
-	glDeleteShader(fragmentShader);
+		// create a fragment shader by compiling the source code at the top
+		pendingFragment = glCreateShader(GL_FRAGMENT_SHADER);
+		glShaderSource(pendingFragment, 1, &fragmentSource, NULL);
+		glCompileShader(pendingFragment);
+
+		glAttachShader(ID, pendingVertex);
+		glAttachShader(ID, pendingFragment);
+		ProgramCache::PrepareLink(ID);
+		glLinkProgram(ID);
+	}
+
+	if (wait)
+		finishLink();
+}
+
+// True once the program is linked and reflected
+bool Shader::Ready()
+{
+	if (!linking)
+		return true;
+	if (pendingVertex != 0 && GLExtensions::parallelShaderCompile)
+	{
+		GLint done = GL_FALSE;
+		glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &done);
+		if (done == GL_FALSE)
+			return false;
+	}
+	finishLink();
+	return true;
+}
+
+// Checks the compile, stores the binary and reflects the program
+void Shader::finishLink()
+{
+	linking = false;
+	if (pendingVertex != 0)
+	{
+		compileErrors(pendingVertex, "VERTEX");
+		compileErrors(pendingFragment, "FRAGMENT");
+		compileErrors(ID, "PROGRAM");
+
+		// delete old shaders once saved in program
+		glDeleteShader(pendingVertex);
+		glDeleteShader(pendingFragment);
+		pendingVertex = 0;
+		pendingFragment = 0;
+
+		GLint linked = GL_FALSE;
+		glGetProgramiv(ID, GL_LINK_STATUS, &linked);
+		if (linked == GL_TRUE)
+			ProgramCache::Store(ID, cacheKey);
+	}
+
+	// every program reads the shared per frame block from the same binding point
+	GLuint frameBlock = glGetUniformBlockIndex(ID, "FrameData");
+	if (frameBlock != GL_INVALID_INDEX)
+		glUniformBlockBinding(ID, frameBlock, FRAME_DATA_BINDING);
+	GLuint atlasBlock = glGetUniformBlockIndex(ID, "AtlasSlots");
+	if (atlasBlock != GL_INVALID_INDEX)
+		glUniformBlockBinding(ID, atlasBlock, ATLAS_SLOTS_BINDING);
+	// GLSL 330 has no binding qualifier, the atlas sampler is pointed at its unit here once
+	GLint atlasSampler = glGetUniformLocation(ID, "atlas");
+	if (atlasSampler != -1)
+	{
+		GLState::UseProgram(ID);
+		glUniform1i(atlasSampler, ATLAS_TEXTURE_UNIT);
+	}
+
+	reflectUniforms();
+}
+
+// Deletes shader objects of a compile that never finished
+void Shader::dropPending()
+{
+	if (pendingVertex != 0)
+		glDeleteShader(pendingVertex);
+	if (pendingFragment != 0)
+		glDeleteShader(pendingFragment);
+	pendingVertex = 0;
+	pendingFragment = 0;
+	linking = false;
+}
+
+// Takes over the program of another Shader
+Shader::Shader(Shader&& other) noexcept
+	: ID(other.ID), fromCache(other.fromCache), linking(other.linking), pendingVertex(other.pendingVertex),
+	pendingFragment(other.pendingFragment), cacheKey(other.cacheKey), uniforms(std::move(other.uniforms))
+{
+	other.ID = 0;
+	other.linking = false;
+	other.pendingVertex = 0;
+	other.pendingFragment = 0;
+}
+
+Shader& Shader::operator=(Shader&& other) noexcept
+{
+	if (this != &other)
+	{
+		dropPending();
+		GLResources::Release(GLResources::PROGRAM, ID);
+		ID = other.ID;
+		fromCache = other.fromCache;
+		linking = other.linking;
+		pendingVertex = other.pendingVertex;
+		pendingFragment = other.pendingFragment;
+		cacheKey = other.cacheKey;
+		uniforms = std::move(other.uniforms);
+		other.ID = 0;
+		other.linking = false;
+		other.pendingVertex = 0;
+		other.pendingFragment = 0;
+	}
+	return *this;
+}
+
+// Queues the program for deletion at the end of the frame
+Shader::~Shader()
+{
+	dropPending();
+	GLResources::Release(GLResources::PROGRAM, ID);
 }
 
 // Activates the Shader Program
 void Shader::Activate()
 {
-	glUseProgram(ID);
+	GLState::UseProgram(ID);
 }
 
-// Deletes the Shader Program
+// Releases the Shader Program before the destructor would
 void Shader::Delete()
 {
-	glDeleteProgram(ID);
+	dropPending();
+	GLResources::Release(GLResources::PROGRAM, ID);
+	ID = 0;
+}
+
+// Location of an active uniform, -1 when the program does not use it
+GLint Shader::Uniform(const char* name) const
+{
+	return Uniform(hash_string(name));
+}
+
+GLint Shader::Uniform(uint64_t nameHash) const
+{
+	if (uniforms.empty())
+		return -1;
+	size_t mask = uniforms.size() - 1;
+	for (size_t slot = (size_t)nameHash & mask; uniforms[slot].location != -1; slot = (slot + 1) & mask)
+		if (uniforms[slot].nameHash == nameHash)
+			return uniforms[slot].location;
+	return -1;
+}
+
+void Shader::SetInt(GLint handle, GLint value)
+{
+	Activate();
+	glUniform1i(handle, value);
+}
+
+void Shader::SetFloat(GLint handle, GLfloat value)
+{
+	Activate();
+	glUniform1f(handle, value);
+}
+
+void Shader::SetVec3(GLint handle, const glm::vec3& value)
+{
+	Activate();
+	glUniform3fv(handle, 1, glm::value_ptr(value));
+}
+
+void Shader::SetVec4(GLint handle, const glm::vec4& value)
+{
+	Activate();
+	glUniform4fv(handle, 1, glm::value_ptr(value));
+}
+
+void Shader::SetMat4(GLint handle, const glm::mat4& value)
+{
+	Activate();
+	glUniformMatrix4fv(handle, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+// Reads every active uniform after the link
+void Shader::reflectUniforms()
+{
+	GLint count = 0, maxLength = 0;
+	glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+	// at most half full so probes stay short, the empty slot marker is location -1
+	size_t capacity = 8;
+	while (capacity < (size_t)count * 2)
+		capacity *= 2;
+	uniforms.assign(capacity, UniformSlot{ 0, -1, 0 });
+
+	std::string name(maxLength > 0 ? maxLength : 1, '\0');
+	for (GLint i = 0; i < count; i++)
+	{
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveUniform(ID, (GLuint)i, (GLsizei)name.size(), &length, &size, &type, &name[0]);
+		std::string uniformName(name.data(), length);
+		GLint location = glGetUniformLocation(ID, uniformName.c_str());
+		// uniforms in blocks have no location
+		if (location < 0)
+			continue;
+		// arrays are reported as "name[0]", look them up by the plain name
+		if (uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0)
+			uniformName.resize(uniformName.size() - 3);
+
+		uint64_t nameHash = hash_string(uniformName.c_str());
+		size_t mask = capacity - 1;
+		size_t slot = (size_t)nameHash & mask;
+		while (uniforms[slot].location != -1)
+			slot = (slot + 1) & mask;
+		uniforms[slot] = UniformSlot{ nameHash, location, type };
+	}
 }
 
 // Checks if the different Shaders have compiled properly
@@ -7,19 +7,77 @@
 #include<sstream>
 #include<iostream>
 #include<cerrno>
+#include<cstdint>
+#include<vector>
+#include<glm/glm.hpp>
 
 std::string get_file_contents(const char* filename);
+// Replaces #include "file" lines with the file, paths are relative to directory
+std::string expand_includes(const std::string& source, const std::string& directory, int depth = 0);
+// Puts defines right after the #version line, GLSL wants that line first
+std::string insert_defines(const std::string& source, const std::string& defines);
 
 class Shader
 {
 public:
 	GLuint ID;
-	Shader(const char* vertexFile, const char* fragmentFile);
+	// True when the program came from the binary cache instead of being compiled
+	bool fromCache = false;
+	// defines is GLSL text, usually "#define NAME value" lines, added to both stages.
+	// With wait false the compile is only started, poll Ready until it returns true before using the program
+	Shader(const char* vertexFile, const char* fragmentFile, const std::string& defines = "", bool wait = true);
+
+	// Move only, the object owns the GL program and releases it when destroyed
+	Shader(const Shader&) = delete;
+	Shader& operator=(const Shader&) = delete;
+	Shader(Shader&& other) noexcept;
+	Shader& operator=(Shader&& other) noexcept;
+	~Shader();
+
+	// True once the program is linked and reflected. Never blocks when the driver compiles in
+	// parallel, otherwise it waits for the driver to finish
+	bool Ready();
 
 	void Activate();
+	// Releases the program before the destructor would
 	void Delete();
 
+	// Location of an active uniform, -1 when the program does not use it.
+	// Resolve once and keep the handle, the setters below never look at names
+	GLint Uniform(const char* name) const;
+	GLint Uniform(uint64_t nameHash) const;
+
+	// Setters that take a resolved handle, they activate the program first
+	void SetInt(GLint handle, GLint value);
+	void SetFloat(GLint handle, GLfloat value);
+	void SetVec3(GLint handle, const glm::vec3& value);
+	void SetVec4(GLint handle, const glm::vec4& value);
+	void SetMat4(GLint handle, const glm::mat4& value);
+
 private:
+	// Set between starting a compile and Ready finishing it, the shader objects are still attached then
+	bool linking = false;
+	GLuint pendingVertex = 0;
+	GLuint pendingFragment = 0;
+	uint64_t cacheKey = 0;
+
+	// Checks the compile, stores the binary and reflects the program
+	void finishLink();
+	// Deletes shader objects of a compile that never finished
+	void dropPending();
+
+	// Active uniforms in an open addressing table keyed by hash_string of the name
+	struct UniformSlot
+	{
+		uint64_t nameHash;
+		GLint location;
+		GLenum type;
+	};
+	std::vector<UniformSlot> uniforms;
+
+	// Reads every active uniform after the link
+	void reflectUniforms();
+
 	// Checks if the different Shaders have compiled properly
 	void compileErrors(unsigned int shader, const char* type);
 };